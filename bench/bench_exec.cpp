@@ -0,0 +1,121 @@
+#include "bench_functions.h"
+#include "codegen/linear_scan.h"
+#include "codegen/x86_64_jit.h"
+#include "exec/interpreter.h"
+#include "ir/ir_graph.h"
+
+using namespace ir;
+
+// fact(u32) from main.cpp.
+static void buildFact(IRGraph &g) {
+    g.setSignature("u64", "fact", {{"u32", "a0"}});
+    auto *entry = g.createBlock("entry");
+    auto *loop = g.createBlock("loop");
+    auto *body = g.createBlock("body");
+    auto *done = g.createBlock("done");
+    SSAValue *a0 = g.createArg("u32", "a0");
+    SSAValue *v0 = g.createValue(), *v1 = g.createValue(), *v2 = g.createValue();
+    SSAValue *p0 = g.createValue(), *p1 = g.createValue();
+    SSAValue *m = g.createValue(), *n = g.createValue();
+    entry->addInst(g.createMovi(v0, 1));
+    entry->addInst(g.createMovi(v1, 2));
+    entry->addInst(g.createCast(v2, a0));
+    entry->addSuccessor(loop);
+    loop->addInst(g.createPhi(p0, {{entry, v0}, {body, m}}));
+    loop->addInst(g.createPhi(p1, {{entry, v1}, {body, n}}));
+    loop->addInst(g.createCmp(p1, v2));
+    loop->addInst(g.createJa(done));
+    loop->addSuccessor(done);
+    loop->addSuccessor(body);
+    body->addInst(g.createMul(m, p0, p1));
+    body->addInst(g.createAddi(n, p1, 1));
+    body->addInst(g.createJmp(loop));
+    body->addSuccessor(loop);
+    done->addInst(g.createRet(p0));
+}
+
+void benchExecution(size_t scale) {
+    size_t calls = 200000 * scale;
+    const uint64_t n = 20;
+    std::cout << "fact(" << n << ") x " << calls << " calls\n";
+    IRGraph g;
+    buildFact(g);
+
+    exec::BytecodeFunction fn;
+    {
+        BenchTimer t("bytecode lowering");
+        fn = exec::lowerToBytecode(g);
+    }
+    uint64_t sum = 0;
+    {
+        BenchTimer t("interpreter");
+        exec::Interpreter interp(fn);
+        for (size_t i = 0; i < calls; ++i)
+            sum += interp.run({n});
+    }
+    codegen::x86_64::JitFunction native;
+    {
+        BenchTimer t("x86-64 compile");
+        native = codegen::x86_64::compileX86_64(g);
+    }
+    uint64_t nativeSum = 0;
+    {
+        BenchTimer t("native");
+        auto *fact = native.as<uint64_t(uint32_t)>();
+        for (size_t i = 0; i < calls; ++i)
+            nativeSum += fact(static_cast<uint32_t>(n));
+    }
+    std::cout << "  checksum " << sum << (sum == nativeSum ? "" : " MISMATCH") << "\n";
+}
+
+// A long function made of small counted loops, each updating a running
+// product that stays live across every loop. Named loops unless g already
+// has a name.
+void buildLoopChain(IRGraph &g, size_t nloops) {
+    g.setSignature("u64", g.name().empty() ? "loops" : g.name(), {{"u32", "a0"}});
+    SSAValue *a0 = g.createArg("u32", "a0");
+    BasicBlock *pre = g.createBlock();
+    SSAValue *acc = g.createValue();
+    pre->addInst(g.createCast(acc, a0));
+    for (size_t i = 0; i < nloops; ++i) {
+        auto *header = g.createBlock();
+        auto *body = g.createBlock();
+        auto *exit = g.createBlock();
+        SSAValue *zero = g.createValue(), *limit = g.createValue();
+        pre->addInst(g.createMovi(zero, 0));
+        pre->addInst(g.createMovi(limit, 3));
+        pre->addSuccessor(header);
+        SSAValue *iv = g.createValue(), *p = g.createValue();
+        SSAValue *next = g.createValue(), *prod = g.createValue();
+        header->addInst(g.createPhi(iv, {{pre, zero}, {body, next}}));
+        header->addInst(g.createPhi(p, {{pre, acc}, {body, prod}}));
+        header->addInst(g.createCmp(iv, limit));
+        header->addInst(g.createJa(exit));
+        header->addSuccessor(exit);
+        header->addSuccessor(body);
+        body->addInst(g.createMul(prod, p, p));
+        body->addInst(g.createAddi(next, iv, 1));
+        body->addInst(g.createJmp(header));
+        body->addSuccessor(header);
+        pre = exit;
+        acc = p;
+    }
+    pre->addInst(g.createRet(acc));
+}
+
+void benchRegisterAllocation(size_t scale) {
+    size_t nloops = 2000 * scale;
+    std::cout << "linear scan, " << nloops << " loops\n";
+    IRGraph g;
+    buildLoopChain(g, nloops);
+    codegen::LinearScan ls(11);
+    {
+        BenchTimer t("allocate");
+        ls.run(g);
+    }
+    {
+        BenchTimer t("allocate + x86-64 compile");
+        codegen::x86_64::compileX86_64(g);
+    }
+    std::cout << "  " << ls.intervals.size() << " intervals, " << ls.numSpilled() << " spilled\n";
+}
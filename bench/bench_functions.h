@@ -0,0 +1,34 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+namespace ir {
+class IRGraph;
+}
+
+struct BenchTimer {
+    std::string name;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    explicit BenchTimer(std::string n) : name(std::move(n)) {
+    }
+    double elapsedMs() const {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    ~BenchTimer() {
+        std::cout << "  " << name << ": " << elapsedMs() << " ms\n";
+    }
+};
+
+void benchGraphBuild(size_t scale);
+void benchTraversals(size_t scale);
+void benchExecution(size_t scale);
+void benchRegisterAllocation(size_t scale);
+void benchSerialization(size_t scale);
+void benchPipeline(size_t scale);
+void benchParallelDriver(size_t scale);
+
+// A long function of small counted loops (bench_exec.cpp).
+void buildLoopChain(ir::IRGraph &g, size_t nloops);
@@ -0,0 +1,46 @@
+#include "bench_functions.h"
+#include "ir/ir_graph.h"
+#include <memory>
+
+using namespace ir;
+
+static void buildChain(IRGraph &g, size_t nblocks) {
+    g.setSignature("u64", "chain", {{"u32", "a0"}});
+    SSAValue *a0 = g.createArg("u32", "a0");
+    BasicBlock *prev = nullptr;
+    SSAValue *acc = g.createValue();
+    for (size_t i = 0; i < nblocks; ++i) {
+        BasicBlock *bb = g.createBlock();
+        if (i == 0) {
+            SSAValue *wide = g.createValue();
+            bb->addInst(g.createCast(wide, a0));
+            bb->addInst(g.createMovi(acc, 1));
+        } else {
+            prev->addSuccessor(bb);
+            SSAValue *k = g.createValue();
+            SSAValue *m = g.createValue();
+            SSAValue *n = g.createValue();
+            bb->addInst(g.createMovi(k, i));
+            bb->addInst(g.createMul(m, acc, k));
+            bb->addInst(g.createAddi(n, m, 3));
+            acc = n;
+        }
+        prev = bb;
+    }
+    prev->addInst(g.createRet(acc));
+}
+
+void benchGraphBuild(size_t scale) {
+    size_t nblocks = 100000 * scale;
+    std::cout << "graph build/teardown, " << nblocks << " blocks\n";
+    auto g = std::make_unique<IRGraph>();
+    {
+        BenchTimer t("build");
+        buildChain(*g, nblocks);
+    }
+    std::cout << "  arena bytes: " << g->arena().bytesUsed() << "\n";
+    {
+        BenchTimer t("teardown");
+        g.reset();
+    }
+}
@@ -0,0 +1,40 @@
+#include "bench_functions.h"
+#include "ir/ir_graph.h"
+#include "exec/bytecode.h"
+#include "ir/module.h"
+#include "opt/parallel_driver.h"
+#include "opt/pass_manager.h"
+#include <thread>
+#include <vector>
+
+using namespace ir;
+
+void benchPipeline(size_t scale) {
+    size_t nloops = 2000 * scale;
+    IRGraph g;
+    buildLoopChain(g, nloops);
+    opt::PassManager PM;
+    PM.parsePipeline("loops,sccp,gvn,licm,strength-reduce,loop-unroll,dce");
+    std::cout << "pipeline " << PM.pipeline() << ", " << nloops << " loops\n";
+    PM.run(g);
+    PM.printReport(std::cout);
+}
+
+void benchParallelDriver(size_t scale) {
+    size_t nfuncs = 512 * scale;
+    const char *pipeline = "sccp,gvn,licm,strength-reduce,loop-unroll,dce";
+    std::cout << "parallel driver, " << nfuncs << " functions of 20 loops\n";
+    std::vector<unsigned> counts = {1};
+    if (std::thread::hardware_concurrency() > 1)
+        counts.push_back(std::thread::hardware_concurrency());
+    for (unsigned threads : counts) {
+        Module M;
+        for (size_t i = 0; i < nfuncs; ++i)
+            buildLoopChain(M.createFunction("loops" + std::to_string(i)), 20);
+        opt::ParallelDriver D(pipeline, threads);
+        D.releaseIR = true;
+        std::vector<exec::BytecodeFunction> out(nfuncs);
+        BenchTimer t("optimize + lower, " + std::to_string(threads) + " threads");
+        D.run(M, [&](size_t i, IRGraph &g) { out[i] = exec::lowerToBytecode(g); });
+    }
+}
@@ -0,0 +1,64 @@
+#include "bench_functions.h"
+#include "ir/binary_format.h"
+#include "ir/ir_graph.h"
+#include "ir/text_parser.h"
+#include <filesystem>
+#include <fstream>
+
+using namespace ir;
+
+void benchSerialization(size_t scale) {
+    size_t nloops = 20000 * scale;
+    IRGraph g;
+    buildLoopChain(g, nloops);
+    std::string path = (std::filesystem::temp_directory_path() / "bench_loop_chain.irb").string();
+    std::vector<uint8_t> bytes;
+    {
+        BenchTimer t("write binary");
+        bytes = writeBinary(g);
+    }
+    std::cout << "binary IR, " << nloops << " loops, " << bytes.size() / 1024 << " KiB\n";
+    writeBinaryFile(g, path);
+    {
+        MappedFile file(path);
+        BenchTimer t("mmap + walk view");
+        BinaryView V = file.view();
+        uint64_t sum = 0;
+        for (uint32_t b = 0; b < V.numBlocks(); ++b) {
+            const binary::Block &B = V.block(b);
+            for (uint32_t i = B.firstInst; i < B.firstInst + B.numInsts; ++i)
+                sum += V.inst(i).opcode;
+        }
+        std::cout << "  opcode checksum " << sum << "\n";
+    }
+    {
+        MappedFile file(path);
+        BenchTimer t("mmap + rebuild IRGraph");
+        IRGraph h;
+        readBinary(file.view(), h);
+    }
+    std::filesystem::remove(path);
+
+    std::string text;
+    {
+        BenchTimer t("print text");
+        text = g.toString();
+    }
+    double mb = text.size() / (1024.0 * 1024.0);
+    std::cout << "text IR, " << text.size() / 1024 << " KiB\n";
+    std::string textPath = (std::filesystem::temp_directory_path() / "bench_loop_chain.ir").string();
+    {
+        BenchTimer t("print text to file");
+        std::ofstream out(textPath, std::ios::binary);
+        g.print(out);
+        out.flush();
+        std::cout << "  print throughput " << mb / (t.elapsedMs() / 1000.0) << " MB/s\n";
+    }
+    std::filesystem::remove(textPath);
+    {
+        BenchTimer t("parse text");
+        IRGraph h;
+        parseText(text, h);
+        std::cout << "  parse throughput " << mb / (t.elapsedMs() / 1000.0) << " MB/s\n";
+    }
+}
@@ -0,0 +1,232 @@
+#include "analysis/dfs.h"
+#include "analysis/dominator_tree.h"
+#include "analysis/loop_analyzer.h"
+#include "analysis/rpo.h"
+#include "bench_functions.h"
+#include "ir/id_map.h"
+#include "ir/ir_graph.h"
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
+
+using namespace ir;
+using namespace analysis;
+
+// A long machine-generated-looking CFG: a straight chain with a small loop
+// every 8 blocks, a forward skip every 64 blocks and one outer back edge.
+static BasicBlock *buildHugeCFG(IRGraph &g, size_t n) {
+    std::vector<BasicBlock *> bbs;
+    bbs.reserve(n);
+    for (size_t i = 0; i < n; ++i)
+        bbs.push_back(g.createBlock());
+    for (size_t i = 0; i + 1 < n; ++i) {
+        bbs[i]->addSuccessor(bbs[i + 1]);
+        if (i % 8 == 7)
+            bbs[i]->addSuccessor(bbs[i - 6]);
+        if (i % 64 == 0 && i + 32 < n)
+            bbs[i]->addSuccessor(bbs[i + 32]);
+    }
+    bbs.back()->addSuccessor(bbs[1]);
+    return bbs.front();
+}
+
+// The recursive traversals the iterative ones replaced, kept as a
+// reference. They recurse once per block on a path, so only run them on a
+// small CFG.
+static void recursiveDFS(BasicBlock *start, std::vector<BasicBlock *> &preorder) {
+    preorder.clear();
+    BlockMap<bool> vis;
+    std::function<void(BasicBlock *)> dfs = [&](BasicBlock *b) {
+        if (!b || vis[b])
+            return;
+        vis[b] = true;
+        preorder.push_back(b);
+        for (auto *s : b->successors)
+            dfs(s);
+    };
+    dfs(start);
+}
+static void recursiveRPO(BasicBlock *start, std::vector<BasicBlock *> &rpo) {
+    std::vector<BasicBlock *> post;
+    BlockMap<bool> vis;
+    std::function<void(BasicBlock *)> dfs = [&](BasicBlock *b) {
+        if (!b || vis[b])
+            return;
+        vis[b] = true;
+        for (auto *s : b->successors)
+            dfs(s);
+        post.push_back(b);
+    };
+    dfs(start);
+    rpo.assign(post.rbegin(), post.rend());
+}
+
+// The recursive Lengauer-Tarjan DominatorTree::build used before its DFS
+// numbering and path compression became iterative.
+static void recursiveIdoms(BasicBlock *start, BlockMap<BasicBlock *> &idomOf) {
+    idomOf.clear();
+    BlockMap<int> idx;
+    std::vector<BasicBlock *> vertex{nullptr};
+    std::vector<int> parent{0};
+    int n = 0;
+    std::function<void(BasicBlock *, int)> dfs = [&](BasicBlock *b, int p) {
+        idx[b] = ++n;
+        vertex.push_back(b);
+        parent.push_back(p);
+        int me = n;
+        for (auto *s : b->successors)
+            if (s && !idx[s])
+                dfs(s, me);
+    };
+    dfs(start, 0);
+    std::vector<int> sdom(n + 1), idom(n + 1, 0), ancestor(n + 1, 0), label(n + 1);
+    std::vector<std::vector<int>> bucket(n + 1);
+    for (int i = 1; i <= n; ++i)
+        sdom[i] = label[i] = i;
+    std::function<void(int)> compress = [&](int v) {
+        if (ancestor[ancestor[v]] != 0) {
+            compress(ancestor[v]);
+            if (sdom[label[ancestor[v]]] < sdom[label[v]])
+                label[v] = label[ancestor[v]];
+            ancestor[v] = ancestor[ancestor[v]];
+        }
+    };
+    auto eval = [&](int v) {
+        if (ancestor[v] == 0)
+            return label[v];
+        compress(v);
+        return sdom[label[ancestor[v]]] < sdom[label[v]] ? label[ancestor[v]] : label[v];
+    };
+    for (int w = n; w >= 2; --w) {
+        for (auto *p : vertex[w]->predecessors)
+            if (int v = idx.get(p))
+                sdom[w] = std::min(sdom[w], sdom[eval(v)]);
+        bucket[sdom[w]].push_back(w);
+        ancestor[w] = parent[w];
+        for (int v : bucket[parent[w]]) {
+            int u = eval(v);
+            idom[v] = sdom[u] < sdom[v] ? u : sdom[v];
+        }
+        bucket[parent[w]].clear();
+    }
+    for (int w = 2; w <= n; ++w)
+        if (idom[w] != sdom[w])
+            idom[w] = idom[idom[w]];
+    for (int i = 2; i <= n; ++i)
+        idomOf[vertex[i]] = vertex[idom[i]];
+}
+
+// The recursive LoopAnalyzer::collectBackEdges.
+static void recursiveBackEdges(BasicBlock *start, std::vector<BasicBlock *> &preorder,
+                               std::vector<std::pair<BasicBlock *, BasicBlock *>> &backEdges) {
+    preorder.clear();
+    backEdges.clear();
+    enum Color { WHITE, GRAY, BLACK };
+    BlockMap<Color> color(0, WHITE);
+    std::function<void(BasicBlock *)> dfs = [&](BasicBlock *b) {
+        color[b] = GRAY;
+        preorder.push_back(b);
+        for (auto *s : b->successors) {
+            if (!s)
+                continue;
+            if (color[s] == WHITE)
+                dfs(s);
+            else if (color[s] == GRAY)
+                backEdges.emplace_back(b, s);
+        }
+        color[b] = BLACK;
+    };
+    dfs(start);
+}
+
+void benchTraversals(size_t scale) {
+    size_t n = 1000000 * scale;
+    std::cout << "CFG traversals, " << n << " blocks\n";
+    IRGraph g;
+    BasicBlock *entry = buildHugeCFG(g, n);
+
+    DFS dfs;
+    {
+        BenchTimer t("dfs");
+        dfs.run(entry);
+    }
+    RPO rpo;
+    {
+        BenchTimer t("rpo");
+        rpo.run(entry);
+    }
+    DominatorTree DT;
+    {
+        BenchTimer t("dominator tree");
+        DT.build(entry);
+    }
+    LoopAnalyzer LA;
+    {
+        BenchTimer t("loop analyzer");
+        LA.run(entry);
+    }
+    std::cout << "  visited " << dfs.preorder.size() << "/" << rpo.rpo.size()
+              << " blocks, " << LA.loops.size() << " loops\n";
+
+    // Iterative against recursive on a CFG shallow enough for the default
+    // stack, repeated to add up to the same number of blocks.
+    size_t small = 10000, reps = n / small;
+    std::cout << "CFG traversals, " << reps << " x " << small << " blocks, iterative vs recursive\n";
+    IRGraph h;
+    BasicBlock *hentry = buildHugeCFG(h, small);
+    std::vector<BasicBlock *> order;
+    bool same = true;
+    {
+        BenchTimer t("dfs");
+        for (size_t r = 0; r < reps; ++r)
+            dfs.run(hentry);
+    }
+    {
+        BenchTimer t("dfs, recursive");
+        for (size_t r = 0; r < reps; ++r)
+            recursiveDFS(hentry, order);
+    }
+    same &= order == dfs.preorder;
+    {
+        BenchTimer t("rpo");
+        for (size_t r = 0; r < reps; ++r)
+            rpo.run(hentry);
+    }
+    {
+        BenchTimer t("rpo, recursive");
+        for (size_t r = 0; r < reps; ++r)
+            recursiveRPO(hentry, order);
+    }
+    same &= order == rpo.rpo;
+    {
+        BenchTimer t("dominator tree");
+        for (size_t r = 0; r < reps; ++r)
+            DT.build(hentry);
+    }
+    BlockMap<BasicBlock *> idoms;
+    {
+        BenchTimer t("dominator tree, recursive");
+        for (size_t r = 0; r < reps; ++r)
+            recursiveIdoms(hentry, idoms);
+    }
+    for (auto *b : h.getBlocks())
+        same &= DT.idom(b) == idoms.get(b);
+    {
+        BenchTimer t("back edges");
+        for (size_t r = 0; r < reps; ++r) {
+            LA.preorder.clear();
+            LA.backEdges.clear();
+            LA.dfsNum.clear();
+            LA.collectBackEdges(hentry);
+        }
+    }
+    std::vector<std::pair<BasicBlock *, BasicBlock *>> backEdges;
+    {
+        BenchTimer t("back edges, recursive");
+        for (size_t r = 0; r < reps; ++r)
+            recursiveBackEdges(hentry, order, backEdges);
+    }
+    same &= order == LA.preorder && backEdges == LA.backEdges;
+    std::cout << "  same order" << (same ? "" : " MISMATCH") << "\n";
+}
@@ -0,0 +1,17 @@
+#include "bench_functions.h"
+#include <cstdlib>
+
+int main(int argc, char **argv) {
+    size_t scale = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1;
+    if (scale == 0)
+        scale = 1;
+
+    benchGraphBuild(scale);
+    benchTraversals(scale);
+    benchExecution(scale);
+    benchRegisterAllocation(scale);
+    benchSerialization(scale);
+    benchPipeline(scale);
+    benchParallelDriver(scale);
+    return 0;
+}
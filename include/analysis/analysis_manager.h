@@ -0,0 +1,112 @@
+#pragma once
+#include <cstdint>
+
+#include "analysis/dominator_tree.h"
+#include "analysis/loop_analyzer.h"
+#include "analysis/rpo.h"
+#include "ir/ir_graph.h"
+
+namespace analysis {
+
+// Lazily computes and caches the CFG analyses of one IRGraph. A cached result
+// stays valid until the graph's CFG epoch moves, i.e. until a block or an
+// edge is added or removed; instruction-only edits keep everything cached.
+class AnalysisManager {
+  public:
+    enum Kind {
+        RPO_ANALYSIS,
+        DOM_TREE,
+        LOOPS,
+        NUM_KINDS
+    };
+
+    static const char *kindName(Kind k) {
+        static const char *const names[NUM_KINDS] = {"rpo", "domtree", "loops"};
+        return names[k];
+    }
+
+  private:
+    static constexpr uint64_t kStale = ~uint64_t(0);
+
+    ir::IRGraph *graph_;
+    RPO rpo_;
+    DominatorTree dt_;
+    LoopAnalyzer loops_;
+    uint64_t epoch_[NUM_KINDS] = {kStale, kStale, kStale};
+    unsigned computed_[NUM_KINDS] = {};
+
+    bool fresh(Kind k) const {
+        return epoch_[k] == graph_->cfgEpoch();
+    }
+    void stamp(Kind k) {
+        epoch_[k] = graph_->cfgEpoch();
+        ++computed_[k];
+    }
+
+  public:
+    explicit AnalysisManager(ir::IRGraph &g) : graph_(&g) {
+    }
+
+    ir::IRGraph &graph() const {
+        return *graph_;
+    }
+
+    const RPO &getRPO() {
+        if (!fresh(RPO_ANALYSIS)) {
+            rpo_.run(graph_->entry());
+            stamp(RPO_ANALYSIS);
+        }
+        return rpo_;
+    }
+
+    const DominatorTree &getDomTree() {
+        if (!fresh(DOM_TREE)) {
+            dt_.build(graph_->entry());
+            stamp(DOM_TREE);
+        }
+        return dt_;
+    }
+
+    const LoopAnalyzer &getLoops() {
+        if (!fresh(LOOPS)) {
+            const DominatorTree &dt = getDomTree();
+            loops_.run(graph_->entry(), dt);
+            stamp(LOOPS);
+        }
+        return loops_;
+    }
+    // The cached loop nest for a pass that keeps it in step with its own CFG
+    // edits (e.g. preheader insertion). Those edits still move the epoch, so
+    // the next getLoops() recomputes it.
+    LoopAnalyzer &getLoopsForUpdate() {
+        getLoops();
+        return loops_;
+    }
+
+    // Repairs a cached dominator tree in place after CFG edits instead of
+    // dropping it. epochBefore is the CFG epoch the edits were made on top
+    // of; if the cached tree was not current at that point it stays stale.
+    void applyDomTreeUpdates(const std::vector<DominatorTree::Update> &updates, uint64_t epochBefore) {
+        if (epoch_[DOM_TREE] != epochBefore)
+            return;
+        dt_.applyUpdates(updates);
+        epoch_[DOM_TREE] = graph_->cfgEpoch();
+    }
+
+    bool isCached(Kind k) const {
+        return fresh(k);
+    }
+    // Number of times an analysis has been (re)computed; for tests and stats.
+    unsigned timesComputed(Kind k) const {
+        return computed_[k];
+    }
+
+    void invalidate(Kind k) {
+        epoch_[k] = kStale;
+    }
+    void invalidateAll() {
+        for (auto &e : epoch_)
+            e = kStale;
+    }
+};
+}
@@ -1,30 +1,42 @@
 #pragma once
+#include <utility>
 #include <vector>
-#include <unordered_set>
-#include <functional>
 
 namespace ir {
 class BasicBlock;
 }
 
 #include "ir/basic_block.h"
+#include "ir/id_map.h"
 
 namespace analysis {
 using ir::BasicBlock;
+using ir::BlockMap;
 struct DFS {
     std::vector<BasicBlock *> preorder;
 
     void run(BasicBlock *start) {
         preorder.clear();
-        std::unordered_set<BasicBlock *> vis;
-        std::function<void(BasicBlock *)> dfs = [&](BasicBlock *b) {
-            if (!b || !vis.insert(b).second)
-                return;
-            preorder.push_back(b); 
-            for (auto *s : b->successors)
-                dfs(s);
-        };
-        dfs(start);
+        if (!start)
+            return;
+        BlockMap<bool> vis;
+        std::vector<std::pair<BasicBlock *, size_t>> stack;
+        vis[start] = true;
+        preorder.push_back(start);
+        stack.emplace_back(start, 0);
+        while (!stack.empty()) {
+            auto &[b, i] = stack.back();
+            if (i == b->successors.size()) {
+                stack.pop_back();
+                continue;
+            }
+            BasicBlock *s = b->successors[i++];
+            if (!s || vis[s])
+                continue;
+            vis[s] = true;
+            preorder.push_back(s); 
+            stack.emplace_back(s, 0);
+        }
     }
 };
-} 
\ No newline at end of file
+}
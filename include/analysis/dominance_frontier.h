@@ -0,0 +1,104 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+
+#include "analysis/dominator_tree.h"
+#include "ir/basic_block.h"
+#include "ir/bit_vector.h"
+#include "ir/id_map.h"
+
+namespace analysis {
+using ir::BasicBlock;
+using ir::BitVector;
+using ir::BlockMap;
+
+struct DominanceFrontier {
+    // Per-block frontier as a sparse set; a block appears at most once.
+    BlockMap<std::vector<BasicBlock *>> frontier;
+    std::vector<BasicBlock *> blocks; // reachable blocks, dom-tree preorder
+
+  private:
+    const DominatorTree *dt_ = nullptr;
+    size_t idBound_ = 0;
+
+  public:
+    // Cooper-Harvey-Kennedy: for each block, walk up from every predecessor
+    // to the block's idom; each block passed has it in its DF. Single-pred
+    // blocks are not skipped since the root can be entered by a back edge.
+    void run(const DominatorTree &DT) {
+        frontier.clear();
+        blocks.clear();
+        dt_ = &DT;
+        idBound_ = 0;
+        if (!DT.root())
+            return;
+        std::vector<BasicBlock *> stack{DT.root()};
+        while (!stack.empty()) {
+            BasicBlock *b = stack.back();
+            stack.pop_back();
+            blocks.push_back(b);
+            idBound_ = std::max<size_t>(idBound_, b->id + 1);
+            for (auto *c : DT.children(b))
+                stack.push_back(c);
+        }
+        frontier.reserve(idBound_);
+        for (auto *b : blocks) {
+            BasicBlock *stop = DT.idom(b);
+            for (auto *p : b->predecessors) {
+                if (!p || !DT.isReachable(p))
+                    continue;
+                for (auto *runner = p; runner && runner != stop; runner = DT.idom(runner)) {
+                    auto &df = frontier[runner];
+                    if (!df.empty() && df.back() == b)
+                        break;
+                    df.push_back(b);
+                }
+            }
+        }
+    }
+
+    const std::vector<BasicBlock *> &of(const BasicBlock *b) const {
+        return frontier.get(b);
+    }
+
+    // Bound on block ids seen by run(); sizes bitsets passed to the queries.
+    size_t idBound() const {
+        return idBound_;
+    }
+
+    // Iterated dominance frontier of a set of definition blocks, i.e. the
+    // blocks that need a phi. With liveIn (indexed by block id), only blocks
+    // where the variable is live-in are returned, which yields pruned SSA.
+    // The result is sorted by block id.
+    std::vector<BasicBlock *> iterated(const std::vector<BasicBlock *> &defs,
+                                       const BitVector *liveIn = nullptr) const {
+        std::vector<BasicBlock *> result, work;
+        BitVector queued(idBound_), inIDF(idBound_);
+        for (auto *d : defs) {
+            if (!dt_ || !dt_->isReachable(d) || queued.test(d->id))
+                continue;
+            queued.set(d->id);
+            work.push_back(d);
+        }
+        while (!work.empty()) {
+            BasicBlock *x = work.back();
+            work.pop_back();
+            for (auto *y : of(x)) {
+                if (inIDF.test(y->id))
+                    continue;
+                if (liveIn && !liveIn->test(y->id))
+                    continue;
+                inIDF.set(y->id);
+                result.push_back(y);
+                if (!queued.test(y->id)) {
+                    queued.set(y->id);
+                    work.push_back(y);
+                }
+            }
+        }
+        std::sort(result.begin(), result.end(),
+                  [](BasicBlock *a, BasicBlock *b) { return a->id < b->id; });
+        return result;
+    }
+};
+}
@@ -1,27 +1,52 @@
 #pragma once
-#include <unordered_map>
 #include <vector>
 #include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <queue>
+#include <stdexcept>
+#include <utility>
 
 namespace ir {
 class BasicBlock;
 }
 
 #include "ir/basic_block.h"
+#include "ir/id_map.h"
 
 namespace analysis {
 using ir::BasicBlock;
+using ir::BlockMap;
 struct DominatorTree {
     
-    std::unordered_map<BasicBlock *, BasicBlock *> idom_map;
-    std::unordered_map<BasicBlock *, std::vector<BasicBlock *>> dom_children;
+    BlockMap<BasicBlock *> idom_map;
+    BlockMap<std::vector<BasicBlock *>> dom_children;
+
+    // A CFG edit for applyUpdates. The CFG must already contain the edit.
+    struct Update {
+        enum Kind {
+            Insert,
+            Delete
+        };
+        Kind kind;
+        BasicBlock *from;
+        BasicBlock *to;
+    };
+
+    // When set, every applyUpdates call checks the repaired tree against a
+    // fresh build() and throws std::runtime_error if they differ.
+    bool verifyUpdates = false;
 
   private:
+    BasicBlock *root_ = nullptr;
+    BlockMap<uint32_t> level_; 
     
-    std::unordered_map<BasicBlock *, int> idx_; 
+    BlockMap<int> idx_; 
     std::vector<BasicBlock *> vertex_;          
     std::vector<int> dsf_parent_, sdom_, idom_, ancestor_, label_;
     std::vector<std::vector<int>> cfg_pred_, bucket_;
+    std::vector<std::pair<BasicBlock *, size_t>> dfs_stack_;
+    std::vector<int> path_;
     int N_ = 0;
     
     void reset_() {
@@ -33,22 +58,33 @@ struct DominatorTree {
         N_ = 0;
     }
 
-    void dfsVisit_(BasicBlock *b, int pidx) {
-        if (!b || idx_.count(b))
-            return;
+    void number_(BasicBlock *b, int pidx) {
         idx_[b] = ++N_;
         vertex_.push_back(b);
         dsf_parent_.push_back(pidx);
-        int me = N_;
-        for (auto *s : b->successors) {
-            if (s && !idx_.count(s))
-                dfsVisit_(s, me);
+        dfs_stack_.emplace_back(b, 0);
+    }
+
+    void dfsVisit_(BasicBlock *start) {
+        if (!start)
+            return;
+        dfs_stack_.clear();
+        number_(start, 0);
+        while (!dfs_stack_.empty()) {
+            auto &[b, i] = dfs_stack_.back();
+            if (i == b->successors.size()) {
+                dfs_stack_.pop_back();
+                continue;
+            }
+            BasicBlock *s = b->successors[i++];
+            if (s && !idx_[s])
+                number_(s, idx_[b]);
         }
     }
     
     void dfsNumbering(BasicBlock *start) {
         reset_();
-        dfsVisit_(start, 0);
+        dfsVisit_(start);
     }
 
     inline void link(int p, int v) {
@@ -56,11 +92,14 @@ struct DominatorTree {
     }
 
     void compress(int v) {
-        if (ancestor_[ancestor_[v]] != 0) {
-            compress(ancestor_[v]);
-            if (sdom_[label_[ancestor_[v]]] < sdom_[label_[v]])
-                label_[v] = label_[ancestor_[v]];
-            ancestor_[v] = ancestor_[ancestor_[v]];
+        path_.clear();
+        for (int u = v; ancestor_[ancestor_[u]] != 0; u = ancestor_[u])
+            path_.push_back(u);
+        for (auto it = path_.rbegin(); it != path_.rend(); ++it) {
+            int u = *it;
+            if (sdom_[label_[ancestor_[u]]] < sdom_[label_[u]])
+                label_[u] = label_[ancestor_[u]];
+            ancestor_[u] = ancestor_[ancestor_[u]];
         }
     }
     int eval(int v) {
@@ -77,9 +116,9 @@ struct DominatorTree {
         cfg_pred_.assign(N_ + 1, {});
         for (int i = 1; i <= N_; ++i) {
             for (auto *p : vertex_[i]->predecessors) {
-                auto it = idx_.find(p);
-                if (it != idx_.end() && it->second != i)
-                    cfg_pred_[i].push_back(it->second);
+                int pi = idx_.get(p);
+                if (pi && pi != i)
+                    cfg_pred_[i].push_back(pi);
             }
             std::sort(cfg_pred_[i].begin(), cfg_pred_[i].end());
             cfg_pred_[i].erase(std::unique(cfg_pred_[i].begin(), cfg_pred_[i].end()), cfg_pred_[i].end());
@@ -87,10 +126,69 @@ struct DominatorTree {
     }
 
   public:
+    bool isReachable(const BasicBlock *b) const {
+        return level_.get(b) != 0;
+    }
+    // Depth in the dominator tree; the root is at level 1, 0 means unreachable.
+    uint32_t level(const BasicBlock *b) const {
+        return level_.get(b);
+    }
+    BasicBlock *root() const {
+        return root_;
+    }
+
+    // Dominance via pre-order intervals on the dominator tree: A dominates B
+    // iff B's pre-order index falls inside A's subtree range. Every block
+    // dominates an unreachable block; an unreachable block dominates only
+    // itself. Numbers are (re)computed lazily after build or updates.
+    bool dominates(const BasicBlock *a, const BasicBlock *b) const {
+        if (a == b || !isReachable(b))
+            return true;
+        if (!isReachable(a))
+            return false;
+        ensureNumbers_();
+        uint32_t ib = pre_.get(b);
+        return pre_.get(a) <= ib && ib <= last_.get(a);
+    }
+    bool properlyDominates(const BasicBlock *a, const BasicBlock *b) const {
+        return a != b && dominates(a, b);
+    }
+
+    // Nearest common dominator of two reachable blocks, nullptr otherwise.
+    // O(1) per query after an O(n log n) sparse table over the pre-order
+    // sequence: for non-nested a and b, the shallowest node strictly after a
+    // and up to b in pre-order is a child of their LCA.
+    BasicBlock *findNearestCommonDominator(BasicBlock *a, BasicBlock *b) const {
+        if (!isReachable(a) || !isReachable(b))
+            return nullptr;
+        if (dominates(a, b))
+            return a;
+        if (dominates(b, a))
+            return b;
+        ensureSparseTable_();
+        uint32_t lo = pre_.get(a), hi = pre_.get(b);
+        if (lo > hi)
+            std::swap(lo, hi);
+        ++lo;
+        uint32_t k = log2_(hi - lo + 1);
+        uint32_t x = sparse_[k][lo], y = sparse_[k][hi + 1 - (1u << k)];
+        BasicBlock *m = level_.get(order_[x]) <= level_.get(order_[y]) ? order_[x] : order_[y];
+        return idom(m);
+    }
+    BasicBlock *idom(const BasicBlock *b) const {
+        return idom_map.get(b);
+    }
+    const std::vector<BasicBlock *> &children(const BasicBlock *b) const {
+        return dom_children.get(b);
+    }
     
     void build(BasicBlock *r) {
         idom_map.clear();
         dom_children.clear();
+        level_.clear();
+        root_ = r;
+        rebuilt_ = true;
+        numbers_valid_ = sparse_valid_ = false;
         if (!r)
             return;
         
@@ -144,9 +242,497 @@ struct DominatorTree {
             BasicBlock *b = vertex_[i];
             BasicBlock *p = (idom_[i] ? vertex_[idom_[i]] : nullptr);
             idom_map[b] = p;
+            level_[b] = p ? level_[p] + 1 : 1;
             if (p)
                 dom_children[p].push_back(b);
         }
     }
+
+    void insertEdge(BasicBlock *from, BasicBlock *to) {
+        applyUpdates({{Update::Insert, from, to}});
+    }
+    void deleteEdge(BasicBlock *from, BasicBlock *to) {
+        applyUpdates({{Update::Delete, from, to}});
+    }
+
+    // Repairs the tree after a batch of CFG edits, in the style of the
+    // semi-NCA dynamic algorithms: insertions run a depth-based search from
+    // the new edge's target and re-parent the affected nodes; deletions
+    // recompute only the subtree below the nearest common dominator of the
+    // edge's endpoints. Updates are replayed in order against a view of the
+    // CFG where the not yet processed edits are undone.
+    void applyUpdates(const std::vector<Update> &updates) {
+        if (!root_)
+            return;
+        rebuilt_ = false;
+        for (auto &u : updates)
+            addPending_(u);
+        for (auto &u : updates) {
+            removePending_(u);
+            if (rebuilt_)
+                continue;
+            if (u.kind == Update::Insert)
+                insertEdge_(u.from, u.to);
+            else
+                deleteEdge_(u.from, u.to);
+        }
+        for (auto *b : pendingTouched_) {
+            hiddenSucc_[b].clear();
+            hiddenPred_[b].clear();
+            extraSucc_[b].clear();
+            extraPred_[b].clear();
+        }
+        pendingTouched_.clear();
+        numbers_valid_ = sparse_valid_ = false;
+        if (verifyUpdates && !verify())
+            throw std::runtime_error("incremental dominator update diverged");
+    }
+
+    // Checks the current tree against one built from scratch.
+    bool verify() const {
+        DominatorTree fresh;
+        fresh.build(root_);
+        for (int i = 1; i <= fresh.N_; ++i) {
+            BasicBlock *b = fresh.vertex_[i];
+            if (!isReachable(b) || idom(b) != fresh.idom(b) || level_.get(b) != fresh.level_.get(b))
+                return false;
+            if (BasicBlock *p = idom(b)) {
+                auto &ch = children(p);
+                if (std::count(ch.begin(), ch.end(), b) != 1)
+                    return false;
+            }
+        }
+        int ours = 0;
+        std::vector<BasicBlock *> stack;
+        if (root_)
+            stack.push_back(root_);
+        while (!stack.empty()) {
+            BasicBlock *b = stack.back();
+            stack.pop_back();
+            ++ours;
+            for (auto *c : children(b))
+                stack.push_back(c);
+        }
+        return ours == fresh.N_;
+    }
+
+  private:
+    mutable BlockMap<uint32_t> pre_, last_;
+    mutable std::vector<BasicBlock *> order_;
+    mutable std::vector<std::vector<uint32_t>> sparse_;
+    mutable bool numbers_valid_ = false;
+    mutable bool sparse_valid_ = false;
+
+    static uint32_t log2_(uint32_t x) {
+        uint32_t k = 0;
+        while ((2u << k) <= x)
+            ++k;
+        return k;
+    }
+
+    void ensureNumbers_() const {
+        if (numbers_valid_)
+            return;
+        order_.clear();
+        std::vector<std::pair<BasicBlock *, size_t>> stack;
+        if (root_) {
+            pre_[root_] = 0;
+            order_.push_back(root_);
+            stack.emplace_back(root_, 0);
+        }
+        while (!stack.empty()) {
+            auto &[b, i] = stack.back();
+            auto &ch = dom_children.get(b);
+            if (i == ch.size()) {
+                last_[b] = static_cast<uint32_t>(order_.size() - 1);
+                stack.pop_back();
+                continue;
+            }
+            BasicBlock *c = ch[i++];
+            pre_[c] = static_cast<uint32_t>(order_.size());
+            order_.push_back(c);
+            stack.emplace_back(c, 0);
+        }
+        numbers_valid_ = true;
+    }
+
+    void ensureSparseTable_() const {
+        ensureNumbers_();
+        if (sparse_valid_)
+            return;
+        uint32_t n = static_cast<uint32_t>(order_.size());
+        sparse_.resize(log2_(n) + 1);
+        sparse_[0].resize(n);
+        for (uint32_t i = 0; i < n; ++i)
+            sparse_[0][i] = i;
+        for (uint32_t k = 1; (1u << k) <= n; ++k) {
+            auto &prev = sparse_[k - 1];
+            auto &cur = sparse_[k];
+            cur.resize(n - (1u << k) + 1);
+            for (uint32_t i = 0; i + (1u << k) <= n; ++i) {
+                uint32_t x = prev[i], y = prev[i + (1u << (k - 1))];
+                cur[i] = level_.get(order_[x]) <= level_.get(order_[y]) ? x : y;
+            }
+        }
+        sparse_valid_ = true;
+    }
+
+    // Edits of the current batch not replayed yet: inserted edges are hidden,
+    // deleted edges are still visible.
+    BlockMap<std::vector<BasicBlock *>> hiddenSucc_, hiddenPred_, extraSucc_, extraPred_;
+    std::vector<BasicBlock *> pendingTouched_;
+    bool rebuilt_ = false;
+
+    BlockMap<int> sn_num_;
+    std::vector<BasicBlock *> sn_vertex_;
+    std::vector<int> sn_parent_, sn_semi_, sn_label_, sn_idom_, sn_eval_stack_;
+    std::vector<std::vector<int>> sn_preds_;
+    std::vector<std::pair<BasicBlock *, int>> sn_work_;
+    std::vector<BasicBlock *> scratch_;
+    BlockMap<bool> mark_;
+    std::vector<BasicBlock *> marked_;
+
+    static void eraseOne_(std::vector<BasicBlock *> &v, BasicBlock *b) {
+        auto it = std::find(v.begin(), v.end(), b);
+        if (it != v.end())
+            v.erase(it);
+    }
+
+    void addPending_(const Update &u) {
+        if (u.kind == Update::Insert) {
+            hiddenSucc_[u.from].push_back(u.to);
+            hiddenPred_[u.to].push_back(u.from);
+        } else {
+            extraSucc_[u.from].push_back(u.to);
+            extraPred_[u.to].push_back(u.from);
+        }
+        pendingTouched_.push_back(u.from);
+        pendingTouched_.push_back(u.to);
+    }
+    void removePending_(const Update &u) {
+        if (u.kind == Update::Insert) {
+            eraseOne_(hiddenSucc_[u.from], u.to);
+            eraseOne_(hiddenPred_[u.to], u.from);
+        } else {
+            eraseOne_(extraSucc_[u.from], u.to);
+            eraseOne_(extraPred_[u.to], u.from);
+        }
+    }
+
+    static void view_(const std::vector<BasicBlock *> &real, const std::vector<BasicBlock *> &hidden,
+                      const std::vector<BasicBlock *> &extra, std::vector<BasicBlock *> &out) {
+        out.clear();
+        for (auto *b : real)
+            if (b)
+                out.push_back(b);
+        for (auto *h : hidden)
+            eraseOne_(out, h);
+        out.insert(out.end(), extra.begin(), extra.end());
+    }
+    void successors_(BasicBlock *b, std::vector<BasicBlock *> &out) const {
+        view_(b->successors, hiddenSucc_.get(b), extraSucc_.get(b), out);
+    }
+    void predecessors_(BasicBlock *b, std::vector<BasicBlock *> &out) const {
+        view_(b->predecessors, hiddenPred_.get(b), extraPred_.get(b), out);
+    }
+
+    bool mark(BasicBlock *b) {
+        if (mark_[b])
+            return false;
+        mark_[b] = true;
+        marked_.push_back(b);
+        return true;
+    }
+    void clearMarks() {
+        for (auto *b : marked_)
+            mark_[b] = false;
+        marked_.clear();
+    }
+
+    BasicBlock *ncaByLevel_(BasicBlock *a, BasicBlock *b) const {
+        while (a != b) {
+            if (level_.get(a) < level_.get(b))
+                std::swap(a, b);
+            a = idom_map.get(a);
+        }
+        return a;
+    }
+
+    void setIdom_(BasicBlock *b, BasicBlock *p) {
+        BasicBlock *old = idom_map[b];
+        if (old == p)
+            return;
+        if (old)
+            eraseOne_(dom_children[old], b);
+        idom_map[b] = p;
+        if (p)
+            dom_children[p].push_back(b);
+    }
+
+    void relevel_(BasicBlock *b) {
+        std::vector<BasicBlock *> stack{b};
+        while (!stack.empty()) {
+            BasicBlock *x = stack.back();
+            stack.pop_back();
+            BasicBlock *p = idom_map[x];
+            uint32_t want = p ? level_[p] + 1 : 1;
+            if (x != b && level_[x] == want)
+                continue;
+            level_[x] = want;
+            for (auto *c : dom_children[x])
+                stack.push_back(c);
+        }
+    }
+
+    void eraseNode_(BasicBlock *b) {
+        if (BasicBlock *p = idom_map[b])
+            eraseOne_(dom_children[p], b);
+        idom_map[b] = nullptr;
+        dom_children[b].clear();
+        level_[b] = 0;
+    }
+
+    // Semi-NCA over the part of the CFG reachable from `root` through edges
+    // accepted by `descend`. Predecessors are collected during the DFS, so
+    // only edges inside the explored region take part.
+    template <typename Descend>
+    void sncaDFS_(BasicBlock *root, Descend descend) {
+        sn_vertex_.assign(1, nullptr);
+        sn_parent_.assign(1, 0);
+        sn_preds_.resize(1);
+        sn_work_.clear();
+        sn_work_.emplace_back(root, 0);
+        std::vector<BasicBlock *> succs;
+        while (!sn_work_.empty()) {
+            auto [b, p] = sn_work_.back();
+            sn_work_.pop_back();
+            if (int n = sn_num_[b]) {
+                sn_preds_[n].push_back(p);
+                continue;
+            }
+            int n = static_cast<int>(sn_vertex_.size());
+            sn_num_[b] = n;
+            sn_vertex_.push_back(b);
+            sn_parent_.push_back(p);
+            if (sn_preds_.size() <= static_cast<size_t>(n))
+                sn_preds_.emplace_back();
+            sn_preds_[n].clear();
+            if (p)
+                sn_preds_[n].push_back(p);
+            successors_(b, succs);
+            for (auto it = succs.rbegin(); it != succs.rend(); ++it)
+                if (descend(b, *it))
+                    sn_work_.emplace_back(*it, n);
+        }
+    }
+
+    int sncaEval_(int v, int lastLinked) {
+        if (sn_parent_[v] < lastLinked)
+            return sn_label_[v];
+        sn_eval_stack_.clear();
+        do {
+            sn_eval_stack_.push_back(v);
+            v = sn_parent_[v];
+        } while (sn_parent_[v] >= lastLinked);
+        int p = v;
+        int pLabel = sn_label_[p];
+        do {
+            v = sn_eval_stack_.back();
+            sn_eval_stack_.pop_back();
+            sn_parent_[v] = sn_parent_[p];
+            if (sn_semi_[pLabel] < sn_semi_[sn_label_[v]])
+                sn_label_[v] = pLabel;
+            else
+                pLabel = sn_label_[v];
+            p = v;
+        } while (!sn_eval_stack_.empty());
+        return sn_label_[v];
+    }
+
+    void sncaRun_() {
+        int n = static_cast<int>(sn_vertex_.size()) - 1;
+        sn_idom_.assign(sn_parent_.begin(), sn_parent_.end());
+        sn_semi_.resize(n + 1);
+        sn_label_.resize(n + 1);
+        for (int i = 1; i <= n; ++i)
+            sn_semi_[i] = sn_label_[i] = i;
+        for (int i = n; i >= 2; --i) {
+            sn_semi_[i] = sn_parent_[i];
+            for (int v : sn_preds_[i]) {
+                int s = sn_semi_[sncaEval_(v, i + 1)];
+                if (s < sn_semi_[i])
+                    sn_semi_[i] = s;
+            }
+        }
+        for (int i = 2; i <= n; ++i) {
+            int cand = sn_idom_[i];
+            while (cand > sn_semi_[i])
+                cand = sn_idom_[cand];
+            sn_idom_[i] = cand;
+        }
+    }
+
+    void sncaReset_() {
+        for (size_t i = 1; i < sn_vertex_.size(); ++i)
+            sn_num_[sn_vertex_[i]] = 0;
+    }
+
+    // Hangs the region computed by sncaRun_ below attachTo.
+    void sncaAttach_(BasicBlock *attachTo) {
+        for (size_t i = 1; i < sn_vertex_.size(); ++i) {
+            BasicBlock *b = sn_vertex_[i];
+            BasicBlock *p = i == 1 ? attachTo : sn_vertex_[sn_idom_[i]];
+            setIdom_(b, p);
+            level_[b] = p ? level_[p] + 1 : 1;
+        }
+        sncaReset_();
+    }
+
+    void rebuild_() {
+        build(root_);
+    }
+
+    void insertEdge_(BasicBlock *from, BasicBlock *to) {
+        if (!level_.get(from))
+            return;
+        if (!level_.get(to))
+            insertUnreachable_(from, to);
+        else
+            insertReachable_(from, to);
+    }
+
+    void insertUnreachable_(BasicBlock *from, BasicBlock *to) {
+        std::vector<std::pair<BasicBlock *, BasicBlock *>> discovered;
+        sncaDFS_(to, [&](BasicBlock *f, BasicBlock *t) {
+            if (level_.get(t)) {
+                discovered.emplace_back(f, t);
+                return false;
+            }
+            return true;
+        });
+        sncaRun_();
+        sncaAttach_(from);
+        for (auto &[f, t] : discovered)
+            insertReachable_(f, t);
+    }
+
+    // Depth-based search: a node v is affected iff some path from `to`
+    // reaches it without passing a node shallower than v, and v sits more
+    // than one level below the nearest common dominator. Affected nodes
+    // become children of that dominator.
+    void insertReachable_(BasicBlock *from, BasicBlock *to) {
+        BasicBlock *ncd = ncaByLevel_(from, to);
+        uint32_t ncdLevel = level_.get(ncd);
+        if (ncdLevel + 1 >= level_.get(to))
+            return;
+        auto deeper = [this](BasicBlock *a, BasicBlock *b) { return level_.get(a) < level_.get(b); };
+        std::priority_queue<BasicBlock *, std::vector<BasicBlock *>, decltype(deeper)> bucket(deeper);
+        std::vector<BasicBlock *> affected, unaffected, succs;
+        bucket.push(to);
+        mark(to);
+        while (!bucket.empty()) {
+            BasicBlock *tn = bucket.top();
+            bucket.pop();
+            affected.push_back(tn);
+            uint32_t cur = level_.get(tn);
+            while (true) {
+                successors_(tn, succs);
+                for (auto *s : succs) {
+                    uint32_t sl = level_.get(s);
+                    if (sl == 0 || sl <= ncdLevel + 1 || !mark(s))
+                        continue;
+                    if (sl > cur)
+                        unaffected.push_back(s);
+                    else
+                        bucket.push(s);
+                }
+                if (unaffected.empty())
+                    break;
+                tn = unaffected.back();
+                unaffected.pop_back();
+            }
+        }
+        clearMarks();
+        for (auto *a : affected)
+            setIdom_(a, ncd);
+        for (auto *a : affected)
+            relevel_(a);
+    }
+
+    void deleteEdge_(BasicBlock *from, BasicBlock *to) {
+        if (!level_.get(from) || !level_.get(to))
+            return;
+        successors_(from, scratch_);
+        if (std::find(scratch_.begin(), scratch_.end(), to) != scratch_.end())
+            return;
+        if (ncaByLevel_(from, to) == to)
+            return;
+        if (from != idom_map.get(to) || hasProperSupport_(to))
+            deleteReachable_(from, to);
+        else
+            deleteUnreachable_(to);
+    }
+
+    bool hasProperSupport_(BasicBlock *b) {
+        predecessors_(b, scratch_);
+        for (auto *p : scratch_) {
+            if (!level_.get(p))
+                continue;
+            if (ncaByLevel_(b, p) != b)
+                return true;
+        }
+        return false;
+    }
+
+    void deleteReachable_(BasicBlock *from, BasicBlock *to) {
+        BasicBlock *top = ncaByLevel_(from, to);
+        BasicBlock *prev = idom_map.get(top);
+        if (!prev) {
+            rebuild_();
+            return;
+        }
+        uint32_t lvl = level_.get(top);
+        sncaDFS_(top, [&](BasicBlock *, BasicBlock *t) { return level_.get(t) > lvl; });
+        sncaRun_();
+        sncaAttach_(prev);
+    }
+
+    // `to` lost its last incoming path, so its whole subtree goes away.
+    // Blocks outside the subtree that were entered from it may get a new
+    // idom; the subtree under the highest such dominator is recomputed.
+    void deleteUnreachable_(BasicBlock *to) {
+        uint32_t lvl = level_.get(to);
+        std::vector<BasicBlock *> outside;
+        sncaDFS_(to, [&](BasicBlock *, BasicBlock *t) {
+            uint32_t l = level_.get(t);
+            if (l > lvl)
+                return true;
+            if (l && mark(t))
+                outside.push_back(t);
+            return false;
+        });
+        clearMarks();
+        BasicBlock *minNode = to;
+        for (auto *n : outside) {
+            BasicBlock *ncd = ncaByLevel_(n, to);
+            if (ncd != n && level_.get(ncd) < level_.get(minNode))
+                minNode = ncd;
+        }
+        if (!idom_map.get(minNode)) {
+            sncaReset_();
+            rebuild_();
+            return;
+        }
+        for (size_t i = sn_vertex_.size() - 1; i >= 1; --i)
+            eraseNode_(sn_vertex_[i]);
+        sncaReset_();
+        if (minNode == to)
+            return;
+        BasicBlock *prev = idom_map.get(minNode);
+        uint32_t ml = level_.get(minNode);
+        sncaDFS_(minNode, [&](BasicBlock *, BasicBlock *t) { return level_.get(t) > ml; });
+        sncaRun_();
+        sncaAttach_(prev);
+    }
 };
 } 
\ No newline at end of file
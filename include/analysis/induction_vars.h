@@ -0,0 +1,277 @@
+#pragma once
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "analysis/loop_analyzer.h"
+#include "ir/id_map.h"
+#include "ir/inst.h"
+
+namespace analysis {
+using ir::Inst;
+using ir::SSAValue;
+
+// A header phi that starts at init on entry and advances by a constant step
+// (through a chain of addis) on every back edge.
+struct BasicIV {
+    ir::PhiInst *phi = nullptr;
+    SSAValue *init = nullptr;
+    SSAValue *next = nullptr;
+    uint64_t step = 0;
+};
+
+// value = scale * base + offset (mod 2^64) on every iteration of loop,
+// where base is the result of one of its basic IVs.
+struct InductionVar {
+    const Loop *loop = nullptr;
+    SSAValue *base = nullptr;
+    uint64_t scale = 0;
+    uint64_t offset = 0;
+};
+
+// The test that ends a counted loop: its only exiting block, run once per
+// iteration, keeps looping while iv < bound (or iv <= bound if inclusive).
+// iv has scale 1 and bound is loop-invariant.
+struct LoopExitTest {
+    BasicBlock *exiting = nullptr;
+    BasicBlock *exit = nullptr;
+    SSAValue *iv = nullptr;
+    SSAValue *bound = nullptr;
+    bool inclusive = false;
+};
+
+struct LoopIVs {
+    std::vector<BasicIV> basics;
+    std::optional<LoopExitTest> exitTest;
+    // Times the header runs, when the start and bound of the test are
+    // constants.
+    std::optional<uint64_t> tripCount;
+};
+
+// Induction variables of every reducible loop found by a LoopAnalyzer:
+// basic IVs are recognized on header phis, derived ones are addis of an IV
+// and muls of an IV by a movi constant inside the same loop. Loops that
+// exit through a single compare of an IV against an invariant bound get an
+// exit test and, with constant operands, a trip count. An IV that could
+// wrap before the test fails gives no trip count.
+class InductionVars {
+    std::unordered_map<const Loop *, LoopIVs> loops_;
+    ir::ValueMap<InductionVar> ivs_;
+    // Blocks of the loop being analyzed; cleared after each loop, so one
+    // table serves them all.
+    BlockMap<bool> in_;
+    const LoopAnalyzer *LA_ = nullptr;
+
+    static bool isConst(const SSAValue *v, uint64_t &out) {
+        if (!v || !v->def || v->def->opcode() != Opcode::MOVI_U64)
+            return false;
+        out = static_cast<const ir::MoviInst *>(v->def)->imm();
+        return true;
+    }
+
+    static bool definedIn(const SSAValue *v, const BlockMap<bool> &in) {
+        return v && v->def && v->def->parent() && in.get(v->def->parent());
+    }
+
+    static std::optional<BasicIV> matchBasic(ir::PhiInst *P, const BlockMap<bool> &in) {
+        BasicIV iv;
+        iv.phi = P;
+        for (size_t i = 0; i < P->numIncomings(); ++i) {
+            SSAValue *v = P->incomingValue(i);
+            SSAValue *&slot = in.get(P->incomingBlock(i)) ? iv.next : iv.init;
+            if (!v || (slot && slot != v))
+                return std::nullopt;
+            slot = v;
+        }
+        if (!iv.init || !iv.next)
+            return std::nullopt;
+        for (SSAValue *v = iv.next; v != P->result();) {
+            if (!definedIn(v, in) || v->def->opcode() != Opcode::ADDI_U64)
+                return std::nullopt;
+            auto *A = static_cast<const ir::AddiInst *>(v->def);
+            iv.step += A->imm();
+            v = A->src();
+        }
+        if (iv.step == 0)
+            return std::nullopt;
+        return iv;
+    }
+
+    void analyzeLoop(const Loop &L) {
+        for (auto *b : L.blocks)
+            in_[b] = true;
+        analyzeLoopIn(L);
+        for (auto *b : L.blocks)
+            in_[b] = false;
+    }
+
+    void analyzeLoopIn(const Loop &L) {
+        LoopIVs &info = loops_[&L];
+        info = LoopIVs{};
+        std::vector<SSAValue *> work;
+        for (Inst *I : L.header->insts) {
+            if (I->opcode() != Opcode::PHI_U64)
+                break;
+            auto *P = static_cast<ir::PhiInst *>(I);
+            if (auto iv = matchBasic(P, in_)) {
+                info.basics.push_back(*iv);
+                ivs_[P->result()] = {&L, P->result(), 1, 0};
+                work.push_back(P->result());
+            }
+        }
+        if (info.basics.empty())
+            return;
+
+        // Derived IVs are found through the users of IVs, so only the
+        // loop's IV arithmetic is visited. Each has exactly one IV operand
+        // and is reached once.
+        while (!work.empty()) {
+            SSAValue *v = work.back();
+            work.pop_back();
+            for (const Inst *I : v->users) {
+                bool arith = I->opcode() == Opcode::ADDI_U64 || I->opcode() == Opcode::MUL_U64;
+                if (!arith || !I->parent() || !in_.get(I->parent()))
+                    continue;
+                SSAValue *r = I->result();
+                const Loop *owner = ivs_.get(r).loop;
+                if (!owner)
+                    owner = (ivs_[r] = derive(I, L)).loop;
+                if (owner == &L)
+                    work.push_back(r);
+            }
+        }
+        findExitTest(L, in_, info);
+    }
+
+    InductionVar derive(const Inst *I, const Loop &L) const {
+        if (I->opcode() == Opcode::ADDI_U64) {
+            auto *A = static_cast<const ir::AddiInst *>(I);
+            InductionVar src = ivOfIn(A->src(), &L);
+            return src.loop ? InductionVar{&L, src.base, src.scale, src.offset + A->imm()} : InductionVar{};
+        }
+        auto *M = static_cast<const ir::MulInst *>(I);
+        uint64_t k;
+        for (auto [x, c] : {std::pair{M->left(), M->right()}, std::pair{M->right(), M->left()}}) {
+            InductionVar src = ivOfIn(x, &L);
+            if (src.loop && isConst(c, k))
+                return {&L, src.base, src.scale * k, src.offset * k};
+        }
+        return {};
+    }
+
+    InductionVar ivOfIn(const SSAValue *v, const Loop *L) const {
+        InductionVar iv = v ? ivs_.get(v) : InductionVar{};
+        return iv.loop == L ? iv : InductionVar{};
+    }
+
+    void findExitTest(const Loop &L, const BlockMap<bool> &in, LoopIVs &info) {
+        BasicBlock *exiting = nullptr;
+        for (auto *b : L.blocks)
+            for (auto *s : b->successors)
+                if (!in.get(s)) {
+                    if (exiting && exiting != b)
+                        return;
+                    exiting = b;
+                }
+        if (!exiting || exiting->successors.size() != 2)
+            return;
+        for (auto *latch : L.latches)
+            if (!LA_->domTree->dominates(exiting, latch))
+                return;
+        const Inst *T = exiting->insts.back();
+        if (!T || T->opcode() != Opcode::JA_U64)
+            return;
+        const ir::CmpInst *C = nullptr;
+        for (const Inst *I = T->prev(); I && !C; I = I->prev())
+            if (I->opcode() == Opcode::CMP_U64)
+                C = static_cast<const ir::CmpInst *>(I);
+        if (!C)
+            return;
+
+        // ja is taken when left > right.
+        bool exitOnTaken = !in.get(static_cast<const ir::JaInst *>(T)->target());
+        LoopExitTest test;
+        test.exiting = exiting;
+        test.exit = exiting->successors[0] == exiting->successors[1] ? nullptr
+                    : in.get(exiting->successors[0])                ? exiting->successors[1]
+                                                                    : exiting->successors[0];
+        if (!test.exit)
+            return;
+        auto invariant = [&](const SSAValue *v) { return v && !definedIn(v, in); };
+        InductionVar iv;
+        if (exitOnTaken && invariant(C->right()) && (iv = ivOfIn(C->left(), &L)).loop) {
+            // exit when iv > bound: loop while iv <= bound.
+            test.iv = C->left();
+            test.bound = C->right();
+            test.inclusive = true;
+        } else if (!exitOnTaken && invariant(C->left()) && (iv = ivOfIn(C->right(), &L)).loop) {
+            // loop while bound > iv.
+            test.iv = C->right();
+            test.bound = C->left();
+            test.inclusive = false;
+        } else {
+            return;
+        }
+        if (iv.scale != 1)
+            return;
+        info.exitTest = test;
+
+        const BasicIV *basic = nullptr;
+        for (auto &b : info.basics)
+            if (b.phi->result() == iv.base)
+                basic = &b;
+        uint64_t init, bound;
+        // Counting down, or a step large enough to look negative, is left
+        // alone.
+        if (!basic || basic->step > std::numeric_limits<int64_t>::max() ||
+            !isConst(basic->init, init) || !isConst(test.bound, bound))
+            return;
+        uint64_t s = basic->step, start = init + iv.offset;
+        uint64_t max = std::numeric_limits<uint64_t>::max();
+        uint64_t passes;
+        if (test.inclusive) {
+            if (bound > max - s)
+                return;
+            passes = start > bound ? 0 : (bound - start) / s + 1;
+        } else {
+            if (bound != 0 && bound - 1 > max - s)
+                return;
+            passes = start >= bound ? 0 : (bound - start + s - 1) / s;
+        }
+        info.tripCount = passes + 1;
+    }
+
+  public:
+    void run(const LoopAnalyzer &LA) {
+        LA_ = &LA;
+        loops_.clear();
+        ivs_.clear();
+        for (auto &L : LA.loops)
+            if (!L->irreducible)
+                analyzeLoop(*L);
+    }
+    // Analyzes L again after code was added to it, e.g. start values put
+    // in the preheader of a loop inside it. Values already found to be IVs
+    // keep their forms.
+    void update(const Loop &L) {
+        if (!L.irreducible)
+            analyzeLoop(L);
+    }
+
+    // The linear form of v if it is an IV of some loop; loop is null if not.
+    InductionVar ivOf(const SSAValue *v) const {
+        return ivs_.get(v);
+    }
+    const LoopIVs *loopInfo(const Loop *L) const {
+        auto it = loops_.find(L);
+        return it != loops_.end() ? &it->second : nullptr;
+    }
+    std::optional<uint64_t> tripCount(const Loop *L) const {
+        const LoopIVs *info = loopInfo(L);
+        return info ? info->tripCount : std::nullopt;
+    }
+};
+}
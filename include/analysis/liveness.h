@@ -0,0 +1,347 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "analysis/loop_analyzer.h"
+#include "analysis/rpo.h"
+#include "ir/bit_vector.h"
+#include "ir/id_map.h"
+#include "ir/ir_graph.h"
+
+namespace analysis {
+using ir::BitVector;
+using ir::Inst;
+using ir::SSAValue;
+
+// Inclusive range of instruction numbers.
+struct LiveRange {
+    uint32_t start;
+    uint32_t end;
+};
+
+// Where one value is live, as sorted, disjoint ranges.
+struct LiveInterval {
+    std::vector<LiveRange> ranges;
+
+    bool empty() const {
+        return ranges.empty();
+    }
+    uint32_t start() const {
+        return ranges.front().start;
+    }
+    uint32_t end() const {
+        return ranges.back().end;
+    }
+    bool covers(uint32_t pos) const {
+        auto it = std::upper_bound(ranges.begin(), ranges.end(), pos,
+                                   [](uint32_t p, const LiveRange &r) { return p < r.start; });
+        return it != ranges.begin() && std::prev(it)->end >= pos;
+    }
+};
+
+// Per-block live-in/live-out sets as dense bitsets over SSAValue::id, using
+// the two-pass algorithm of Brandner et al. ("Computing Liveness Sets for
+// SSA-Form Programs"): one post-order pass over the CFG without loop back
+// edges, then one walk of the loop tree that adds whatever is live at a
+// loop header to every block of the loop. Irreducible loops break the
+// second pass, so they fall back to an iterative fixpoint.
+//
+// A phi defines its result at the top of its block and uses each incoming
+// value at the end of the matching predecessor only.
+class Liveness {
+  public:
+    BlockMap<BitVector> liveIn, liveOut;
+    bool usedFixpoint = false;
+
+    // Filled by buildIntervals(). Argument values are defined at 0; block b
+    // spans [blockFrom[b], blockTo[b]], its phis define at blockFrom[b], its
+    // k-th other instruction reads operands at blockFrom[b] + 2k + 2 and
+    // writes its result one later, and phi operands are read at blockTo of
+    // the predecessor.
+    BlockMap<uint32_t> blockFrom, blockTo;
+    ir::ValueMap<LiveInterval> intervals;
+
+  private:
+    size_t numValues_ = 0;
+    BlockMap<std::vector<uint32_t>> uevar_, defs_, phiDefs_, phiUses_;
+    BlockMap<std::vector<BasicBlock *>> backSuccs_;
+    std::vector<const Inst *> instAt_;
+
+    static bool isPhi(const Inst *I) {
+        return I->opcode() == Opcode::PHI_U64;
+    }
+
+    void collectLocalSets(BasicBlock *b, BitVector &defined) {
+        auto &ue = uevar_[b];
+        auto &df = defs_[b];
+        for (const Inst *I : b->insts) {
+            if (isPhi(I)) {
+                phiDefs_[b].push_back(I->result()->id);
+                continue;
+            }
+            for (const auto &op : I->operands())
+                if (op.isValue() && op.value() && !defined.test(op.value()->id))
+                    ue.push_back(op.value()->id);
+            if (auto *r = I->result()) {
+                df.push_back(r->id);
+                defined.set(r->id);
+            }
+        }
+        for (uint32_t id : df)
+            defined.reset(id);
+        for (auto *s : b->successors)
+            for (const Inst *I : s->insts) {
+                if (!isPhi(I))
+                    break;
+                if (auto *v = static_cast<const ir::PhiInst *>(I)->incomingFor(b))
+                    phiUses_[b].push_back(v->id);
+            }
+    }
+
+    bool isBackEdge(const BasicBlock *from, const BasicBlock *to) const {
+        const auto &bs = backSuccs_.get(from);
+        return std::find(bs.begin(), bs.end(), to) != bs.end();
+    }
+
+    // live = PhiUses(b) + sum over successors s of (LiveIn(s) - PhiDefs(s)),
+    // optionally skipping back edges; LiveIn = uses + (live - defs) + phis.
+    bool transfer(BasicBlock *b, bool skipBackEdges, BitVector &out, BitVector &tmp) {
+        out.clear();
+        for (auto *s : b->successors) {
+            if (skipBackEdges && isBackEdge(b, s))
+                continue;
+            tmp = liveIn[s];
+            for (uint32_t id : phiDefs_.get(s))
+                tmp.reset(id);
+            out.unionWith(tmp);
+        }
+        for (uint32_t id : phiUses_.get(b))
+            out.set(id);
+        tmp = out;
+        for (uint32_t id : defs_.get(b))
+            tmp.reset(id);
+        for (uint32_t id : uevar_.get(b))
+            tmp.set(id);
+        for (uint32_t id : phiDefs_.get(b))
+            tmp.set(id);
+        bool changed = out != liveOut[b] || tmp != liveIn[b];
+        liveOut[b] = out;
+        liveIn[b] = tmp;
+        return changed;
+    }
+
+    // Pass 1: post-order over the forward-edge DAG.
+    void dagPass(BasicBlock *entry) {
+        BitVector out(numValues_), tmp(numValues_);
+        BlockMap<bool> vis;
+        std::vector<std::pair<BasicBlock *, size_t>> stack;
+        vis[entry] = true;
+        stack.emplace_back(entry, 0);
+        while (!stack.empty()) {
+            auto &[b, i] = stack.back();
+            if (i == b->successors.size()) {
+                BasicBlock *done = b;
+                stack.pop_back();
+                transfer(done, true, out, tmp);
+                continue;
+            }
+            BasicBlock *s = b->successors[i++];
+            if (!s || vis[s] || isBackEdge(b, s))
+                continue;
+            vis[s] = true;
+            stack.emplace_back(s, 0);
+        }
+    }
+
+    // Pass 2: walk the loop tree top-down. Values live into a header but not
+    // defined by its phis are live throughout the loop; inner headers
+    // receive them first so the inner walk carries them on.
+    void loopPass(const LoopAnalyzer &LA) {
+        std::unordered_map<const Loop *, std::vector<BasicBlock *>> direct;
+        BlockMap<bool> seen;
+        for (auto &L : LA.loops)
+            for (auto *b : L->blocks)
+                if (!seen[b]) {
+                    seen[b] = true;
+                    direct[L.get()].push_back(b);
+                }
+        BitVector live(numValues_);
+        std::vector<const Loop *> stack(LA.rootLoop->children.rbegin(), LA.rootLoop->children.rend());
+        while (!stack.empty()) {
+            const Loop *L = stack.back();
+            stack.pop_back();
+            BasicBlock *h = L->header;
+            live = liveIn[h];
+            for (uint32_t id : phiDefs_.get(h))
+                live.reset(id);
+            for (auto *b : direct[L]) {
+                liveIn[b].unionWith(live);
+                liveOut[b].unionWith(live);
+            }
+            for (auto *C : L->children) {
+                liveIn[C->header].unionWith(live);
+                liveOut[C->header].unionWith(live);
+                stack.push_back(C);
+            }
+        }
+    }
+
+    void fixpoint(BasicBlock *entry) {
+        RPO rpo;
+        rpo.run(entry);
+        BitVector out(numValues_), tmp(numValues_);
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (size_t k = rpo.rpo.size(); k-- > 0;)
+                changed |= transfer(rpo.rpo[k], false, out, tmp);
+        }
+    }
+
+  public:
+    void run(BasicBlock *entry, const LoopAnalyzer &LA, size_t numValues) {
+        liveIn.clear();
+        liveOut.clear();
+        uevar_.clear();
+        defs_.clear();
+        phiDefs_.clear();
+        phiUses_.clear();
+        backSuccs_.clear();
+        numValues_ = numValues;
+        usedFixpoint = false;
+        if (!entry)
+            return;
+
+        BitVector defined(numValues);
+        for (auto *b : LA.preorder) {
+            liveIn[b] = BitVector(numValues);
+            liveOut[b] = BitVector(numValues);
+            collectLocalSets(b, defined);
+        }
+        for (auto &[from, to] : LA.backEdges)
+            backSuccs_[from].push_back(to);
+
+        bool irreducible = false;
+        for (auto &L : LA.loops)
+            irreducible |= L->irreducible;
+        if (irreducible) {
+            usedFixpoint = true;
+            fixpoint(entry);
+            return;
+        }
+        dagPass(entry);
+        loopPass(LA);
+    }
+
+    void run(const ir::IRGraph &g) {
+        LoopAnalyzer LA;
+        LA.run(g.entry());
+        run(g.entry(), LA, g.valueIdBound());
+    }
+
+    bool isLiveIn(const SSAValue *v, const BasicBlock *b) const {
+        return liveIn.get(b).test(v->id);
+    }
+    bool isLiveOut(const SSAValue *v, const BasicBlock *b) const {
+        return liveOut.get(b).test(v->id);
+    }
+
+    // Numbers the instructions of the given block order (normally a
+    // permutation of the reachable blocks) and builds one interval per value.
+    void buildIntervals(const ir::IRGraph &g, const std::vector<BasicBlock *> &order) {
+        blockFrom.clear();
+        blockTo.clear();
+        intervals.clear();
+        instAt_.assign(1, nullptr);
+        uint32_t pos = 2;
+        for (auto *b : order) {
+            blockFrom[b] = pos;
+            instAt_.push_back(nullptr);
+            for (const Inst *I : b->insts)
+                if (!isPhi(I)) {
+                    pos += 2;
+                    instAt_.push_back(I);
+                }
+            pos += 2;
+            blockTo[b] = pos;
+            instAt_.push_back(nullptr);
+            pos += 2;
+        }
+
+        std::vector<uint32_t> openEnd(numValues_, 0);
+        BitVector open(numValues_);
+        std::vector<SSAValue *> byId(numValues_, nullptr);
+        for (auto &a : g.args())
+            if (a.val)
+                byId[a.val->id] = a.val;
+        for (auto *b : order)
+            for (const Inst *I : b->insts)
+                if (auto *r = I->result())
+                    byId[r->id] = r;
+        auto add = [&](SSAValue *v, uint32_t s, uint32_t e) {
+            auto &r = intervals[v].ranges;
+            if (!r.empty() && r.back().start <= e + 1) // appended backwards
+                r.back().start = std::min(r.back().start, s);
+            else
+                r.push_back({s, e});
+        };
+        for (size_t k = order.size(); k-- > 0;) {
+            BasicBlock *b = order[k];
+            uint32_t from = blockFrom[b], to = blockTo[b];
+            open.clear();
+            liveOut.get(b).forEach([&](size_t id) {
+                open.set(id);
+                openEnd[id] = to;
+            });
+            uint32_t p = to;
+            for (const Inst *I = b->insts.back(); I && !isPhi(I); I = I->prev()) {
+                p -= 2;
+                if (auto *r = I->result()) {
+                    add(r, p + 1, open.test(r->id) ? openEnd[r->id] : p + 1);
+                    open.reset(r->id);
+                }
+                for (const auto &op : I->operands()) {
+                    SSAValue *v = op.isValue() ? op.value() : nullptr;
+                    if (!v || open.test(v->id))
+                        continue;
+                    open.set(v->id);
+                    openEnd[v->id] = p;
+                }
+            }
+            for (const Inst *I : b->insts) {
+                if (!isPhi(I))
+                    break;
+                SSAValue *r = I->result();
+                add(r, from, open.test(r->id) ? openEnd[r->id] : from);
+                open.reset(r->id);
+            }
+            open.forEach([&](size_t id) { add(byId[id], from, openEnd[id]); });
+        }
+        // Ranges were appended back to front; arguments start at 0.
+        for (auto &a : g.args()) {
+            if (!a.val)
+                continue;
+            auto &r = intervals[a.val].ranges;
+            if (r.empty())
+                r.push_back({0, 0});
+            else
+                r.back().start = 0;
+        }
+        for (SSAValue *v : byId)
+            if (v)
+                std::reverse(intervals[v].ranges.begin(), intervals[v].ranges.end());
+    }
+
+    // Instruction at an odd or even position inside a block, or null for
+    // block boundaries.
+    const Inst *instAt(uint32_t pos) const {
+        size_t k = pos / 2;
+        return k < instAt_.size() ? instAt_[k] : nullptr;
+    }
+    const LiveInterval &interval(const SSAValue *v) const {
+        return intervals.get(v);
+    }
+};
+}
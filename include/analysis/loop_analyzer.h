@@ -1,19 +1,21 @@
 #pragma once
 #include <memory>
-#include <unordered_map>
 #include <vector>
 #include <algorithm>
-#include <unordered_set>
+#include <utility>
 
 namespace ir {
 class BasicBlock;
 }
 
+#include "analysis/dominator_tree.h"
 #include "ir/basic_block.h"
+#include "ir/id_map.h"
 #include "ir/opcode.h"
 
 namespace analysis {
 using ir::BasicBlock;
+using ir::BlockMap;
 struct Loop {
     BasicBlock *header = nullptr;
     std::vector<BasicBlock *> latches; 
@@ -27,23 +29,31 @@ struct Loop {
 struct LoopAnalyzer {
     
     std::vector<std::unique_ptr<Loop>> loops;             
-    std::unordered_map<BasicBlock *, Loop *> loopOfBlock; 
+    BlockMap<Loop *> loopOfBlock; 
     Loop *rootLoop = nullptr;                             
+    std::unique_ptr<Loop> rootOwner;
     
     DominatorTree DT;
-    std::unordered_map<BasicBlock *, int> dfsNum;                 
+    const DominatorTree *domTree = nullptr;
+    BlockMap<int> dfsNum;                 
     std::vector<BasicBlock *> preorder;                           
     std::vector<std::pair<BasicBlock *, BasicBlock *>> backEdges; 
 
     void run(BasicBlock *entry) {
+        DT.build(entry);
+        run(entry, DT);
+    }
+
+    // Reuses an already built dominator tree for the same CFG.
+    void run(BasicBlock *entry, const DominatorTree &dt) {
         loops.clear();
         loopOfBlock.clear();
         rootLoop = nullptr;
+        rootOwner.reset();
         backEdges.clear();
         dfsNum.clear();
         preorder.clear();
-        
-        DT.build(entry);
+        domTree = &dt;
 
         collectBackEdges(entry);
         populateLoops(entry);
@@ -56,53 +66,55 @@ struct LoopAnalyzer {
             GRAY,
             BLACK
         };
-        std::unordered_map<BasicBlock *, Color> color;
+        BlockMap<Color> color(0, WHITE);
 
         int time = 0;
-        std::function<void(BasicBlock *)> dfs = [&](BasicBlock *b) {
-            if (!b)
-                return;
+        std::vector<std::pair<BasicBlock *, size_t>> stack;
+        auto enter = [&](BasicBlock *b) {
             color[b] = GRAY;
             dfsNum[b] = ++time;
             preorder.push_back(b);
-
-            for (auto *s : b->successors) {
-                if (!s)
-                    continue;
-                Color cs = color.count(s) ? color[s] : WHITE;
-                if (cs == WHITE) {
-                    dfs(s);
-                } else if (cs == GRAY) {
-                    
-                    backEdges.emplace_back(b, s);
-                }
-            }
-            color[b] = BLACK;
+            stack.emplace_back(b, 0);
         };
-        dfs(start);
+        if (!start)
+            return;
+        enter(start);
+        while (!stack.empty()) {
+            auto &[b, i] = stack.back();
+            if (i == b->successors.size()) {
+                color[b] = BLACK;
+                stack.pop_back();
+                continue;
+            }
+            BasicBlock *s = b->successors[i++];
+            if (!s)
+                continue;
+            Color cs = color[s];
+            if (cs == WHITE) {
+                enter(s);
+            } else if (cs == GRAY) {
+                
+                backEdges.emplace_back(b, s);
+            }
+        }
     }
     
     void populateLoops(BasicBlock *entry) {
         
-        std::unordered_map<BasicBlock *, std::vector<BasicBlock *>> srcs;
-        for (auto &[n, d] : backEdges)
-            srcs[d].push_back(n);
-
-        
+        BlockMap<std::vector<BasicBlock *>> srcs;
         std::vector<BasicBlock *> headers;
-        headers.reserve(srcs.size());
-        for (auto &kv : srcs)
-            headers.push_back(kv.first);
+        for (auto &[n, d] : backEdges) {
+            if (srcs[d].empty())
+                headers.push_back(d);
+            srcs[d].push_back(n);
+        }
         std::sort(headers.begin(), headers.end(),
                   [&](auto *a, auto *b) { return dfsNum[a] > dfsNum[b]; });
 
         
-        auto dominates = [&](BasicBlock *A, BasicBlock *B) {
-            for (auto *cur = B; cur; cur = DT.idom_map[cur])
-                if (cur == A)
-                    return true;
-            return false;
-        };
+        BlockMap<Loop *> inLoop;
+        BlockMap<Loop *> headerOf;
+
 
         for (auto *H : headers) {
             auto L = std::make_unique<Loop>();
@@ -110,12 +122,28 @@ struct LoopAnalyzer {
             
             for (auto *src : srcs[H]) {
                 L->latches.push_back(src);
-                if (!dominates(H, src))
+                if (!domTree->dominates(H, src))
                     L->irreducible = true;
             }
             
-            std::unordered_set<BasicBlock *> inLoop;
-            inLoop.insert(H);
+            inLoop[H] = L.get();
+            headerOf[H] = L.get();
+            L->blocks.push_back(H);
+
+            // An inner loop found inside L is attached through its
+            // outermost already-built ancestor, so nesting deeper than two
+            // levels keeps the middle loops. Headers are checked separately
+            // since loopOfBlock skips them.
+            auto adopt = [&](Loop *inner) {
+                if (!inner)
+                    return;
+                while (inner->parent)
+                    inner = inner->parent;
+                if (inner != L.get()) {
+                    inner->parent = L.get();
+                    L->children.push_back(inner);
+                }
+            };
 
             std::vector<BasicBlock *> stack;
             for (auto *s : srcs[H])
@@ -124,35 +152,25 @@ struct LoopAnalyzer {
             while (!stack.empty()) {
                 BasicBlock *X = stack.back();
                 stack.pop_back();
-                if (!inLoop.insert(X).second)
+                if (inLoop[X] == L.get())
                     continue; 
+                inLoop[X] = L.get();
+                L->blocks.push_back(X);
                 
-                if (auto it = loopOfBlock.find(X); it != loopOfBlock.end()) {
-                    Loop *inner = it->second;
-                    
-                    if (inner != L.get() && !isAncestor(inner, L.get())) {
-                        inner->parent = L.get();
-                        L->children.push_back(inner);
-                    }
-                    
-                }
+                adopt(loopOfBlock[X]);
+                adopt(headerOf[X]);
                 
                 for (auto *P : X->predecessors) {
-                    if (!P || P == H) {
-                        inLoop.insert(H);
+                    if (!P || P == H)
                         continue;
-                    }
                     stack.push_back(P);
                 }
             }
 
-            L->blocks.assign(inLoop.begin(), inLoop.end());
-            
             for (auto *b : L->blocks) {
                 if (b == H)
                     continue;
-                auto it = loopOfBlock.find(b);
-                if (it == loopOfBlock.end())
+                if (!loopOfBlock[b])
                     loopOfBlock[b] = L.get();
             }
 
@@ -160,16 +178,10 @@ struct LoopAnalyzer {
         }
     }
     
-    static bool isAncestor(Loop *L1, Loop *L2) {
-        for (auto *p = L2 ? L2->parent : nullptr; p; p = p->parent)
-            if (p == L1)
-                return true;
-        return false;
-    }
-    
     void buildLoopTree(BasicBlock *entry) {
         
-        rootLoop = new Loop();
+        rootOwner = std::make_unique<Loop>();
+        rootLoop = rootOwner.get();
         rootLoop->header = nullptr; 
         
         for (auto &up : loops) {
@@ -1,31 +1,42 @@
 #pragma once
+#include <utility>
 #include <vector>
-#include <unordered_set>
-#include <functional>
 namespace ir {
 class BasicBlock;
 }
 
 #include "ir/basic_block.h"
+#include "ir/id_map.h"
 
 namespace analysis {
 using ir::BasicBlock;
+using ir::BlockMap;
 struct RPO {
     std::vector<BasicBlock *> rpo;
 
     void run(BasicBlock *start) {
         rpo.clear();
+        if (!start)
+            return;
         std::vector<BasicBlock *> post;
-        std::unordered_set<BasicBlock *> vis;
-        std::function<void(BasicBlock *)> dfs = [&](BasicBlock *b) {
-            if (!b || !vis.insert(b).second)
-                return;
-            for (auto *s : b->successors)
-                dfs(s);
-            post.push_back(b); 
-        };
-        dfs(start);
+        BlockMap<bool> vis;
+        std::vector<std::pair<BasicBlock *, size_t>> stack;
+        vis[start] = true;
+        stack.emplace_back(start, 0);
+        while (!stack.empty()) {
+            auto &[b, i] = stack.back();
+            if (i == b->successors.size()) {
+                post.push_back(b); 
+                stack.pop_back();
+                continue;
+            }
+            BasicBlock *s = b->successors[i++];
+            if (!s || vis[s])
+                continue;
+            vis[s] = true;
+            stack.emplace_back(s, 0);
+        }
         rpo.assign(post.rbegin(), post.rend()); 
     }
 };
-} 
\ No newline at end of file
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <system_error>
+#include <utility>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace codegen {
+
+// Page-granular buffer for generated code. The bytes are written while the
+// mapping is read-write, then it is flipped to read-execute so it is never
+// writable and executable at the same time.
+class ExecutableMemory {
+    void *base_ = nullptr;
+    size_t mapped_ = 0;
+    size_t size_ = 0;
+
+    void release() {
+        if (base_)
+            munmap(base_, mapped_);
+        base_ = nullptr;
+        mapped_ = size_ = 0;
+    }
+
+  public:
+    ExecutableMemory() = default;
+    ExecutableMemory(const uint8_t *code, size_t size) {
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        mapped_ = (size + page - 1) / page * page;
+        if (mapped_ == 0)
+            mapped_ = page;
+        void *p = mmap(nullptr, mapped_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+            throw std::system_error(errno, std::generic_category(), "mmap");
+        base_ = p;
+        size_ = size;
+        std::memcpy(base_, code, size);
+        if (mprotect(base_, mapped_, PROT_READ | PROT_EXEC) != 0) {
+            int err = errno;
+            release();
+            throw std::system_error(err, std::generic_category(), "mprotect");
+        }
+    }
+    ~ExecutableMemory() {
+        release();
+    }
+
+    ExecutableMemory(const ExecutableMemory &) = delete;
+    ExecutableMemory &operator=(const ExecutableMemory &) = delete;
+    ExecutableMemory(ExecutableMemory &&o) noexcept
+        : base_(std::exchange(o.base_, nullptr)), mapped_(std::exchange(o.mapped_, 0)),
+          size_(std::exchange(o.size_, 0)) {
+    }
+    ExecutableMemory &operator=(ExecutableMemory &&o) noexcept {
+        if (this != &o) {
+            release();
+            base_ = std::exchange(o.base_, nullptr);
+            mapped_ = std::exchange(o.mapped_, 0);
+            size_ = std::exchange(o.size_, 0);
+        }
+        return *this;
+    }
+
+    const void *data() const {
+        return base_;
+    }
+    size_t size() const {
+        return size_;
+    }
+};
+}
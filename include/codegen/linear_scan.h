@@ -0,0 +1,305 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <unordered_set>
+#include <vector>
+
+#include "analysis/liveness.h"
+#include "analysis/loop_analyzer.h"
+#include "analysis/rpo.h"
+#include "ir/id_map.h"
+#include "ir/ir_graph.h"
+
+namespace codegen {
+using analysis::Loop;
+using ir::BasicBlock;
+using ir::BlockMap;
+using ir::Inst;
+using ir::SSAValue;
+
+// Where a value lives for its whole lifetime: one of the allocator's
+// registers (an index into the target's allocatable set) or a spill slot.
+struct Location {
+    enum class Kind : uint8_t {
+        None,
+        Reg,
+        Slot
+    };
+    Kind kind = Kind::None;
+    uint32_t index = 0;
+
+    bool isReg() const {
+        return kind == Kind::Reg;
+    }
+    bool isSlot() const {
+        return kind == Kind::Slot;
+    }
+};
+
+// Conservative single-range lifetime [start, end] in linear positions.
+struct LiveInterval {
+    SSAValue *value = nullptr;
+    uint32_t start = UINT32_MAX;
+    uint32_t end = 0;
+    float weight = 0;
+};
+
+// Linear-scan register allocation (Poletto & Sarkar) over a block order that
+// follows RPO but keeps every loop body contiguous, so intervals of values
+// live across a loop do not stretch over unrelated code. Each use or def
+// adds 10^loopDepth to a value's spill weight; when registers run out the
+// interval with the lowest weight is spilled for its whole lifetime. Spill
+// slots are reused once their intervals expire, so numSpillSlots follows
+// the peak number of spilled values live at once.
+//
+// Positions are those of analysis::Liveness over this order; phi operands
+// are used at the end of the predecessor, where edge moves go.
+struct LinearScan {
+    std::vector<BasicBlock *> order; // reachable blocks only
+    BlockMap<uint32_t> loopDepth;
+    analysis::Liveness liveness; // block sets and positions
+    std::vector<LiveInterval> intervals;
+    ir::ValueMap<Location> location;
+    std::vector<bool> regUsed;
+    uint32_t numSpillSlots = 0;
+
+  private:
+    size_t numRegs_;
+    size_t numSpilled_ = 0;
+    ir::ValueMap<uint32_t> intervalOf_; // 1-based; 0 = none
+
+    static bool isPhi(const Inst *I) {
+        return I->opcode() == Opcode::PHI_U64;
+    }
+
+    void computeOrder(const ir::IRGraph &g, const analysis::LoopAnalyzer &LA) {
+        analysis::RPO rpo;
+        rpo.run(g.entry());
+
+        BlockMap<uint32_t> rpoIndex;
+        BlockMap<bool> reachable;
+        for (size_t i = 0; i < rpo.rpo.size(); ++i) {
+            rpoIndex[rpo.rpo[i]] = static_cast<uint32_t>(i);
+            reachable[rpo.rpo[i]] = true;
+        }
+        // LoopAnalyzer lists inner loops before the loops enclosing them.
+        BlockMap<Loop *> innermost;
+        for (auto &L : LA.loops)
+            for (auto *b : L->blocks)
+                if (!innermost[b])
+                    innermost[b] = L.get();
+        auto depthOf = [&](const Loop *L) {
+            uint32_t d = 0;
+            for (; L && L != LA.rootLoop; L = L->parent)
+                ++d;
+            return d;
+        };
+        for (auto *b : rpo.rpo)
+            loopDepth[b] = depthOf(innermost[b]);
+
+        BlockMap<bool> emitted;
+        std::unordered_set<const Loop *> entered;
+        std::vector<std::pair<const Loop *, std::vector<BasicBlock *>>> stack;
+        stack.emplace_back(LA.rootLoop, rpo.rpo);
+        std::vector<size_t> cursor{0};
+        while (!stack.empty()) {
+            auto &[region, blocks] = stack.back();
+            size_t &i = cursor.back();
+            if (i == blocks.size()) {
+                stack.pop_back();
+                cursor.pop_back();
+                continue;
+            }
+            BasicBlock *b = blocks[i++];
+            if (emitted[b])
+                continue;
+            // Find the loop directly inside region that contains b.
+            const Loop *L = innermost[b];
+            while (L && L != region && L->parent != region)
+                L = L->parent;
+            if (L && L != region && entered.insert(L).second) {
+                std::vector<BasicBlock *> body;
+                for (auto *x : L->blocks)
+                    if (reachable.get(x))
+                        body.push_back(x);
+                std::sort(body.begin(), body.end(), [&](BasicBlock *x, BasicBlock *y) {
+                    return rpoIndex.get(x) < rpoIndex.get(y);
+                });
+                --i; // revisit b inside the loop's region
+                stack.emplace_back(L, std::move(body));
+                cursor.push_back(0);
+                continue;
+            }
+            emitted[b] = true;
+            order.push_back(b);
+        }
+    }
+
+    LiveInterval &intervalFor(SSAValue *v) {
+        uint32_t &idx = intervalOf_[v];
+        if (!idx) {
+            intervals.emplace_back();
+            intervals.back().value = v;
+            idx = static_cast<uint32_t>(intervals.size());
+        }
+        return intervals[idx - 1];
+    }
+
+    // Hulls of the liveness intervals, weighted by the loop depth of every
+    // use and def (phi operands count in the predecessor).
+    void buildIntervals(const ir::IRGraph &g) {
+        liveness.buildIntervals(g, order);
+        for (auto &a : g.args())
+            if (a.val)
+                intervalFor(a.val).weight += 1;
+        for (auto *b : order) {
+            float w = 1;
+            for (uint32_t d = 0; d < std::min<uint32_t>(loopDepth.get(b), 8); ++d)
+                w *= 10;
+            for (const Inst *I : b->insts) {
+                if (auto *r = I->result())
+                    intervalFor(r).weight += w;
+                if (isPhi(I))
+                    continue;
+                for (const auto &op : I->operands())
+                    if (op.isValue() && op.value())
+                        intervalFor(op.value()).weight += w;
+            }
+            for (auto *s : b->successors)
+                for (const Inst *I : s->insts) {
+                    if (!isPhi(I))
+                        break;
+                    if (auto *v = static_cast<const ir::PhiInst *>(I)->incomingFor(b))
+                        intervalFor(v).weight += w;
+                }
+        }
+        for (auto &it : intervals) {
+            const analysis::LiveInterval &li = liveness.interval(it.value);
+            it.start = li.start();
+            it.end = li.end();
+        }
+    }
+
+    void allocate() {
+        // Bucket intervals by start so the scan stays linear.
+        uint32_t maxPos = 0;
+        for (auto &it : intervals)
+            maxPos = std::max(maxPos, it.start);
+        std::vector<uint32_t> bucketStart(maxPos + 2, 0);
+        for (auto &it : intervals)
+            ++bucketStart[it.start + 1];
+        for (size_t p = 1; p < bucketStart.size(); ++p)
+            bucketStart[p] += bucketStart[p - 1];
+        std::vector<uint32_t> sorted(intervals.size());
+        for (uint32_t i = 0; i < intervals.size(); ++i)
+            sorted[bucketStart[intervals[i].start]++] = i;
+
+        std::vector<uint32_t> freeRegs;
+        for (size_t r = numRegs_; r-- > 0;)
+            freeRegs.push_back(static_cast<uint32_t>(r));
+        std::vector<uint32_t> active; // interval indices, at most numRegs_
+        regUsed.assign(numRegs_, false);
+
+        // (end, slot) of spilled intervals still live, and (end of the last
+        // occupant, slot) of free slots; both smallest end first. An evicted
+        // interval is spilled from its own start, so it may only take a slot
+        // whose last occupant ended before that.
+        using SlotUse = std::pair<uint32_t, uint32_t>;
+        using SlotHeap = std::priority_queue<SlotUse, std::vector<SlotUse>, std::greater<SlotUse>>;
+        SlotHeap spilled, freeSlots;
+        auto spill = [&](uint32_t i) {
+            const LiveInterval &it = intervals[i];
+            uint32_t slot;
+            if (!freeSlots.empty() && freeSlots.top().first < it.start) {
+                slot = freeSlots.top().second;
+                freeSlots.pop();
+            } else {
+                slot = numSpillSlots++;
+            }
+            location[it.value] = {Location::Kind::Slot, slot};
+            spilled.push({it.end, slot});
+            ++numSpilled_;
+        };
+        for (uint32_t i : sorted) {
+            const LiveInterval &cur = intervals[i];
+            while (!spilled.empty() && spilled.top().first < cur.start) {
+                freeSlots.push(spilled.top());
+                spilled.pop();
+            }
+            for (size_t a = 0; a < active.size();) {
+                if (intervals[active[a]].end < cur.start) {
+                    freeRegs.push_back(location[intervals[active[a]].value].index);
+                    active[a] = active.back();
+                    active.pop_back();
+                } else {
+                    ++a;
+                }
+            }
+            if (!freeRegs.empty()) {
+                uint32_t r = freeRegs.back();
+                freeRegs.pop_back();
+                location[cur.value] = {Location::Kind::Reg, r};
+                regUsed[r] = true;
+                active.push_back(i);
+                continue;
+            }
+            // Cheapest active interval; among equals the one ending last.
+            size_t victim = active.size();
+            for (size_t a = 0; a < active.size(); ++a) {
+                const LiveInterval &c = intervals[active[a]];
+                if (victim == active.size() || c.weight < intervals[active[victim]].weight ||
+                    (c.weight == intervals[active[victim]].weight &&
+                     c.end > intervals[active[victim]].end))
+                    victim = a;
+            }
+            if (victim < active.size()) {
+                const LiveInterval &v = intervals[active[victim]];
+                if (v.weight < cur.weight || (v.weight == cur.weight && v.end > cur.end)) {
+                    uint32_t r = location[v.value].index;
+                    spill(active[victim]);
+                    location[cur.value] = {Location::Kind::Reg, r};
+                    active[victim] = i;
+                    continue;
+                }
+            }
+            spill(i);
+        }
+    }
+
+  public:
+    explicit LinearScan(size_t numRegs) : numRegs_(numRegs) {
+    }
+
+    void run(const ir::IRGraph &g) {
+        order.clear();
+        loopDepth.clear();
+        intervals.clear();
+        location.clear();
+        intervalOf_.clear();
+        numSpillSlots = 0;
+        numSpilled_ = 0;
+        if (!g.entry())
+            return;
+        analysis::LoopAnalyzer LA;
+        LA.run(g.entry());
+        computeOrder(g, LA);
+        liveness.run(g.entry(), LA, g.valueIdBound());
+        buildIntervals(g);
+        allocate();
+    }
+
+    size_t numRegs() const {
+        return numRegs_;
+    }
+    // Values spilled, as opposed to the slots they share.
+    size_t numSpilled() const {
+        return numSpilled_;
+    }
+    const LiveInterval *intervalOf(const SSAValue *v) const {
+        uint32_t idx = intervalOf_.get(v);
+        return idx ? &intervals[idx - 1] : nullptr;
+    }
+};
+}
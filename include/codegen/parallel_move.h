@@ -0,0 +1,81 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace codegen {
+
+// One copy dst <- src between abstract locations (registers, stack slots or
+// interpreter registers, depending on the client).
+struct Move {
+    uint32_t dst;
+    uint32_t src;
+
+    bool operator==(const Move &o) const {
+        return dst == o.dst && src == o.src;
+    }
+};
+
+// Orders a set of moves that must happen simultaneously, as on a CFG edge
+// carrying several phis, into a sequence of plain copies. A location that
+// is still to be read is never overwritten first; cycles are broken by
+// saving one location to scratch. Destinations must be distinct.
+//
+// Linear in the number of moves: each move counts the moves still reading
+// its destination, and a worklist holds the ones no move reads any more.
+inline std::vector<Move> sequentializeMoves(std::vector<Move> pending, uint32_t scratch) {
+    constexpr uint32_t kNone = UINT32_MAX;
+    std::vector<Move> out;
+    out.reserve(pending.size() + 1);
+    for (size_t i = 0; i < pending.size();) {
+        if (pending[i].dst == pending[i].src) {
+            pending[i] = pending.back();
+            pending.pop_back();
+        } else {
+            ++i;
+        }
+    }
+    const uint32_t n = static_cast<uint32_t>(pending.size());
+    std::unordered_map<uint32_t, uint32_t> byDst;
+    byDst.reserve(n);
+    for (uint32_t i = 0; i < n; ++i)
+        byDst.emplace(pending[i].dst, i);
+    // source[i]: the move whose destination move i reads, if any.
+    std::vector<uint32_t> source(n, kNone), readers(n, 0), ready;
+    for (uint32_t i = 0; i < n; ++i)
+        if (auto it = byDst.find(pending[i].src); it != byDst.end()) {
+            source[i] = it->second;
+            ++readers[it->second];
+        }
+    for (uint32_t i = 0; i < n; ++i)
+        if (readers[i] == 0)
+            ready.push_back(i);
+    std::vector<bool> done(n, false);
+    uint32_t next = 0;
+    for (size_t left = n; left > 0;) {
+        if (ready.empty()) {
+            // Only cycles are left: free one destination by saving it and
+            // redirecting its one reader, found by walking the cycle.
+            while (done[next])
+                ++next;
+            uint32_t k = next;
+            while (source[k] != next)
+                k = source[k];
+            out.push_back({scratch, pending[next].dst});
+            pending[k].src = scratch;
+            source[k] = kNone;
+            readers[next] = 0;
+            ready.push_back(next);
+        }
+        uint32_t i = ready.back();
+        ready.pop_back();
+        out.push_back(pending[i]);
+        done[i] = true;
+        --left;
+        if (source[i] != kNone && --readers[source[i]] == 0)
+            ready.push_back(source[i]);
+    }
+    return out;
+}
+}
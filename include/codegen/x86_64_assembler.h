@@ -0,0 +1,237 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace codegen {
+namespace x86_64 {
+
+enum Reg : uint8_t {
+    RAX,
+    RCX,
+    RDX,
+    RBX,
+    RSP,
+    RBP,
+    RSI,
+    RDI,
+    R8,
+    R9,
+    R10,
+    R11,
+    R12,
+    R13,
+    R14,
+    R15
+};
+
+// [base + disp]
+struct Mem {
+    Reg base;
+    int32_t disp;
+};
+
+enum class Cond : uint8_t {
+    A = 0x7,  // unsigned >
+    NE = 0x5,
+    E = 0x4
+};
+
+// A branch target. Jumps to an unbound label are patched when it is bound.
+struct Label {
+    int64_t pos = -1;
+    std::vector<size_t> fixups;
+};
+
+// Minimal x86-64 encoder for the instructions the JIT needs. Every 64-bit
+// ALU form uses REX.W; 32-bit moves are used where the zero-extension into
+// the full register is the point.
+class Assembler {
+    std::vector<uint8_t> buf_;
+
+    static uint8_t lo3(Reg r) {
+        return r & 7;
+    }
+    static bool hi(Reg r) {
+        return r >= R8;
+    }
+    void rex(bool w, Reg reg, Reg rm, bool force = false) {
+        uint8_t b = 0x40 | (w << 3) | (hi(reg) << 2) | hi(rm);
+        if (b != 0x40 || force)
+            byte(b);
+    }
+    void modrmReg(Reg reg, Reg rm) {
+        byte(0xC0 | (lo3(reg) << 3) | lo3(rm));
+    }
+    void modrmMem(Reg reg, Mem m) {
+        bool d8 = m.disp >= -128 && m.disp <= 127;
+        // mod 00 with rbp/r13 means rip-relative or disp32, so always
+        // carry a displacement.
+        byte((d8 ? 0x40 : 0x80) | (lo3(reg) << 3) | lo3(m.base));
+        if (lo3(m.base) == RSP)
+            byte(0x24); // SIB: base only
+        if (d8)
+            byte(static_cast<uint8_t>(m.disp));
+        else
+            imm32(static_cast<uint32_t>(m.disp));
+    }
+    void imm32(uint32_t v) {
+        for (int i = 0; i < 4; ++i)
+            byte(static_cast<uint8_t>(v >> (8 * i)));
+    }
+    void rel32To(Label &l) {
+        if (l.pos >= 0) {
+            imm32(static_cast<uint32_t>(l.pos - static_cast<int64_t>(buf_.size() + 4)));
+        } else {
+            l.fixups.push_back(buf_.size());
+            imm32(0);
+        }
+    }
+
+  public:
+    void byte(uint8_t b) {
+        buf_.push_back(b);
+    }
+    const std::vector<uint8_t> &code() const {
+        return buf_;
+    }
+    std::vector<uint8_t> take() {
+        return std::move(buf_);
+    }
+    size_t size() const {
+        return buf_.size();
+    }
+
+    void bind(Label &l) {
+        assert(l.pos < 0 && "label bound twice");
+        l.pos = static_cast<int64_t>(buf_.size());
+        for (size_t at : l.fixups) {
+            auto rel = static_cast<uint32_t>(l.pos - static_cast<int64_t>(at + 4));
+            for (int i = 0; i < 4; ++i)
+                buf_[at + i] = static_cast<uint8_t>(rel >> (8 * i));
+        }
+        l.fixups.clear();
+    }
+
+    // mov dst, src (64-bit)
+    void mov(Reg dst, Reg src) {
+        rex(true, src, dst);
+        byte(0x89);
+        modrmReg(src, dst);
+    }
+    // mov dst32, src32: zero-extends into dst
+    void mov32(Reg dst, Reg src) {
+        rex(false, src, dst);
+        byte(0x89);
+        modrmReg(src, dst);
+    }
+    void movImm(Reg dst, uint64_t imm) {
+        if (imm <= 0xFFFFFFFFull) { // mov r32, imm32 zero-extends
+            rex(false, RAX, dst);
+            byte(0xB8 + lo3(dst));
+            imm32(static_cast<uint32_t>(imm));
+        } else if (static_cast<int64_t>(imm) >= INT32_MIN && static_cast<int64_t>(imm) < 0) {
+            rex(true, RAX, dst);
+            byte(0xC7);
+            modrmReg(RAX, dst);
+            imm32(static_cast<uint32_t>(imm));
+        } else {
+            rex(true, RAX, dst);
+            byte(0xB8 + lo3(dst));
+            imm32(static_cast<uint32_t>(imm));
+            imm32(static_cast<uint32_t>(imm >> 32));
+        }
+    }
+    void load(Reg dst, Mem m) {
+        rex(true, dst, m.base);
+        byte(0x8B);
+        modrmMem(dst, m);
+    }
+    void store(Mem m, Reg src) {
+        rex(true, src, m.base);
+        byte(0x89);
+        modrmMem(src, m);
+    }
+    // imul dst, src
+    void imul(Reg dst, Reg src) {
+        rex(true, dst, src);
+        byte(0x0F);
+        byte(0xAF);
+        modrmReg(dst, src);
+    }
+    // add dst, imm; immediates beyond 32 bits go through scratch
+    void addImm(Reg dst, uint64_t imm, Reg scratch = R11) {
+        auto s = static_cast<int64_t>(imm);
+        if (s >= -128 && s <= 127) {
+            rex(true, RAX, dst);
+            byte(0x83);
+            modrmReg(RAX, dst);
+            byte(static_cast<uint8_t>(s));
+        } else if (s >= INT32_MIN && s <= INT32_MAX) {
+            rex(true, RAX, dst);
+            byte(0x81);
+            modrmReg(RAX, dst);
+            imm32(static_cast<uint32_t>(s));
+        } else {
+            movImm(scratch, imm);
+            rex(true, scratch, dst);
+            byte(0x01);
+            modrmReg(scratch, dst);
+        }
+    }
+    void subImm(Reg dst, int32_t imm) {
+        rex(true, RAX, dst);
+        byte(0x81);
+        modrmReg(static_cast<Reg>(5), dst);
+        imm32(static_cast<uint32_t>(imm));
+    }
+    // cmp a, b: flags of a - b
+    void cmp(Reg a, Reg b) {
+        rex(true, b, a);
+        byte(0x39);
+        modrmReg(b, a);
+    }
+    void test(Reg a, Reg b) {
+        rex(true, b, a);
+        byte(0x85);
+        modrmReg(b, a);
+    }
+    // setcc dst8; movzx dst32, dst8
+    void setcc(Cond c, Reg dst) {
+        rex(false, RAX, dst, dst >= RSP);
+        byte(0x0F);
+        byte(0x90 | static_cast<uint8_t>(c));
+        modrmReg(RAX, dst);
+        rex(false, dst, dst, dst >= RSP);
+        byte(0x0F);
+        byte(0xB6);
+        modrmReg(dst, dst);
+    }
+    void jcc(Cond c, Label &l) {
+        byte(0x0F);
+        byte(0x80 | static_cast<uint8_t>(c));
+        rel32To(l);
+    }
+    void jmp(Label &l) {
+        byte(0xE9);
+        rel32To(l);
+    }
+    void push(Reg r) {
+        rex(false, RAX, r);
+        byte(0x50 + lo3(r));
+    }
+    void pop(Reg r) {
+        rex(false, RAX, r);
+        byte(0x58 + lo3(r));
+    }
+    void leave() {
+        byte(0xC9);
+    }
+    void ret() {
+        byte(0xC3);
+    }
+};
+}
+}
@@ -0,0 +1,363 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+#include "codegen/executable_memory.h"
+#include "codegen/linear_scan.h"
+#include "codegen/parallel_move.h"
+#include "codegen/x86_64_assembler.h"
+#include "ir/id_map.h"
+#include "ir/ir_graph.h"
+
+namespace codegen {
+namespace x86_64 {
+using ir::BasicBlock;
+using ir::Inst;
+using ir::IRGraph;
+using ir::SSAValue;
+
+// Native code for one IRGraph function, callable with the System V AMD64
+// calling convention: u32/u64 arguments in rdi, rsi, rdx, rcx, r8, r9 and
+// then on the stack, the u64 result in rax.
+class JitFunction {
+    ExecutableMemory mem_;
+    size_t numArgs_ = 0;
+
+  public:
+    JitFunction() = default;
+    JitFunction(ExecutableMemory mem, size_t numArgs) : mem_(std::move(mem)), numArgs_(numArgs) {
+    }
+
+    // e.g. fn.as<uint64_t(uint32_t)>()(10)
+    template <typename Fn>
+    Fn *as() const {
+        return reinterpret_cast<Fn *>(const_cast<void *>(mem_.data()));
+    }
+    // Calls with up to six register arguments; unused ones are zero.
+    uint64_t call(std::initializer_list<uint64_t> args) const {
+        assert(args.size() <= 6 && numArgs_ <= 6);
+        uint64_t a[6] = {};
+        size_t i = 0;
+        for (uint64_t v : args)
+            a[i++] = v;
+        using Fn6 = uint64_t(uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t);
+        return as<Fn6>()(a[0], a[1], a[2], a[3], a[4], a[5]);
+    }
+    size_t codeSize() const {
+        return mem_.size();
+    }
+    size_t numArgs() const {
+        return numArgs_;
+    }
+};
+
+struct JitOptions {
+    // Cap on allocatable registers; 0 keeps every value on the stack.
+    size_t maxRegs = 11;
+};
+
+// Single-pass code generator over a LinearScan allocation. Blocks are laid
+// out in the allocator's linear order (unreachable ones are dropped). rax
+// and rcx are working registers, rax also breaks parallel-move cycles and
+// r11 carries slot-to-slot copies, so none of them is allocatable. Phis are
+// parallel moves on edges; a taken JA edge that needs moves goes through a
+// stub emitted after all blocks, and a CMP_U64 right before JA_U64 is
+// emitted as cmp + ja, materializing the flag only when a ja further on,
+// possibly past blocks that only jump, reads it.
+class JitCompiler {
+    static constexpr Reg kArgRegs[6] = {RDI, RSI, RDX, RCX, R8, R9};
+    static constexpr Reg kAllocatable[11] = {RDX, RSI, RDI, R8, R9, R10, RBX, R12, R13, R14, R15};
+    static constexpr Reg kCalleeSaved[5] = {RBX, R12, R13, R14, R15};
+    // Move locations: registers are 0..15, stack slot k is kSlotBase + k.
+    static constexpr uint32_t kSlotBase = 16;
+
+    const IRGraph &g_;
+    JitOptions opts_;
+    LinearScan ra_;
+    Assembler as_;
+    ir::BlockMap<uint32_t> index_;
+    std::vector<Label> labels_;
+    std::vector<std::pair<const BasicBlock *, BasicBlock *>> stubs_;
+    std::vector<Label> stubLabels_;
+    std::vector<Reg> saved_;
+    uint32_t flagSlot_ = 0;
+    ir::BlockMap<bool> flagsLiveIn_;
+
+    // Frame below rbp: callee-saved registers, the flag, then spills.
+    Mem frameSlot(uint32_t k) const {
+        return Mem{RBP, -8 * static_cast<int32_t>(k + 1)};
+    }
+    uint32_t moveLoc(const SSAValue *v) const {
+        assert(v && "operand without a value");
+        const Location &l = ra_.location.get(v);
+        assert(l.kind != Location::Kind::None && "value has no location");
+        return l.isReg() ? static_cast<uint32_t>(kAllocatable[l.index]) : kSlotBase + flagSlot_ + 1 + l.index;
+    }
+    bool inReg(const SSAValue *v) const {
+        return moveLoc(v) < kSlotBase;
+    }
+    Reg regOf(const SSAValue *v) const {
+        return static_cast<Reg>(moveLoc(v));
+    }
+    Mem memOf(uint32_t loc) const {
+        return frameSlot(loc - kSlotBase);
+    }
+
+    void emitMove(uint32_t dst, uint32_t src) {
+        if (dst < kSlotBase && src < kSlotBase)
+            as_.mov(static_cast<Reg>(dst), static_cast<Reg>(src));
+        else if (dst < kSlotBase)
+            as_.load(static_cast<Reg>(dst), memOf(src));
+        else if (src < kSlotBase)
+            as_.store(memOf(dst), static_cast<Reg>(src));
+        else {
+            as_.load(R11, memOf(src));
+            as_.store(memOf(dst), R11);
+        }
+    }
+    // Register holding v, loading it into tmp when spilled.
+    Reg use(const SSAValue *v, Reg tmp) {
+        if (inReg(v))
+            return regOf(v);
+        as_.load(tmp, memOf(moveLoc(v)));
+        return tmp;
+    }
+    // Register to compute v into; pair with def().
+    Reg target(const SSAValue *v) const {
+        return inReg(v) ? regOf(v) : RAX;
+    }
+    void def(const SSAValue *v, Reg from) {
+        uint32_t loc = moveLoc(v);
+        if (loc != from)
+            emitMove(loc, from);
+    }
+    Label &labelOf(const BasicBlock *bb) {
+        return labels_[index_.get(bb)];
+    }
+
+    static bool hasPhis(const BasicBlock *bb) {
+        const Inst *first = bb->insts.front();
+        return first && first->opcode() == Opcode::PHI_U64;
+    }
+
+    void emitEdgeMoves(const BasicBlock *pred, const BasicBlock *succ) {
+        std::vector<Move> moves;
+        for (const Inst *I : succ->insts) {
+            if (I->opcode() != Opcode::PHI_U64)
+                break;
+            auto *P = static_cast<const ir::PhiInst *>(I);
+            SSAValue *in = P->incomingFor(pred);
+            assert(in && "phi has no incoming value for predecessor");
+            moves.push_back({moveLoc(P->result()), moveLoc(in)});
+        }
+        for (auto &m : sequentializeMoves(std::move(moves), RAX))
+            emitMove(m.dst, m.src);
+    }
+
+    void emitEdge(const BasicBlock *pred, BasicBlock *succ, const BasicBlock *layoutNext) {
+        emitEdgeMoves(pred, succ);
+        if (succ != layoutNext)
+            as_.jmp(labelOf(succ));
+    }
+
+    void emitBranch(Cond c, const BasicBlock *from, BasicBlock *taken) {
+        if (hasPhis(taken)) {
+            stubs_.emplace_back(from, taken);
+            stubLabels_.emplace_back();
+            as_.jcc(c, stubLabels_.back());
+        } else {
+            as_.jcc(c, labelOf(taken));
+        }
+    }
+
+    void emitCompare(const ir::CmpInst *C) {
+        Reg a = use(C->left(), RAX);
+        Reg b = use(C->right(), RCX);
+        as_.cmp(a, b);
+    }
+
+    void emitReturn(const SSAValue *v) {
+        Reg r = use(v, RAX);
+        if (r != RAX)
+            as_.mov(RAX, r);
+        for (size_t i = 0; i < saved_.size(); ++i)
+            as_.load(saved_[i], frameSlot(static_cast<uint32_t>(i)));
+        as_.leave();
+        as_.ret();
+    }
+
+    void lowerBlock(BasicBlock *bb, const BasicBlock *layoutNext) {
+        const ir::CmpInst *pendingCmp = nullptr;
+        bool terminated = false;
+        auto flushCmp = [&]() {
+            emitCompare(pendingCmp);
+            as_.setcc(Cond::A, RAX);
+            as_.store(frameSlot(flagSlot_), RAX);
+            pendingCmp = nullptr;
+        };
+        for (const Inst *I : bb->insts) {
+            if (pendingCmp && I->opcode() != Opcode::JA_U64)
+                flushCmp();
+            switch (I->opcode()) {
+            case Opcode::PHI_U64:
+                break;
+            case Opcode::MOVI_U64: {
+                auto *M = static_cast<const ir::MoviInst *>(I);
+                Reg d = target(M->result());
+                as_.movImm(d, M->imm());
+                def(M->result(), d);
+                break;
+            }
+            case Opcode::U32TOU64: {
+                auto *C = static_cast<const ir::CastInst *>(I);
+                Reg d = target(C->result());
+                as_.mov32(d, use(C->src(), RAX));
+                def(C->result(), d);
+                break;
+            }
+            case Opcode::MUL_U64: {
+                auto *M = static_cast<const ir::MulInst *>(I);
+                Reg a = use(M->left(), RAX);
+                Reg b = use(M->right(), RCX);
+                Reg d = target(M->result());
+                if (d == b && d != a)
+                    d = RAX; // would clobber the right operand
+                if (d != a)
+                    as_.mov(d, a);
+                as_.imul(d, b);
+                def(M->result(), d);
+                break;
+            }
+            case Opcode::ADDI_U64: {
+                auto *A = static_cast<const ir::AddiInst *>(I);
+                Reg a = use(A->src(), RAX);
+                Reg d = target(A->result());
+                if (d != a)
+                    as_.mov(d, a);
+                as_.addImm(d, A->imm());
+                def(A->result(), d);
+                break;
+            }
+            case Opcode::CMP_U64:
+                pendingCmp = static_cast<const ir::CmpInst *>(I);
+                break;
+            case Opcode::JA_U64: {
+                auto *J = static_cast<const ir::JaInst *>(I);
+                BasicBlock *taken = J->target();
+                BasicBlock *other = taken;
+                for (auto *s : bb->successors)
+                    if (s != taken)
+                        other = s;
+                Cond c = Cond::A;
+                if (pendingCmp) {
+                    emitCompare(pendingCmp);
+                    pendingCmp = nullptr;
+                    // setcc and the store leave the flags for the jcc.
+                    if (std::any_of(bb->successors.begin(), bb->successors.end(),
+                                    [&](const BasicBlock *s) { return flagsLiveIn_.get(s); })) {
+                        as_.setcc(Cond::A, RAX);
+                        as_.store(frameSlot(flagSlot_), RAX);
+                    }
+                } else {
+                    as_.load(RAX, frameSlot(flagSlot_));
+                    as_.test(RAX, RAX);
+                    c = Cond::NE;
+                }
+                emitBranch(c, bb, taken);
+                emitEdge(bb, other, layoutNext);
+                terminated = true;
+                break;
+            }
+            case Opcode::JMP:
+                emitEdge(bb, static_cast<const ir::JmpInst *>(I)->target(), layoutNext);
+                terminated = true;
+                break;
+            case Opcode::RET_U64:
+                emitReturn(static_cast<const ir::RetInst *>(I)->src());
+                terminated = true;
+                break;
+            }
+            if (terminated)
+                break;
+        }
+        if (pendingCmp)
+            flushCmp();
+        if (!terminated) {
+            assert(bb->successors.size() == 1 && "block falls off without a terminator");
+            emitEdge(bb, bb->successors.front(), layoutNext);
+        }
+    }
+
+    void emitPrologue() {
+        for (size_t r = 0; r < ra_.regUsed.size(); ++r)
+            if (ra_.regUsed[r])
+                for (Reg cs : kCalleeSaved)
+                    if (kAllocatable[r] == cs)
+                        saved_.push_back(cs);
+        flagSlot_ = static_cast<uint32_t>(saved_.size());
+        int32_t frame = 8 * static_cast<int32_t>(flagSlot_ + 1 + ra_.numSpillSlots);
+        frame = (frame + 15) & ~15;
+
+        as_.push(RBP);
+        as_.mov(RBP, RSP);
+        as_.subImm(RSP, frame);
+        for (size_t i = 0; i < saved_.size(); ++i)
+            as_.store(frameSlot(static_cast<uint32_t>(i)), saved_[i]);
+
+        // Register arguments move to their locations in parallel, since an
+        // argument register may be another argument's assigned home. Stack
+        // arguments are loaded afterwards.
+        const auto &args = g_.args();
+        std::vector<Move> moves;
+        for (size_t k = 0; k < args.size() && k < 6; ++k)
+            if (args[k].val && ra_.location.get(args[k].val).kind != Location::Kind::None)
+                moves.push_back({moveLoc(args[k].val), kArgRegs[k]});
+        for (auto &m : sequentializeMoves(std::move(moves), RAX))
+            emitMove(m.dst, m.src);
+        for (size_t k = 6; k < args.size(); ++k) {
+            if (!args[k].val || ra_.location.get(args[k].val).kind == Location::Kind::None)
+                continue;
+            as_.load(RAX, Mem{RBP, 16 + 8 * static_cast<int32_t>(k - 6)});
+            def(args[k].val, RAX);
+        }
+    }
+
+  public:
+    explicit JitCompiler(const IRGraph &g, JitOptions opts = {})
+        : g_(g), opts_(opts), ra_(std::min<size_t>(opts.maxRegs, 11)) {
+    }
+
+    const LinearScan &allocation() const {
+        return ra_;
+    }
+
+    JitFunction run() {
+        ra_.run(g_);
+        flagsLiveIn_ = ir::flagsLiveIn(g_);
+        const auto &order = ra_.order;
+        emitPrologue();
+
+        labels_.resize(order.size());
+        for (size_t i = 0; i < order.size(); ++i)
+            index_[order[i]] = static_cast<uint32_t>(i);
+        for (size_t i = 0; i < order.size(); ++i) {
+            as_.bind(labels_[i]);
+            lowerBlock(order[i], i + 1 < order.size() ? order[i + 1] : nullptr);
+        }
+        for (size_t s = 0; s < stubs_.size(); ++s) {
+            as_.bind(stubLabels_[s]);
+            emitEdge(stubs_[s].first, stubs_[s].second, nullptr);
+        }
+        std::vector<uint8_t> code = as_.take();
+        return JitFunction(ExecutableMemory(code.data(), code.size()), g_.args().size());
+    }
+};
+
+inline JitFunction compileX86_64(const IRGraph &g, JitOptions opts = {}) {
+    return JitCompiler(g, opts).run();
+}
+}
+}
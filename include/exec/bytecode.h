@@ -0,0 +1,271 @@
+#pragma once
+#include <cassert>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "codegen/parallel_move.h"
+#include "ir/id_map.h"
+#include "ir/ir_graph.h"
+
+namespace exec {
+using ir::BasicBlock;
+using ir::Inst;
+using ir::IRGraph;
+using ir::SSAValue;
+
+// Register bytecode. Each instruction is an opcode word followed by its
+// operand words; registers are indexed by SSA value id and branch targets
+// are absolute word offsets. 64-bit immediates take two words, low first.
+enum class BcOp : uint32_t {
+    MOVI,   // dst, lo, hi
+    MOV,    // dst, src
+    ZEXT32, // dst, src
+    MUL,    // dst, a, b
+    ADDI,   // dst, src, lo, hi
+    CMP,    // a, b            flag = a > b (unsigned)
+    JA,     // target          if flag goto target
+    CMP_JA, // a, b, target    fused CMP_U64 + JA_U64
+    JMP,    // target
+    RET,    // src
+    NUM_OPS
+};
+
+inline size_t bcLength(BcOp op) {
+    switch (op) {
+    case BcOp::MOVI:
+        return 4;
+    case BcOp::MOV:
+    case BcOp::ZEXT32:
+        return 3;
+    case BcOp::MUL:
+        return 4;
+    case BcOp::ADDI:
+        return 5;
+    case BcOp::CMP:
+        return 3;
+    case BcOp::JA:
+        return 2;
+    case BcOp::CMP_JA:
+        return 4;
+    case BcOp::JMP:
+    case BcOp::RET:
+        return 2;
+    default:
+        return 1;
+    }
+}
+
+struct BytecodeFunction {
+    std::vector<uint32_t> code;
+    uint32_t numRegs = 0;
+    // Registers receiving the arguments, in signature order.
+    std::vector<uint32_t> argRegs;
+
+    std::string disassemble() const {
+        static const char *names[] = {"movi", "mov", "zext32", "mul", "addi",
+                                      "cmp", "ja", "cmp.ja", "jmp", "ret"};
+        std::ostringstream oss;
+        for (size_t pc = 0; pc < code.size();) {
+            auto op = static_cast<BcOp>(code[pc]);
+            size_t len = bcLength(op);
+            oss << pc << ": " << names[code[pc]];
+            for (size_t k = 1; k < len; ++k)
+                oss << (k == 1 ? " " : ", ") << code[pc + k];
+            oss << "\n";
+            pc += len;
+        }
+        return oss.str();
+    }
+};
+
+// Linearizes a graph in block layout order. Phis become parallel moves on
+// the incoming edges: moves for the fall-through or jump edge are emitted
+// before the jump, and a taken JA edge that needs moves is redirected to a
+// stub placed after all blocks. A CMP_U64 directly followed by JA_U64 is
+// fused into CMP_JA. A block without a terminator falls through to its
+// single successor.
+class BytecodeLowering {
+    const IRGraph &g_;
+    BytecodeFunction fn_;
+    ir::BlockMap<uint32_t> label_;
+    std::vector<uint32_t> labelPos_;
+    std::vector<std::pair<size_t, uint32_t>> fixups_;
+    std::vector<std::pair<BasicBlock *, BasicBlock *>> stubs_;
+
+    uint32_t reg(const SSAValue *v) const {
+        assert(v && "operand without a value");
+        return v->id;
+    }
+    void emit(BcOp op) {
+        fn_.code.push_back(static_cast<uint32_t>(op));
+    }
+    void emitWord(uint32_t w) {
+        fn_.code.push_back(w);
+    }
+    void emitImm(uint64_t imm) {
+        emitWord(static_cast<uint32_t>(imm));
+        emitWord(static_cast<uint32_t>(imm >> 32));
+    }
+    void emitTarget(uint32_t label) {
+        fixups_.emplace_back(fn_.code.size(), label);
+        emitWord(0);
+    }
+
+    static bool hasPhis(const BasicBlock *bb) {
+        const Inst *first = bb->insts.front();
+        return first && first->opcode() == Opcode::PHI_U64;
+    }
+
+    void emitEdgeMoves(const BasicBlock *pred, const BasicBlock *succ) {
+        std::vector<codegen::Move> moves;
+        for (const Inst *I : succ->insts) {
+            if (I->opcode() != Opcode::PHI_U64)
+                break;
+            auto *P = static_cast<const ir::PhiInst *>(I);
+            SSAValue *in = P->incomingFor(pred);
+            assert(in && "phi has no incoming value for predecessor");
+            moves.push_back({reg(P->result()), reg(in)});
+        }
+        for (auto &m : codegen::sequentializeMoves(std::move(moves), fn_.numRegs - 1)) {
+            emit(BcOp::MOV);
+            emitWord(m.dst);
+            emitWord(m.src);
+        }
+    }
+
+    void emitEdge(const BasicBlock *pred, BasicBlock *succ, const BasicBlock *layoutNext) {
+        emitEdgeMoves(pred, succ);
+        if (succ != layoutNext) {
+            emit(BcOp::JMP);
+            emitTarget(label_[succ]);
+        }
+    }
+
+    void lowerBlock(BasicBlock *bb, const BasicBlock *layoutNext) {
+        const ir::CmpInst *pendingCmp = nullptr;
+        bool terminated = false;
+        for (const Inst *I : bb->insts) {
+            if (pendingCmp && I->opcode() != Opcode::JA_U64) {
+                emit(BcOp::CMP);
+                emitWord(reg(pendingCmp->left()));
+                emitWord(reg(pendingCmp->right()));
+                pendingCmp = nullptr;
+            }
+            switch (I->opcode()) {
+            case Opcode::PHI_U64:
+                break;
+            case Opcode::MOVI_U64: {
+                auto *M = static_cast<const ir::MoviInst *>(I);
+                emit(BcOp::MOVI);
+                emitWord(reg(M->result()));
+                emitImm(M->imm());
+                break;
+            }
+            case Opcode::U32TOU64: {
+                auto *C = static_cast<const ir::CastInst *>(I);
+                emit(BcOp::ZEXT32);
+                emitWord(reg(C->result()));
+                emitWord(reg(C->src()));
+                break;
+            }
+            case Opcode::MUL_U64: {
+                auto *M = static_cast<const ir::MulInst *>(I);
+                emit(BcOp::MUL);
+                emitWord(reg(M->result()));
+                emitWord(reg(M->left()));
+                emitWord(reg(M->right()));
+                break;
+            }
+            case Opcode::ADDI_U64: {
+                auto *A = static_cast<const ir::AddiInst *>(I);
+                emit(BcOp::ADDI);
+                emitWord(reg(A->result()));
+                emitWord(reg(A->src()));
+                emitImm(A->imm());
+                break;
+            }
+            case Opcode::CMP_U64:
+                pendingCmp = static_cast<const ir::CmpInst *>(I);
+                break;
+            case Opcode::JA_U64: {
+                auto *J = static_cast<const ir::JaInst *>(I);
+                BasicBlock *taken = J->target();
+                BasicBlock *other = taken;
+                for (auto *s : bb->successors)
+                    if (s != taken)
+                        other = s;
+                if (pendingCmp) {
+                    emit(BcOp::CMP_JA);
+                    emitWord(reg(pendingCmp->left()));
+                    emitWord(reg(pendingCmp->right()));
+                    pendingCmp = nullptr;
+                } else {
+                    emit(BcOp::JA);
+                }
+                if (hasPhis(taken)) {
+                    emitTarget(static_cast<uint32_t>(g_.numBlocks() + stubs_.size()));
+                    stubs_.emplace_back(bb, taken);
+                } else {
+                    emitTarget(label_[taken]);
+                }
+                emitEdge(bb, other, layoutNext);
+                terminated = true;
+                break;
+            }
+            case Opcode::JMP:
+                emitEdge(bb, static_cast<const ir::JmpInst *>(I)->target(), layoutNext);
+                terminated = true;
+                break;
+            case Opcode::RET_U64:
+                emit(BcOp::RET);
+                emitWord(reg(static_cast<const ir::RetInst *>(I)->src()));
+                terminated = true;
+                break;
+            }
+            if (terminated)
+                break;
+        }
+        if (pendingCmp) {
+            emit(BcOp::CMP);
+            emitWord(reg(pendingCmp->left()));
+            emitWord(reg(pendingCmp->right()));
+        }
+        if (!terminated) {
+            assert(bb->successors.size() == 1 && "block falls off without a terminator");
+            emitEdge(bb, bb->successors.front(), layoutNext);
+        }
+    }
+
+  public:
+    explicit BytecodeLowering(const IRGraph &g) : g_(g) {
+    }
+
+    BytecodeFunction run() {
+        const auto &blocks = g_.getBlocks();
+        fn_.numRegs = g_.valueIdBound() + 1; // last register is move scratch
+        for (auto &a : g_.args())
+            fn_.argRegs.push_back(a.val ? reg(a.val) : fn_.numRegs - 1);
+        for (size_t i = 0; i < blocks.size(); ++i)
+            label_[blocks[i]] = static_cast<uint32_t>(i);
+        labelPos_.assign(blocks.size(), 0);
+
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            labelPos_[i] = static_cast<uint32_t>(fn_.code.size());
+            lowerBlock(blocks[i], i + 1 < blocks.size() ? blocks[i + 1] : nullptr);
+        }
+        for (size_t s = 0; s < stubs_.size(); ++s) {
+            labelPos_.push_back(static_cast<uint32_t>(fn_.code.size()));
+            emitEdge(stubs_[s].first, stubs_[s].second, nullptr);
+        }
+        for (auto &[pos, label] : fixups_)
+            fn_.code[pos] = labelPos_[label];
+        return std::move(fn_);
+    }
+};
+
+inline BytecodeFunction lowerToBytecode(const IRGraph &g) {
+    return BytecodeLowering(g).run();
+}
+}
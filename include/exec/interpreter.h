@@ -0,0 +1,115 @@
+#pragma once
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+#include "exec/bytecode.h"
+
+#if defined(__GNUC__) || defined(__clang__)
+#define EXEC_COMPUTED_GOTO 1
+#else
+#define EXEC_COMPUTED_GOTO 0
+#endif
+
+namespace exec {
+
+// Tier-0 execution engine over BytecodeFunction. With GCC or Clang every
+// handler ends in its own indirect jump through a label table (computed
+// goto), so the branch predictor sees one dispatch site per opcode; other
+// compilers get a plain switch loop.
+class Interpreter {
+    const BytecodeFunction &fn_;
+    std::vector<uint64_t> regs_;
+
+  public:
+    explicit Interpreter(const BytecodeFunction &fn) : fn_(fn), regs_(fn.numRegs, 0) {
+    }
+
+    // Missing arguments read as zero; extra ones are ignored.
+    uint64_t run(const uint64_t *args, size_t numArgs) {
+        for (size_t i = 0; i < fn_.argRegs.size(); ++i)
+            regs_[fn_.argRegs[i]] = i < numArgs ? args[i] : 0;
+        const uint32_t *code = fn_.code.data();
+        const uint32_t *pc = code;
+        uint64_t *r = regs_.data();
+        bool flag = false;
+        auto imm = [](const uint32_t *p) { return uint64_t(p[0]) | (uint64_t(p[1]) << 32); };
+
+#if EXEC_COMPUTED_GOTO
+        static const void *labels[] = {&&op_movi, &&op_mov, &&op_zext32, &&op_mul, &&op_addi,
+                                       &&op_cmp, &&op_ja, &&op_cmp_ja, &&op_jmp, &&op_ret};
+        static_assert(sizeof(labels) / sizeof(labels[0]) == size_t(BcOp::NUM_OPS));
+#define EXEC_CASE(label, op) label:
+#define EXEC_NEXT() goto *labels[*pc]
+        EXEC_NEXT();
+#else
+#define EXEC_CASE(label, op) case BcOp::op:
+#define EXEC_NEXT() continue
+        for (;;) {
+            switch (static_cast<BcOp>(*pc)) {
+            default:
+                return 0;
+#endif
+        EXEC_CASE(op_movi, MOVI) {
+            r[pc[1]] = imm(pc + 2);
+            pc += 4;
+            EXEC_NEXT();
+        }
+        EXEC_CASE(op_mov, MOV) {
+            r[pc[1]] = r[pc[2]];
+            pc += 3;
+            EXEC_NEXT();
+        }
+        EXEC_CASE(op_zext32, ZEXT32) {
+            r[pc[1]] = static_cast<uint32_t>(r[pc[2]]);
+            pc += 3;
+            EXEC_NEXT();
+        }
+        EXEC_CASE(op_mul, MUL) {
+            r[pc[1]] = r[pc[2]] * r[pc[3]];
+            pc += 4;
+            EXEC_NEXT();
+        }
+        EXEC_CASE(op_addi, ADDI) {
+            r[pc[1]] = r[pc[2]] + imm(pc + 3);
+            pc += 5;
+            EXEC_NEXT();
+        }
+        EXEC_CASE(op_cmp, CMP) {
+            flag = r[pc[1]] > r[pc[2]];
+            pc += 3;
+            EXEC_NEXT();
+        }
+        EXEC_CASE(op_ja, JA) {
+            pc = flag ? code + pc[1] : pc + 2;
+            EXEC_NEXT();
+        }
+        EXEC_CASE(op_cmp_ja, CMP_JA) {
+            flag = r[pc[1]] > r[pc[2]];
+            pc = flag ? code + pc[3] : pc + 4;
+            EXEC_NEXT();
+        }
+        EXEC_CASE(op_jmp, JMP) {
+            pc = code + pc[1];
+            EXEC_NEXT();
+        }
+        EXEC_CASE(op_ret, RET) {
+            return r[pc[1]];
+        }
+#if !EXEC_COMPUTED_GOTO
+            }
+        }
+#endif
+#undef EXEC_CASE
+#undef EXEC_NEXT
+    }
+
+    uint64_t run(std::initializer_list<uint64_t> args) {
+        return run(args.begin(), args.size());
+    }
+};
+
+inline uint64_t interpret(const BytecodeFunction &fn, std::initializer_list<uint64_t> args) {
+    return Interpreter(fn).run(args);
+}
+}
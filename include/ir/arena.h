@@ -0,0 +1,217 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ir {
+
+// Default-size arena chunks kept for reuse by one thread. While a cache is
+// installed on a thread (ChunkCache::Scope), arenas that grow or die there
+// take chunks from it and give them back instead of calling malloc and
+// free, so worker threads building and dropping many graphs recycle their
+// own memory. Chunks are plain malloc memory; one taken from a cache may be
+// freed on any thread.
+class ChunkCache {
+    std::vector<void *> free_;
+    size_t chunk_size_;
+    size_t max_chunks_;
+    size_t taken_ = 0, reused_ = 0;
+
+    static ChunkCache *&slot() {
+        static thread_local ChunkCache *cache = nullptr;
+        return cache;
+    }
+
+  public:
+    explicit ChunkCache(size_t chunk_size = 64 * 1024, size_t max_chunks = 256)
+        : chunk_size_(chunk_size), max_chunks_(max_chunks) {
+        free_.reserve(max_chunks_);
+    }
+    ~ChunkCache() {
+        for (void *p : free_)
+            std::free(p);
+    }
+    ChunkCache(const ChunkCache &) = delete;
+    ChunkCache &operator=(const ChunkCache &) = delete;
+
+    // The cache installed on the calling thread, if any.
+    static ChunkCache *current() {
+        return slot();
+    }
+    class Scope {
+        ChunkCache *prev_;
+
+      public:
+        explicit Scope(ChunkCache &c) : prev_(slot()) {
+            slot() = &c;
+        }
+        ~Scope() {
+            slot() = prev_;
+        }
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+    };
+
+    size_t chunkSize() const {
+        return chunk_size_;
+    }
+    void *take() {
+        ++taken_;
+        if (free_.empty())
+            return std::malloc(chunk_size_);
+        ++reused_;
+        void *p = free_.back();
+        free_.pop_back();
+        return p;
+    }
+    // Returns false when full; the caller frees the chunk.
+    bool give(void *p) {
+        if (free_.size() >= max_chunks_)
+            return false;
+        free_.push_back(p);
+        return true;
+    }
+
+    size_t numTaken() const {
+        return taken_;
+    }
+    size_t numReused() const {
+        return reused_;
+    }
+    size_t numCached() const {
+        return free_.size();
+    }
+};
+
+// Bump allocator owning every object of one IRGraph. Memory is carved out of
+// large chunks and released all at once when the arena dies; objects with
+// non-trivial destructors are registered so they are destroyed in reverse
+// creation order first. Chunks come from the thread's ChunkCache when one
+// is installed.
+class Arena {
+    struct Chunk {
+        Chunk *next;
+        size_t size;
+    };
+    struct DtorRecord {
+        void (*dtor)(void *);
+        void *obj;
+        DtorRecord *next;
+    };
+
+    Chunk *chunks_ = nullptr;
+    char *cur_ = nullptr;
+    char *end_ = nullptr;
+    DtorRecord *dtors_ = nullptr;
+    size_t chunk_size_;
+    size_t bytes_used_ = 0;
+
+    static char *alignUp(char *p, size_t align) {
+        auto v = reinterpret_cast<uintptr_t>(p);
+        return reinterpret_cast<char *>((v + align - 1) & ~(uintptr_t)(align - 1));
+    }
+
+    void grow(size_t size, size_t align) {
+        size_t need = sizeof(Chunk) + size + align;
+        size_t sz = std::max(chunk_size_, need);
+        ChunkCache *cache = ChunkCache::current();
+        void *mem = cache && sz == cache->chunkSize() ? cache->take() : std::malloc(sz);
+        if (!mem)
+            throw std::bad_alloc();
+        auto *c = static_cast<Chunk *>(mem);
+        c->next = chunks_;
+        c->size = sz;
+        chunks_ = c;
+        cur_ = reinterpret_cast<char *>(c + 1);
+        end_ = static_cast<char *>(mem) + sz;
+    }
+
+    void release() {
+        for (auto *d = dtors_; d; d = d->next)
+            d->dtor(d->obj);
+        dtors_ = nullptr;
+        ChunkCache *cache = chunks_ ? ChunkCache::current() : nullptr;
+        while (chunks_) {
+            Chunk *next = chunks_->next;
+            if (!cache || chunks_->size != cache->chunkSize() || !cache->give(chunks_))
+                std::free(chunks_);
+            chunks_ = next;
+        }
+        cur_ = end_ = nullptr;
+        bytes_used_ = 0;
+    }
+
+  public:
+    explicit Arena(size_t chunk_size = 64 * 1024) : chunk_size_(chunk_size) {
+    }
+    ~Arena() {
+        release();
+    }
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    Arena(Arena &&o) noexcept
+        : chunks_(o.chunks_), cur_(o.cur_), end_(o.end_), dtors_(o.dtors_),
+          chunk_size_(o.chunk_size_), bytes_used_(o.bytes_used_) {
+        o.chunks_ = nullptr;
+        o.cur_ = o.end_ = nullptr;
+        o.dtors_ = nullptr;
+        o.bytes_used_ = 0;
+    }
+    Arena &operator=(Arena &&o) noexcept {
+        if (this != &o) {
+            release();
+            std::swap(chunks_, o.chunks_);
+            std::swap(cur_, o.cur_);
+            std::swap(end_, o.end_);
+            std::swap(dtors_, o.dtors_);
+            std::swap(bytes_used_, o.bytes_used_);
+            chunk_size_ = o.chunk_size_;
+        }
+        return *this;
+    }
+
+    void *allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+        char *p = alignUp(cur_, align);
+        if (!cur_ || p + size > end_) {
+            grow(size, align);
+            p = alignUp(cur_, align);
+        }
+        cur_ = p + size;
+        bytes_used_ += size;
+        return p;
+    }
+
+    template <typename T, typename... Args>
+    T *create(Args &&...args) {
+        DtorRecord *rec = nullptr;
+        if constexpr (!std::is_trivially_destructible_v<T>)
+            rec = static_cast<DtorRecord *>(allocate(sizeof(DtorRecord), alignof(DtorRecord)));
+        void *mem = allocate(sizeof(T), alignof(T));
+        T *obj = new (mem) T(std::forward<Args>(args)...);
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            rec->dtor = [](void *p) { static_cast<T *>(p)->~T(); };
+            rec->obj = obj;
+            rec->next = dtors_;
+            dtors_ = rec;
+        }
+        return obj;
+    }
+
+    size_t bytesUsed() const {
+        return bytes_used_;
+    }
+    size_t numChunks() const {
+        size_t n = 0;
+        for (auto *c = chunks_; c; c = c->next)
+            ++n;
+        return n;
+    }
+};
+}
@@ -1,38 +1,159 @@
 #pragma once
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <vector>
-#include <list>
 
 #include "ir/inst.h"
+#include "ir/inst_list.h"
 
 namespace ir {
 
 class BasicBlock {
   public:
+    uint32_t id{}; // unique in its graph and never reused
     std::string label;
-    std::list<std::unique_ptr<Inst>> insts;
+    InstList insts{this};
     std::vector<BasicBlock *> successors;
     std::vector<BasicBlock *> predecessors;
+    uint64_t *cfg_epoch = nullptr;
 
     explicit BasicBlock(std::string lbl = "") : label(std::move(lbl)) {
     }
+    BasicBlock(const BasicBlock &) = delete;
+    BasicBlock &operator=(const BasicBlock &) = delete;
 
-    void addInst(std::unique_ptr<Inst> inst) {
-        insts.push_back(std::move(inst));
+    void addInst(Inst *inst) {
+        insts.push_back(inst);
+    }
+    void insertBefore(Inst *pos, Inst *inst) {
+        insts.insert(pos, inst);
+    }
+    void insertAfter(Inst *pos, Inst *inst) {
+        insts.insertAfter(pos, inst);
+    }
+    // Moves [first, last) from another block (or this one) before pos.
+    void splice(Inst *pos, BasicBlock *from, Inst *first, Inst *last = nullptr) {
+        insts.splice(pos, from->insts, first, last);
+    }
+
+    // Every CFG edit must go through a method that calls this, so cached
+    // CFG analyses can tell they are stale.
+    void noteCfgChange() {
+        if (cfg_epoch)
+            ++*cfg_epoch;
     }
 
     void addSuccessor(BasicBlock *succ) {
         successors.push_back(succ);
         succ->predecessors.push_back(this);
+        noteCfgChange();
     }
 
-    std::string toString() const {
-        std::string s;
-        for (const auto &inst : insts) {
-            s += "    " + inst->toString() + "\n";
+    // Removes one this->succ edge; returns false if there was none.
+    bool removeSuccessor(BasicBlock *succ) {
+        auto it = std::find(successors.begin(), successors.end(), succ);
+        if (it == successors.end())
+            return false;
+        successors.erase(it);
+        auto &preds = succ->predecessors;
+        preds.erase(std::find(preds.begin(), preds.end(), this));
+        noteCfgChange();
+        return true;
+    }
+
+    // Redirects every this->from edge to this->to, in place so the order of
+    // successors (and with it which one is a ja's fall-through) is kept, and
+    // retargets the terminator. Phis in from and to are left to the caller.
+    void replaceSuccessor(BasicBlock *from, BasicBlock *to) {
+        bool changed = false;
+        for (auto &s : successors) {
+            if (s != from)
+                continue;
+            s = to;
+            auto &preds = from->predecessors;
+            preds.erase(std::find(preds.begin(), preds.end(), this));
+            to->predecessors.push_back(this);
+            changed = true;
+        }
+        if (!changed)
+            return;
+        if (Inst *T = insts.back(); T && T->opcode() != Opcode::PHI_U64)
+            T->replaceBlockOperand(from, to);
+        noteCfgChange();
+    }
+
+    Inst *firstNonPhi() const {
+        Inst *I = insts.front();
+        while (I && I->opcode() == Opcode::PHI_U64)
+            I = I->next();
+        return I;
+    }
+    // Drops pred's incoming from every phi here; call when an edge goes away.
+    void removePhiIncomings(BasicBlock *pred) {
+        for (Inst *I = insts.front(); I && I->opcode() == Opcode::PHI_U64; I = I->next())
+            static_cast<PhiInst *>(I)->removeIncoming(pred);
+    }
+
+    void replacePhiIncomingBlock(BasicBlock *from, BasicBlock *to) {
+        for (Inst *I = insts.front(); I && I->opcode() == Opcode::PHI_U64; I = I->next())
+            static_cast<PhiInst *>(I)->replaceIncomingBlock(from, to);
+    }
+
+    // One indented line per instruction.
+    void print(TextWriter &w) const {
+        for (const Inst *I : insts) {
+            w << "    ";
+            I->print(w);
+            w.endLine();
         }
-        return s;
+    }
+    std::string toString() const {
+        TextWriter w;
+        print(w);
+        return w.take();
     }
 };
+
+// True if the block's ja reads flags set by a cmp in a predecessor.
+inline bool readsIncomingFlags(const BasicBlock *b) {
+    for (const Inst *I : b->insts) {
+        if (I->opcode() == Opcode::CMP_U64)
+            return false;
+        if (I->opcode() == Opcode::JA_U64)
+            return true;
+    }
+    return false;
+}
+
+inline std::string bbName(const BasicBlock *b) {
+    TextWriter w;
+    w.block(b);
+    return w.take();
+}
+inline void TextWriter::block(const BasicBlock *b) {
+    if (!b)
+        *this << "<null>";
+    else if (!b->label.empty())
+        *this << b->label;
+    else
+        *this << "bb" << static_cast<uint64_t>(b->id);
+}
+
+inline void Inst::removeFromParent() {
+    if (parent_)
+        parent_->insts.remove(this);
+}
+inline void Inst::moveBefore(Inst *pos) {
+    removeFromParent();
+    pos->parent_->insts.insert(pos, this);
+}
+inline void Inst::moveAfter(Inst *pos) {
+    removeFromParent();
+    pos->parent_->insts.insertAfter(pos, this);
+}
+inline void Inst::moveToEnd(BasicBlock *bb) {
+    removeFromParent();
+    bb->insts.push_back(this);
+}
 } 
@@ -0,0 +1,450 @@
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ir/id_map.h"
+#include "ir/ir_graph.h"
+
+namespace ir {
+
+// Binary form of an IRGraph: a header followed by flat tables addressed by
+// file offsets, each 8-byte aligned, in host byte order. Blocks are stored
+// in layout order and refer to their instructions and successors as index
+// ranges; an instruction refers to a range of operands; an operand holds a
+// value id, an immediate or a block index. Value and block ids are kept as
+// they are, so names like v12 and bb7 survive a round trip. Strings live in
+// one table and are referenced as (offset, length).
+//
+// BinaryView reads the tables in place, e.g. from a MappedFile, without
+// building anything; readBinary rebuilds an IRGraph from a view.
+namespace binary {
+constexpr char kMagic[4] = {'I', 'R', 'B', 'F'};
+constexpr uint16_t kVersion = 2;
+constexpr uint32_t kNone = ~0u;
+
+struct Str {
+    uint32_t off;
+    uint32_t len;
+};
+struct Header {
+    char magic[4];
+    uint16_t version;
+    uint16_t headerSize;
+    Str retType;
+    Str name;
+    uint32_t numBlocks, numInsts, numOperands, numSuccs, numValues, numArgs;
+    uint32_t stringsSize;
+    uint32_t reserved;
+    uint64_t blocksOff, instsOff, operandsOff, succsOff, valuesOff, argsOff, stringsOff;
+    uint64_t fileSize;
+};
+struct Block {
+    Str label;
+    uint32_t id;
+    uint32_t firstInst, numInsts;
+    uint32_t firstSucc, numSuccs;
+};
+struct Inst {
+    uint8_t opcode;
+    uint8_t reserved[3];
+    uint32_t result; // value id or kNone
+    uint32_t firstOperand, numOperands;
+};
+struct Operand {
+    uint8_t kind; // ir::Operand::Kind
+    uint8_t reserved[7];
+    uint64_t payload;
+};
+struct Value {
+    Str name;
+    uint32_t flags;
+};
+struct Arg {
+    Str type;
+    Str name;
+    uint32_t value; // value id or kNone
+};
+constexpr uint32_t kValueIsArg = 1;
+}
+
+inline std::vector<uint8_t> writeBinary(const IRGraph &g) {
+    using namespace binary;
+    std::vector<binary::Block> blocks;
+    std::vector<binary::Inst> insts;
+    std::vector<binary::Operand> operands;
+    std::vector<uint32_t> succs;
+    std::vector<binary::Value> values;
+    std::vector<binary::Arg> args;
+    std::string strings;
+    auto str = [&](const std::string &s) {
+        Str r{static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(s.size())};
+        strings += s;
+        return r;
+    };
+
+    BlockMap<uint32_t> index;
+    const auto &layout = g.getBlocks();
+    for (size_t i = 0; i < layout.size(); ++i)
+        index[layout[i]] = static_cast<uint32_t>(i);
+    std::vector<const SSAValue *> byId(g.valueIdBound());
+    for (const BasicBlock *bb : layout) {
+        binary::Block B{str(bb->label), bb->id, static_cast<uint32_t>(insts.size()), 0,
+                        static_cast<uint32_t>(succs.size()), static_cast<uint32_t>(bb->successors.size())};
+        for (const ir::Inst *I : bb->insts) {
+            binary::Inst R{};
+            R.opcode = static_cast<uint8_t>(I->opcode());
+            R.result = I->result() ? I->result()->id : kNone;
+            R.firstOperand = static_cast<uint32_t>(operands.size());
+            R.numOperands = static_cast<uint32_t>(I->numOperands());
+            if (I->result())
+                byId[I->result()->id] = I->result();
+            for (const ir::Operand &op : I->operands()) {
+                binary::Operand O{};
+                O.kind = static_cast<uint8_t>(op.kind);
+                if (op.isValue()) {
+                    O.payload = op.value()->id;
+                    byId[op.value()->id] = op.value();
+                } else if (op.isImm()) {
+                    O.payload = op.imm();
+                } else {
+                    O.payload = index.get(op.block());
+                }
+                operands.push_back(O);
+            }
+            insts.push_back(R);
+            ++B.numInsts;
+        }
+        for (const BasicBlock *s : bb->successors)
+            succs.push_back(index.get(s));
+        blocks.push_back(B);
+    }
+    for (const auto &a : g.args()) {
+        args.push_back({str(a.type), str(a.name), a.val ? a.val->id : kNone});
+        if (a.val)
+            byId[a.val->id] = a.val;
+    }
+    for (const SSAValue *v : byId)
+        values.push_back(v ? binary::Value{str(v->dbg_name), v->is_arg ? kValueIsArg : 0}
+                           : binary::Value{{0, 0}, 0});
+
+    Header H{};
+    std::memcpy(H.magic, kMagic, sizeof(kMagic));
+    H.version = kVersion;
+    H.headerSize = sizeof(Header);
+    H.retType = str(g.returnType());
+    H.name = str(g.name());
+    H.numBlocks = static_cast<uint32_t>(blocks.size());
+    H.numInsts = static_cast<uint32_t>(insts.size());
+    H.numOperands = static_cast<uint32_t>(operands.size());
+    H.numSuccs = static_cast<uint32_t>(succs.size());
+    H.numValues = static_cast<uint32_t>(values.size());
+    H.numArgs = static_cast<uint32_t>(args.size());
+    H.stringsSize = static_cast<uint32_t>(strings.size());
+
+    std::vector<uint8_t> out(sizeof(Header));
+    auto table = [&](const void *data, size_t bytes) {
+        out.resize((out.size() + 7) & ~size_t(7));
+        uint64_t off = out.size();
+        out.resize(off + bytes);
+        if (bytes)
+            std::memcpy(out.data() + off, data, bytes);
+        return off;
+    };
+    H.blocksOff = table(blocks.data(), blocks.size() * sizeof(binary::Block));
+    H.instsOff = table(insts.data(), insts.size() * sizeof(binary::Inst));
+    H.operandsOff = table(operands.data(), operands.size() * sizeof(binary::Operand));
+    H.succsOff = table(succs.data(), succs.size() * sizeof(uint32_t));
+    H.valuesOff = table(values.data(), values.size() * sizeof(binary::Value));
+    H.argsOff = table(args.data(), args.size() * sizeof(binary::Arg));
+    H.stringsOff = table(strings.data(), strings.size());
+    H.fileSize = out.size();
+    std::memcpy(out.data(), &H, sizeof(Header));
+    return out;
+}
+
+inline void writeBinaryFile(const IRGraph &g, const std::string &path) {
+    std::vector<uint8_t> bytes = writeBinary(g);
+    FILE *f = std::fopen(path.c_str(), "wb");
+    if (!f)
+        throw std::system_error(errno, std::generic_category(), "open " + path);
+    size_t n = std::fwrite(bytes.data(), 1, bytes.size(), f);
+    int err = errno;
+    if (std::fclose(f) != 0 || n != bytes.size())
+        throw std::system_error(err ? err : EIO, std::generic_category(), "write " + path);
+}
+
+// Read-only view of a serialized graph in memory that the caller keeps
+// alive. The constructor checks the header and that every table lies in
+// the buffer; readBinary checks the indexes inside the tables.
+class BinaryView {
+    const uint8_t *data_;
+    size_t size_;
+    const binary::Header *h_;
+
+    template <typename T>
+    const T *table(uint64_t off) const {
+        return reinterpret_cast<const T *>(data_ + off);
+    }
+    void checkTable(uint64_t off, uint64_t count, size_t elem, const char *what) const {
+        if (off % 8 != 0 || off > size_ || count > (size_ - off) / (elem ? elem : 1))
+            throw std::runtime_error(std::string("binary IR: bad ") + what + " table");
+    }
+
+  public:
+    BinaryView(const void *data, size_t size) : data_(static_cast<const uint8_t *>(data)), size_(size) {
+        if (size_ < sizeof(binary::Header) || reinterpret_cast<uintptr_t>(data_) % 8 != 0)
+            throw std::runtime_error("binary IR: truncated header");
+        h_ = table<binary::Header>(0);
+        if (std::memcmp(h_->magic, binary::kMagic, sizeof(binary::kMagic)) != 0)
+            throw std::runtime_error("binary IR: bad magic");
+        if (h_->version != binary::kVersion || h_->headerSize != sizeof(binary::Header))
+            throw std::runtime_error("binary IR: unsupported version");
+        if (h_->fileSize != size_)
+            throw std::runtime_error("binary IR: size mismatch");
+        checkTable(h_->blocksOff, h_->numBlocks, sizeof(binary::Block), "block");
+        checkTable(h_->instsOff, h_->numInsts, sizeof(binary::Inst), "instruction");
+        checkTable(h_->operandsOff, h_->numOperands, sizeof(binary::Operand), "operand");
+        checkTable(h_->succsOff, h_->numSuccs, sizeof(uint32_t), "successor");
+        checkTable(h_->valuesOff, h_->numValues, sizeof(binary::Value), "value");
+        checkTable(h_->argsOff, h_->numArgs, sizeof(binary::Arg), "argument");
+        if (h_->stringsOff > size_ || h_->stringsSize > size_ - h_->stringsOff)
+            throw std::runtime_error("binary IR: bad string table");
+    }
+
+    const binary::Header &header() const {
+        return *h_;
+    }
+    uint32_t numBlocks() const {
+        return h_->numBlocks;
+    }
+    uint32_t numInsts() const {
+        return h_->numInsts;
+    }
+    uint32_t numValues() const {
+        return h_->numValues;
+    }
+    uint32_t numArgs() const {
+        return h_->numArgs;
+    }
+    const binary::Block &block(uint32_t i) const {
+        return table<binary::Block>(h_->blocksOff)[i];
+    }
+    const binary::Inst &inst(uint32_t i) const {
+        return table<binary::Inst>(h_->instsOff)[i];
+    }
+    const binary::Operand &operand(uint32_t i) const {
+        return table<binary::Operand>(h_->operandsOff)[i];
+    }
+    uint32_t successor(uint32_t i) const {
+        return table<uint32_t>(h_->succsOff)[i];
+    }
+    const binary::Value &value(uint32_t id) const {
+        return table<binary::Value>(h_->valuesOff)[id];
+    }
+    const binary::Arg &arg(uint32_t i) const {
+        return table<binary::Arg>(h_->argsOff)[i];
+    }
+    std::string_view str(binary::Str s) const {
+        if (s.off > h_->stringsSize || s.len > h_->stringsSize - s.off)
+            throw std::runtime_error("binary IR: bad string reference");
+        return {reinterpret_cast<const char *>(data_ + h_->stringsOff + s.off), s.len};
+    }
+    std::string_view functionName() const {
+        return str(h_->name);
+    }
+};
+
+// Read-only private mapping of a whole file.
+class MappedFile {
+    void *base_ = nullptr;
+    size_t size_ = 0;
+
+  public:
+    explicit MappedFile(const std::string &path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::system_error(errno, std::generic_category(), "open " + path);
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            int err = errno;
+            ::close(fd);
+            throw std::system_error(err, std::generic_category(), "stat " + path);
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ > 0) {
+            void *p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                int err = errno;
+                ::close(fd);
+                throw std::system_error(err, std::generic_category(), "mmap " + path);
+            }
+            base_ = p;
+        }
+        ::close(fd);
+    }
+    ~MappedFile() {
+        if (base_)
+            munmap(base_, size_);
+    }
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&o) noexcept : base_(std::exchange(o.base_, nullptr)), size_(std::exchange(o.size_, 0)) {
+    }
+
+    const void *data() const {
+        return base_;
+    }
+    size_t size() const {
+        return size_;
+    }
+    BinaryView view() const {
+        return BinaryView(base_, size_);
+    }
+};
+
+// Rebuilds the serialized graph into g, which must be empty. Throws
+// std::runtime_error on out-of-range indexes, malformed instructions, a
+// value defined twice or used without a definition.
+inline void readBinary(const BinaryView &V, IRGraph &g) {
+    using namespace binary;
+    auto fail = [](const char *what) { throw std::runtime_error(std::string("binary IR: ") + what); };
+    const Header &H = V.header();
+
+    std::vector<SSAValue *> values(H.numValues);
+    for (uint32_t id = 0; id < H.numValues; ++id) {
+        const binary::Value &R = V.value(id);
+        values[id] = g.createValue(std::string(V.str(R.name)));
+        values[id]->is_arg = R.flags & kValueIsArg;
+    }
+    std::vector<IRGraph::Arg> args;
+    for (uint32_t i = 0; i < H.numArgs; ++i) {
+        const binary::Arg &A = V.arg(i);
+        if (A.value != kNone && A.value >= H.numValues)
+            fail("argument value out of range");
+        args.push_back({std::string(V.str(A.type)), std::string(V.str(A.name)),
+                        A.value == kNone ? nullptr : values[A.value]});
+    }
+    g.setSignature(std::string(V.str(H.retType)), std::string(V.functionName()), std::move(args));
+
+    std::vector<BasicBlock *> blocks(H.numBlocks);
+    std::vector<uint32_t> ids(H.numBlocks);
+    for (uint32_t i = 0; i < H.numBlocks; ++i) {
+        blocks[i] = g.createBlock(std::string(V.str(V.block(i).label)));
+        // Ids key dense side tables, so keep them within the file's size.
+        ids[i] = V.block(i).id;
+        if (ids[i] >= H.fileSize)
+            fail("block id out of range");
+    }
+    std::sort(ids.begin(), ids.end());
+    if (std::adjacent_find(ids.begin(), ids.end()) != ids.end())
+        fail("duplicate block id");
+    for (uint32_t i = 0; i < H.numBlocks; ++i)
+        g.setBlockId(blocks[i], V.block(i).id);
+
+    auto valueAt = [&](const binary::Operand &O) {
+        if (O.kind != static_cast<uint8_t>(ir::Operand::Kind::Value) || O.payload >= H.numValues)
+            fail("bad value operand");
+        return values[O.payload];
+    };
+    auto blockAt = [&](const binary::Operand &O) {
+        if (O.kind != static_cast<uint8_t>(ir::Operand::Kind::Block) || O.payload >= H.numBlocks)
+            fail("bad block operand");
+        return blocks[O.payload];
+    };
+    for (uint32_t b = 0; b < H.numBlocks; ++b) {
+        const binary::Block &B = V.block(b);
+        if (B.firstInst > H.numInsts || B.numInsts > H.numInsts - B.firstInst ||
+            B.firstSucc > H.numSuccs || B.numSuccs > H.numSuccs - B.firstSucc)
+            fail("block range out of bounds");
+        for (uint32_t i = B.firstInst; i < B.firstInst + B.numInsts; ++i) {
+            const binary::Inst &R = V.inst(i);
+            if (R.firstOperand > H.numOperands || R.numOperands > H.numOperands - R.firstOperand)
+                fail("operand range out of bounds");
+            if (R.result != kNone && R.result >= H.numValues)
+                fail("result out of range");
+            SSAValue *res = R.result == kNone ? nullptr : values[R.result];
+            Opcode opc = static_cast<Opcode>(R.opcode);
+            bool defines = opc == Opcode::MOVI_U64 || opc == Opcode::U32TOU64 || opc == Opcode::MUL_U64 ||
+                           opc == Opcode::ADDI_U64 || opc == Opcode::PHI_U64;
+            if (defines != (res != nullptr))
+                fail(defines ? "missing result" : "unexpected result");
+            if (res && (res->def || res->is_arg))
+                fail("value defined twice");
+            auto op = [&](uint32_t k) -> const binary::Operand & {
+                if (k >= R.numOperands)
+                    fail("missing operand");
+                return V.operand(R.firstOperand + k);
+            };
+            auto imm = [&](uint32_t k) {
+                if (op(k).kind != static_cast<uint8_t>(ir::Operand::Kind::Imm))
+                    fail("bad immediate operand");
+                return op(k).payload;
+            };
+            ir::Inst *I = nullptr;
+            switch (opc) {
+            case Opcode::MOVI_U64:
+                I = g.createMovi(res, imm(0));
+                break;
+            case Opcode::U32TOU64:
+                I = g.createCast(res, valueAt(op(0)));
+                break;
+            case Opcode::CMP_U64:
+                I = g.createCmp(valueAt(op(0)), valueAt(op(1)));
+                break;
+            case Opcode::JA_U64:
+                I = g.createJa(blockAt(op(0)));
+                break;
+            case Opcode::MUL_U64:
+                I = g.createMul(res, valueAt(op(0)), valueAt(op(1)));
+                break;
+            case Opcode::ADDI_U64:
+                I = g.createAddi(res, valueAt(op(0)), imm(1));
+                break;
+            case Opcode::JMP:
+                I = g.createJmp(blockAt(op(0)));
+                break;
+            case Opcode::RET_U64:
+                I = g.createRet(valueAt(op(0)));
+                break;
+            case Opcode::PHI_U64: {
+                if (R.numOperands % 2 != 0)
+                    fail("odd phi operand count");
+                std::vector<std::pair<BasicBlock *, SSAValue *>> incomings;
+                for (uint32_t k = 0; k < R.numOperands; k += 2)
+                    incomings.emplace_back(blockAt(op(k)), valueAt(op(k + 1)));
+                I = g.createPhi(res, incomings);
+                break;
+            }
+            default:
+                fail("unknown opcode");
+            }
+            if (I->numOperands() != R.numOperands)
+                fail("operand count mismatch");
+            blocks[b]->addInst(I);
+        }
+        for (uint32_t s = B.firstSucc; s < B.firstSucc + B.numSuccs; ++s) {
+            if (V.successor(s) >= H.numBlocks)
+                fail("successor out of range");
+            blocks[b]->addSuccessor(blocks[V.successor(s)]);
+        }
+    }
+    for (SSAValue *v : values)
+        if (!v->def && !v->is_arg && !v->users.empty())
+            fail("use of undefined value");
+}
+}
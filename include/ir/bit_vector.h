@@ -0,0 +1,89 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ir {
+
+// Fixed-size dense bitset over dense ids (block or value ids).
+class BitVector {
+    std::vector<uint64_t> words_;
+    size_t size_ = 0;
+
+    static size_t numWords(size_t n) {
+        return (n + 63) / 64;
+    }
+
+  public:
+    explicit BitVector(size_t n = 0) : words_(numWords(n), 0), size_(n) {
+    }
+
+    size_t size() const {
+        return size_;
+    }
+    void resize(size_t n) {
+        words_.resize(numWords(n), 0);
+        if (n < size_ && (n % 64))
+            words_.back() &= (uint64_t(1) << (n % 64)) - 1;
+        size_ = n;
+    }
+
+    bool test(size_t i) const {
+        return i < size_ && (words_[i / 64] >> (i % 64)) & 1;
+    }
+    void set(size_t i) {
+        words_[i / 64] |= uint64_t(1) << (i % 64);
+    }
+    void reset(size_t i) {
+        words_[i / 64] &= ~(uint64_t(1) << (i % 64));
+    }
+    void clear() {
+        for (auto &w : words_)
+            w = 0;
+    }
+
+    bool any() const {
+        for (auto w : words_)
+            if (w)
+                return true;
+        return false;
+    }
+    size_t count() const {
+        size_t n = 0;
+        for (auto w : words_)
+            n += static_cast<size_t>(__builtin_popcountll(w));
+        return n;
+    }
+
+    // this |= o; returns true if any bit changed. Sizes must match.
+    bool unionWith(const BitVector &o) {
+        bool changed = false;
+        for (size_t i = 0; i < words_.size(); ++i) {
+            uint64_t w = words_[i] | o.words_[i];
+            changed |= w != words_[i];
+            words_[i] = w;
+        }
+        return changed;
+    }
+    // this &= ~o
+    void subtract(const BitVector &o) {
+        for (size_t i = 0; i < words_.size(); ++i)
+            words_[i] &= ~o.words_[i];
+    }
+
+    bool operator==(const BitVector &o) const {
+        return size_ == o.size_ && words_ == o.words_;
+    }
+    bool operator!=(const BitVector &o) const {
+        return !(*this == o);
+    }
+
+    template <typename F>
+    void forEach(F f) const {
+        for (size_t i = 0; i < words_.size(); ++i) {
+            for (uint64_t w = words_[i]; w; w &= w - 1)
+                f(i * 64 + static_cast<size_t>(__builtin_ctzll(w)));
+        }
+    }
+};
+}
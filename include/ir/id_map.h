@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+#include "ir/basic_block.h"
+#include "ir/value.h"
+
+namespace ir {
+
+// Side table keyed by the dense per-graph id of a block or value. Backed by a
+// flat vector that grows on demand; missing entries read as the default.
+template <typename Key, typename T>
+class IdMap {
+    std::vector<T> data_;
+    T default_;
+
+  public:
+    using reference = typename std::vector<T>::reference;
+    using const_reference = typename std::vector<T>::const_reference;
+
+    explicit IdMap(size_t n = 0, T def = T()) : data_(n, def), default_(def) {
+    }
+
+    reference operator[](const Key *k) {
+        size_t i = k->id;
+        if (i >= data_.size())
+            data_.resize(i + 1, default_);
+        return data_[i];
+    }
+    const_reference operator[](const Key *k) const {
+        return get(k);
+    }
+    const_reference get(const Key *k) const {
+        size_t i = k->id;
+        return i < data_.size() ? data_[i] : default_;
+    }
+
+    void reserve(size_t n) {
+        if (n > data_.size())
+            data_.resize(n, default_);
+    }
+    void clear() {
+        data_.clear();
+    }
+    void assign(size_t n, T def = T()) {
+        default_ = def;
+        data_.assign(n, def);
+    }
+    size_t size() const {
+        return data_.size();
+    }
+};
+
+template <typename T>
+using BlockMap = IdMap<BasicBlock, T>;
+template <typename T>
+using ValueMap = IdMap<SSAValue, T>;
+}
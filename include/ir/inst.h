@@ -1,47 +1,156 @@
 #pragma once
 #include "ir/opcode.h"
+#include "ir/operand.h"
+#include "ir/text_writer.h"
 #include "ir/value.h"
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
-#include <sstream>
 
 namespace ir {
 
 class BasicBlock; 
+class InstList;
 
 
-static inline std::string bbName(const BasicBlock *b) {
-    
-    return b ? std::string("<bb>") : std::string("<null>");
-}
+// The block's label, or bb<id> for an unlabeled block (basic_block.h).
+inline std::string bbName(const BasicBlock *b);
+// The value's name, or v<id> for an unnamed one; see TextWriter::value.
 static inline std::string fmtVal(const SSAValue *v) {
-    if (!v)
-        return "<null>";
-    if (!v->dbg_name.empty())
-        return v->dbg_name;
-    return "v" + std::to_string(v->id);
+    TextWriter w;
+    w.value(v);
+    return w.take();
 }
 
 class Inst {
+    friend class InstList;
+    Inst *prev_ = nullptr;
+    Inst *next_ = nullptr;
+    BasicBlock *parent_ = nullptr;
+    Operand *ops_ = nullptr;
+    uint32_t num_ops_ = 0;
+
+  protected:
+    void setOperandStorage(Operand *ops, size_t n) {
+        ops_ = ops;
+        num_ops_ = static_cast<uint32_t>(n);
+    }
+
   public:
+    Inst() = default;
+    Inst(const Inst &) = delete;
+    Inst &operator=(const Inst &) = delete;
     virtual ~Inst() = default;
+
+    Inst *prev() const {
+        return prev_;
+    }
+    Inst *next() const {
+        return next_;
+    }
+    BasicBlock *parent() const {
+        return parent_;
+    }
+
+    void removeFromParent();
+    void moveBefore(Inst *pos);
+    void moveAfter(Inst *pos);
+    void moveToEnd(BasicBlock *bb);
+
+    // Rewrites every value operand equal to from, keeping both use lists
+    // in sync.
+    void replaceUsesOfWith(SSAValue *from, SSAValue *to) {
+        for (uint32_t i = 0; i < num_ops_; ++i) {
+            if (!ops_[i].isValue() || ops_[i].value() != from)
+                continue;
+            ops_[i] = Operand::ofValue(to);
+            if (from)
+                from->removeUser(this);
+            if (to)
+                to->addUser(this);
+        }
+    }
+    // Retargets every block operand equal to from (a branch target or a phi
+    // incoming edge).
+    void replaceBlockOperand(const BasicBlock *from, BasicBlock *to) {
+        for (uint32_t i = 0; i < num_ops_; ++i)
+            if (ops_[i].isBlock() && ops_[i].block() == from)
+                ops_[i] = Operand::ofBlock(to);
+    }
+    // Unregisters this inst from the users of its operands and clears them.
+    void dropAllReferences() {
+        for (uint32_t i = 0; i < num_ops_; ++i) {
+            if (!ops_[i].isValue())
+                continue;
+            if (auto *v = ops_[i].value())
+                v->removeUser(this);
+            ops_[i] = Operand::ofValue(nullptr);
+        }
+    }
+    // Unlinks and drops references; the memory stays owned by the arena.
+    void eraseFromParent() {
+        dropAllReferences();
+        removeFromParent();
+    }
+
     virtual Opcode opcode() const = 0;
     
     virtual SSAValue *result() const {
         return nullptr;
     }
     
-    virtual std::vector<Value> operands() const = 0;
-    virtual std::string toString() const = 0;
+    OperandSpan operands() const {
+        return OperandSpan(ops_, num_ops_);
+    }
+    size_t numOperands() const {
+        return num_ops_;
+    }
+    const Operand &operand(size_t i) const {
+        return ops_[i];
+    }
+    // Writes the instruction as one line of IR text, without indentation
+    // or newline.
+    virtual void print(TextWriter &w) const = 0;
+    std::string toString() const {
+        TextWriter w;
+        print(w);
+        return w.take();
+    }
+
+    bool isCommutative() const {
+        return opcode() == Opcode::MUL_U64;
+    }
+    // Structural identity: same opcode and operands (either order for a
+    // commutative op). The result is ignored, so two identical insts
+    // compute the same value.
+    virtual size_t hash() const {
+        size_t h = static_cast<size_t>(opcode()) * 0x9e3779b97f4a7c15ULL;
+        if (isCommutative() && num_ops_ == 2)
+            return h ^ (ops_[0].hash() + ops_[1].hash());
+        for (uint32_t i = 0; i < num_ops_; ++i)
+            h = (h ^ ops_[i].hash()) * 0x100000001b3ULL;
+        return h;
+    }
+    virtual bool isIdenticalTo(const Inst *o) const {
+        if (opcode() != o->opcode() || num_ops_ != o->num_ops_)
+            return false;
+        if (isCommutative() && num_ops_ == 2 && ops_[0] == o->ops_[1] && ops_[1] == o->ops_[0])
+            return true;
+        for (uint32_t i = 0; i < num_ops_; ++i)
+            if (ops_[i] != o->ops_[i])
+                return false;
+        return true;
+    }
 };
 
 class MoviInst : public Inst {
     SSAValue *res_;
-    uint64_t imm_;
+    Operand slots_[1];
 
   public:
-    MoviInst(SSAValue *res, uint64_t imm) : res_(res), imm_(imm) {
+    MoviInst(SSAValue *res, uint64_t imm) : res_(res), slots_{Operand::ofImm(imm)} {
+        setOperandStorage(slots_, 1);
         if (res_)
             res_->def = this;
     }
@@ -51,26 +160,27 @@ class MoviInst : public Inst {
     SSAValue *result() const override {
         return res_;
     }
-    std::vector<Value> operands() const override {
-        return {Value{imm_}};
+    uint64_t imm() const {
+        return slots_[0].imm();
     }
-    std::string toString() const override {
-        std::ostringstream oss;
-        oss << "movi.u64    " << fmtVal(res_) << ", " << imm_;
-        return oss.str();
+    void print(TextWriter &w) const override {
+        w.mnemonic("movi.u64");
+        w.value(res_);
+        w << ", " << imm();
     }
 };
 
 class CastInst : public Inst {
     SSAValue *res_;
-    SSAValue *src_;
+    Operand slots_[1];
 
   public:
-    CastInst(SSAValue *res, SSAValue *src) : res_(res), src_(src) {
+    CastInst(SSAValue *res, SSAValue *src) : res_(res), slots_{Operand::ofValue(src)} {
+        setOperandStorage(slots_, 1);
         if (res_)
             res_->def = this;
-        if (src_)
-            src_->addUser(this);
+        if (src)
+            src->addUser(this);
     }
     Opcode opcode() const override {
         return Opcode::U32TOU64;
@@ -78,71 +188,79 @@ class CastInst : public Inst {
     SSAValue *result() const override {
         return res_;
     }
-    std::vector<Value> operands() const override {
-        return {Value{src_}};
+    SSAValue *src() const {
+        return slots_[0].value();
     }
-    std::string toString() const override {
-        std::ostringstream oss;
-        oss << "u32tou64    " << fmtVal(res_) << ", " << fmtVal(src_);
-        return oss.str();
+    void print(TextWriter &w) const override {
+        w.mnemonic("u32tou64");
+        w.value(res_);
+        w << ", ";
+        w.value(src());
     }
 };
 
 class CmpInst : public Inst {
-    SSAValue *left_;
-    SSAValue *right_;
+    Operand slots_[2];
 
   public:
-    CmpInst(SSAValue *left, SSAValue *right) : left_(left), right_(right) {
-        if (left_)
-            left_->addUser(this);
-        if (right_)
-            right_->addUser(this);
+    CmpInst(SSAValue *left, SSAValue *right)
+        : slots_{Operand::ofValue(left), Operand::ofValue(right)} {
+        setOperandStorage(slots_, 2);
+        if (left)
+            left->addUser(this);
+        if (right)
+            right->addUser(this);
     }
     Opcode opcode() const override {
         return Opcode::CMP_U64;
     }
-    std::vector<Value> operands() const override {
-        return {Value{left_}, Value{right_}};
+    SSAValue *left() const {
+        return slots_[0].value();
+    }
+    SSAValue *right() const {
+        return slots_[1].value();
     }
-    std::string toString() const override {
-        std::ostringstream oss;
-        oss << "cmp.u64     " << fmtVal(left_) << ", " << fmtVal(right_);
-        return oss.str();
+    void print(TextWriter &w) const override {
+        w.mnemonic("cmp.u64");
+        w.value(left());
+        w << ", ";
+        w.value(right());
     }
 };
 
 class JaInst : public Inst {
-    BasicBlock *target_;
+    Operand slots_[1];
 
   public:
-    explicit JaInst(BasicBlock *target) : target_(target) {
+    explicit JaInst(BasicBlock *target) : slots_{Operand::ofBlock(target)} {
+        setOperandStorage(slots_, 1);
     }
     Opcode opcode() const override {
         return Opcode::JA_U64;
     }
-    std::vector<Value> operands() const override {
-        return {Value{bbName(target_)}};
+    BasicBlock *target() const {
+        return slots_[0].block();
     }
-    std::string toString() const override {
-        return "ja          " + bbName(target_);
+    void print(TextWriter &w) const override {
+        w.mnemonic("ja");
+        w.block(target());
     }
 };
 
 class MulInst : public Inst {
     SSAValue *res_;
-    SSAValue *left_;
-    SSAValue *right_;
+    Operand slots_[2];
 
   public:
     MulInst(SSAValue *res, SSAValue *left, SSAValue *right)
-        : res_(res), left_(left), right_(right) {
+        : res_(res), slots_{Operand::ofValue(left), Operand::ofValue(right)} {
+        setOperandStorage(slots_, 2);
         if (res_)
             res_->def = this;
-        if (left_)
-            left_->addUser(this);
-        if (right_)
-            right_->addUser(this);
+        if (left)
+            left->addUser(this);
+        if (right)
+            right->addUser(this);
     }
     Opcode opcode() const override {
         return Opcode::MUL_U64;
@@ -150,28 +268,34 @@ class MulInst : public Inst {
     SSAValue *result() const override {
         return res_;
     }
-    std::vector<Value> operands() const override {
-        return {Value{left_}, Value{right_}};
+    SSAValue *left() const {
+        return slots_[0].value();
     }
-    std::string toString() const override {
-        std::ostringstream oss;
-        oss << "mul.u64     " << fmtVal(res_) << ", " << fmtVal(left_) << ", " << fmtVal(right_);
-        return oss.str();
+    SSAValue *right() const {
+        return slots_[1].value();
+    }
+    void print(TextWriter &w) const override {
+        w.mnemonic("mul.u64");
+        w.value(res_);
+        w << ", ";
+        w.value(left());
+        w << ", ";
+        w.value(right());
     }
 };
 
 class AddiInst : public Inst {
     SSAValue *res_;
-    SSAValue *src_;
-    uint64_t imm_;
+    Operand slots_[2];
 
   public:
     AddiInst(SSAValue *res, SSAValue *src, uint64_t imm)
-        : res_(res), src_(src), imm_(imm) {
+        : res_(res), slots_{Operand::ofValue(src), Operand::ofImm(imm)} {
+        setOperandStorage(slots_, 2);
         if (res_)
             res_->def = this;
-        if (src_)
-            src_->addUser(this);
+        if (src)
+            src->addUser(this);
     }
     Opcode opcode() const override {
         return Opcode::ADDI_U64;
@@ -179,66 +303,79 @@ class AddiInst : public Inst {
     SSAValue *result() const override {
         return res_;
     }
-    std::vector<Value> operands() const override {
-        return {Value{src_}, Value{imm_}};
+    SSAValue *src() const {
+        return slots_[0].value();
+    }
+    uint64_t imm() const {
+        return slots_[1].imm();
     }
-    std::string toString() const override {
-        std::ostringstream oss;
-        oss << "addi.u64    " << fmtVal(res_) << ", " << fmtVal(src_) << ", " << imm_;
-        return oss.str();
+    void print(TextWriter &w) const override {
+        w.mnemonic("addi.u64");
+        w.value(res_);
+        w << ", ";
+        w.value(src());
+        w << ", " << imm();
     }
 };
 
 class JmpInst : public Inst {
-    BasicBlock *target_;
+    Operand slots_[1];
 
   public:
-    explicit JmpInst(BasicBlock *target) : target_(target) {
+    explicit JmpInst(BasicBlock *target) : slots_{Operand::ofBlock(target)} {
+        setOperandStorage(slots_, 1);
     }
     Opcode opcode() const override {
         return Opcode::JMP;
     }
-    std::vector<Value> operands() const override {
-        return {Value{bbName(target_)}};
+    BasicBlock *target() const {
+        return slots_[0].block();
     }
-    std::string toString() const override {
-        return "jmp         " + bbName(target_);
+    void print(TextWriter &w) const override {
+        w.mnemonic("jmp");
+        w.block(target());
     }
 };
 
 class RetInst : public Inst {
-    SSAValue *src_;
+    Operand slots_[1];
 
   public:
-    explicit RetInst(SSAValue *src) : src_(src) {
-        if (src_)
-            src_->addUser(this);
+    explicit RetInst(SSAValue *src) : slots_{Operand::ofValue(src)} {
+        setOperandStorage(slots_, 1);
+        if (src)
+            src->addUser(this);
     }
     Opcode opcode() const override {
         return Opcode::RET_U64;
     }
-    std::vector<Value> operands() const override {
-        return {Value{src_}};
+    SSAValue *src() const {
+        return slots_[0].value();
     }
-    std::string toString() const override {
-        return "ret.u64     " + fmtVal(src_);
+    void print(TextWriter &w) const override {
+        w.mnemonic("ret.u64");
+        w.value(src());
     }
 };
 
+// Incomings are stored as interleaved (block, value) operand pairs.
 class PhiInst : public Inst {
     SSAValue *res_;
-    std::vector<std::pair<BasicBlock *, SSAValue *>> sources_;
+    std::vector<Operand> slots_;
 
   public:
-    PhiInst(SSAValue *res, std::vector<std::pair<BasicBlock *, SSAValue *>> sources)
-        : res_(res), sources_(std::move(sources)) {
-        if (res_)
-            res_->def = this;
-        for (auto &[bb, val] : sources_) {
-            (void)bb;
+    PhiInst(SSAValue *res, const std::vector<std::pair<BasicBlock *, SSAValue *>> &sources)
+        : res_(res) {
+        slots_.reserve(sources.size() * 2);
+        for (auto &[bb, val] : sources) {
+            slots_.push_back(Operand::ofBlock(bb));
+            slots_.push_back(Operand::ofValue(val));
             if (val)
                 val->addUser(this);
         }
+        setOperandStorage(slots_.data(), slots_.size());
+        if (res_)
+            res_->def = this;
     }
     Opcode opcode() const override {
         return Opcode::PHI_U64;
@@ -246,26 +383,88 @@ class PhiInst : public Inst {
     SSAValue *result() const override {
         return res_;
     }
-    std::vector<Value> operands() const override {
-        std::vector<Value> ops;
-        ops.reserve(sources_.size());
-        for (auto &p : sources_)
-            ops.push_back(Value{p.second});
-        return ops;
+    size_t numIncomings() const {
+        return slots_.size() / 2;
+    }
+    BasicBlock *incomingBlock(size_t i) const {
+        return slots_[2 * i].block();
+    }
+    SSAValue *incomingValue(size_t i) const {
+        return slots_[2 * i + 1].value();
+    }
+    void addIncoming(BasicBlock *bb, SSAValue *val) {
+        slots_.push_back(Operand::ofBlock(bb));
+        slots_.push_back(Operand::ofValue(val));
+        setOperandStorage(slots_.data(), slots_.size());
+        if (val)
+            val->addUser(this);
+    }
+    // Drops the first incoming from bb; returns false if there was none.
+    bool removeIncoming(const BasicBlock *bb) {
+        for (size_t i = 0; i < numIncomings(); ++i) {
+            if (incomingBlock(i) != bb)
+                continue;
+            if (auto *v = incomingValue(i))
+                v->removeUser(this);
+            slots_.erase(slots_.begin() + 2 * i, slots_.begin() + 2 * i + 2);
+            setOperandStorage(slots_.data(), slots_.size());
+            return true;
+        }
+        return false;
     }
-    const auto &incomings() const {
-        return sources_;
+    void replaceIncomingBlock(const BasicBlock *from, BasicBlock *to) {
+        for (size_t i = 0; i < numIncomings(); ++i)
+            if (incomingBlock(i) == from)
+                slots_[2 * i] = Operand::ofBlock(to);
+    }
+    SSAValue *incomingFor(const BasicBlock *bb) const {
+        for (size_t i = 0; i < numIncomings(); ++i)
+            if (incomingBlock(i) == bb)
+                return incomingValue(i);
+        return nullptr;
     }
-    std::string toString() const override {
-        std::ostringstream oss;
-        oss << "phi.u64     " << fmtVal(res_) << " = ";
-        for (size_t i = 0; i < sources_.size(); ++i) {
+    // Phis are identical when they sit in the same block and agree on every
+    // incoming edge, in any order.
+    size_t hash() const override {
+        size_t h = std::hash<const void *>()(parent());
+        for (size_t i = 0; i < numIncomings(); ++i)
+            h += slots_[2 * i].hash() ^ (slots_[2 * i + 1].hash() * 31);
+        return h;
+    }
+    bool isIdenticalTo(const Inst *o) const override {
+        if (o->opcode() != Opcode::PHI_U64 || o->parent() != parent())
+            return false;
+        auto *P = static_cast<const PhiInst *>(o);
+        if (P->numIncomings() != numIncomings())
+            return false;
+        for (size_t i = 0; i < numIncomings(); ++i)
+            if (P->incomingFor(incomingBlock(i)) != incomingValue(i))
+                return false;
+        return true;
+    }
+    void print(TextWriter &w) const override {
+        w.mnemonic("phi.u64");
+        w.value(res_);
+        w << " = ";
+        for (size_t i = 0; i < numIncomings(); ++i) {
             if (i > 0)
-                oss << ", ";
-            oss << bbName(sources_[i].first) << ": " << fmtVal(sources_[i].second);
+                w << ", ";
+            w.block(incomingBlock(i));
+            w << ": ";
+            w.value(incomingValue(i));
         }
-        return oss.str();
     }
 };
 
-} 
\ No newline at end of file
+inline void SSAValue::replaceAllUsesWith(SSAValue *to) {
+    if (to == this)
+        return;
+    while (!users.empty()) {
+        size_t before = users.size();
+        users.back()->replaceUsesOfWith(this, to);
+        if (users.size() == before) // stale entry, no matching operand
+            users.pop_back();
+    }
+}
+
+}
@@ -0,0 +1,140 @@
+#pragma once
+#include <cstddef>
+#include <iterator>
+
+#include "ir/inst.h"
+
+namespace ir {
+
+class BasicBlock;
+
+// Intrusive doubly-linked list of the instructions of one block. The links
+// live in Inst itself, so insertion, removal and splicing never allocate.
+class InstList {
+    BasicBlock *owner_;
+    Inst *head_ = nullptr;
+    Inst *tail_ = nullptr;
+    size_t size_ = 0;
+
+    void link(Inst *pos, Inst *I) {
+        I->parent_ = owner_;
+        I->next_ = pos;
+        I->prev_ = pos ? pos->prev_ : tail_;
+        if (I->prev_)
+            I->prev_->next_ = I;
+        else
+            head_ = I;
+        if (pos)
+            pos->prev_ = I;
+        else
+            tail_ = I;
+        ++size_;
+    }
+
+  public:
+    template <typename T>
+    class Iter {
+        T *cur_;
+
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T *;
+        using difference_type = std::ptrdiff_t;
+        using pointer = T **;
+        using reference = T *;
+
+        explicit Iter(T *cur = nullptr) : cur_(cur) {
+        }
+        T *operator*() const {
+            return cur_;
+        }
+        Iter &operator++() {
+            cur_ = cur_->next();
+            return *this;
+        }
+        Iter operator++(int) {
+            Iter tmp = *this;
+            ++*this;
+            return tmp;
+        }
+        bool operator==(const Iter &o) const {
+            return cur_ == o.cur_;
+        }
+        bool operator!=(const Iter &o) const {
+            return cur_ != o.cur_;
+        }
+    };
+    using iterator = Iter<Inst>;
+    using const_iterator = Iter<const Inst>;
+
+    explicit InstList(BasicBlock *owner) : owner_(owner) {
+    }
+    InstList(const InstList &) = delete;
+    InstList &operator=(const InstList &) = delete;
+
+    iterator begin() {
+        return iterator(head_);
+    }
+    iterator end() {
+        return iterator();
+    }
+    const_iterator begin() const {
+        return const_iterator(head_);
+    }
+    const_iterator end() const {
+        return const_iterator();
+    }
+
+    Inst *front() const {
+        return head_;
+    }
+    Inst *back() const {
+        return tail_;
+    }
+    bool empty() const {
+        return size_ == 0;
+    }
+    size_t size() const {
+        return size_;
+    }
+
+    void push_back(Inst *I) {
+        link(nullptr, I);
+    }
+    void push_front(Inst *I) {
+        link(head_, I);
+    }
+    // Inserts I before pos; a null pos appends.
+    void insert(Inst *pos, Inst *I) {
+        link(pos, I);
+    }
+    void insertAfter(Inst *pos, Inst *I) {
+        link(pos ? pos->next_ : head_, I);
+    }
+
+    void remove(Inst *I) {
+        if (I->prev_)
+            I->prev_->next_ = I->next_;
+        else
+            head_ = I->next_;
+        if (I->next_)
+            I->next_->prev_ = I->prev_;
+        else
+            tail_ = I->prev_;
+        I->prev_ = I->next_ = nullptr;
+        I->parent_ = nullptr;
+        --size_;
+    }
+
+    // Moves [first, last) out of `from` and inserts it before pos (null pos
+    // appends). A null last means "to the end of from".
+    void splice(Inst *pos, InstList &from, Inst *first, Inst *last = nullptr) {
+        for (Inst *I = first; I != last;) {
+            Inst *next = I->next_;
+            from.remove(I);
+            link(pos, I);
+            I = next;
+        }
+    }
+};
+}
@@ -1,25 +1,54 @@
 #pragma once
+#include "ir/arena.h"
 #include "ir/basic_block.h"
+#include "ir/id_map.h"
 #include "ir/inst.h"
 #include <map>
 #include <memory>
 #include <vector>
 #include <algorithm>
+#include <cassert>
 #include <set>
 #include <iostream>
 
 namespace ir {
+// The successors the text form of a block implies: a jmp's target; a ja's
+// layout fall-through, then its target; none after a ret; otherwise the
+// next block in layout.
+inline std::vector<BasicBlock *> impliedSuccessors(const BasicBlock *bb, BasicBlock *layoutNext) {
+    std::vector<BasicBlock *> succs;
+    const Inst *T = bb->insts.back();
+    Opcode op = T ? T->opcode() : Opcode::PHI_U64;
+    if (op == Opcode::JMP) {
+        succs.push_back(static_cast<const JmpInst *>(T)->target());
+    } else if (op != Opcode::RET_U64) {
+        if (layoutNext)
+            succs.push_back(layoutNext);
+        if (op == Opcode::JA_U64)
+            succs.push_back(static_cast<const JaInst *>(T)->target());
+    }
+    return succs;
+}
+
 struct Arg {
     std::string type;
     std::string name;
 };
 
 class IRGraph {
+    Arena arena_;
+    uint64_t *cfg_epoch_ = arena_.create<uint64_t>(0);
     std::map<std::string, BasicBlock *> labelToBlock;
-    std::vector<std::unique_ptr<BasicBlock>> blocks;
+    std::vector<BasicBlock *> blocks;
 
+    uint32_t next_block_id_ = 0;
     uint32_t next_val_id_ = 0;
-    std::vector<std::unique_ptr<SSAValue>> all_values_;
+    std::vector<SSAValue *> all_values_;
+
+    template <typename T, typename... Args>
+    T *createInst(Args &&...args) {
+        return arena_.create<T>(std::forward<Args>(args)...);
+    }
 
   public:
     struct Arg {
@@ -28,17 +57,21 @@ class IRGraph {
         SSAValue *val{nullptr};
     };
 
+  private:
+    // Set through setSignature; a new graph is an unnamed function of no
+    // arguments.
     std::string func_ret_ = "u64";
-    std::string func_name_ = "fact";
-    std::vector<Arg> func_args_ = {{"u32", "a0"}};
+    std::string func_name_;
+    std::vector<Arg> func_args_;
+
+  public:
 
     SSAValue *createValue(std::string dbg = "") {
-        auto v = std::make_unique<SSAValue>();
+        auto *v = arena_.create<SSAValue>();
         v->id = next_val_id_++;
         v->dbg_name = std::move(dbg);
-        auto *ptr = v.get();
-        all_values_.push_back(std::move(v));
-        return ptr;
+        all_values_.push_back(v);
+        return v;
     }
 
     SSAValue *createArg(const std::string &type, const std::string &name) {
@@ -54,13 +87,80 @@ class IRGraph {
         return v;
     }
 
+    // Labels stay unique, so printed names are too: a label that is taken,
+    // or has the bb<N> form bbName gives unlabeled blocks, gets ".<id>"
+    // appended.
     BasicBlock *createBlock(const std::string &lbl = "") {
-        auto bb = std::make_unique<BasicBlock>(lbl);
-        auto *ptr = bb.get();
-        if (!lbl.empty())
-            labelToBlock[lbl] = ptr;
-        blocks.push_back(std::move(bb));
-        return ptr;
+        auto *bb = arena_.create<BasicBlock>(lbl);
+        bb->id = next_block_id_++;
+        bb->cfg_epoch = cfg_epoch_;
+        ++*cfg_epoch_;
+        if (!lbl.empty()) {
+            while (labelToBlock.count(bb->label) || isUnlabeledName(bb->label))
+                bb->label += "." + std::to_string(bb->id);
+            labelToBlock[bb->label] = bb;
+        }
+        blocks.push_back(bb);
+        return bb;
+    }
+    // bb<N>, the name of an unlabeled block.
+    static bool isUnlabeledName(const std::string &s) {
+        return s.size() > 2 && s.compare(0, 2, "bb") == 0 && (s[2] != '0' || s.size() == 3) &&
+               std::all_of(s.begin() + 2, s.end(), [](char c) { return c >= '0' && c <= '9'; });
+    }
+    // Gives bb a new id, which no other block may have. Only for builders
+    // such as the text parser, before anything is keyed by the old id.
+    void setBlockId(BasicBlock *bb, uint32_t id) {
+        bb->id = id;
+        next_block_id_ = std::max(next_block_id_, id + 1);
+    }
+
+    // Unlinks the given blocks (never the entry): their instructions drop
+    // their operands, every edge touching them goes away along with the
+    // matching phi incomings in surviving successors. Memory stays in the
+    // arena; ids are not reused.
+    void eraseBlocks(const std::vector<BasicBlock *> &dead) {
+        if (dead.empty())
+            return;
+        std::set<const BasicBlock *> doomed(dead.begin(), dead.end());
+        assert(!doomed.count(entry()) && "cannot erase the entry block");
+        for (auto *bb : dead)
+            for (Inst *I : bb->insts)
+                I->dropAllReferences();
+        for (auto *bb : dead) {
+            while (!bb->successors.empty()) {
+                BasicBlock *s = bb->successors.back();
+                if (!doomed.count(s))
+                    s->removePhiIncomings(bb);
+                bb->removeSuccessor(s);
+            }
+            while (!bb->predecessors.empty())
+                bb->predecessors.back()->removeSuccessor(bb);
+            while (Inst *I = bb->insts.front())
+                I->removeFromParent();
+            if (!bb->label.empty()) {
+                auto it = labelToBlock.find(bb->label);
+                if (it != labelToBlock.end() && it->second == bb)
+                    labelToBlock.erase(it);
+            }
+        }
+        blocks.erase(std::remove_if(blocks.begin(), blocks.end(),
+                                    [&](BasicBlock *b) { return doomed.count(b) != 0; }),
+                     blocks.end());
+        ++*cfg_epoch_;
+    }
+    void eraseBlock(BasicBlock *bb) {
+        eraseBlocks({bb});
+    }
+
+    BasicBlock *entry() const {
+        return blocks.empty() ? nullptr : blocks.front();
+    }
+    const std::vector<BasicBlock *> &getBlocks() const {
+        return blocks;
+    }
+    uint64_t cfgEpoch() const {
+        return *cfg_epoch_;
     }
 
     BasicBlock *getBlock(const std::string &lbl) const {
@@ -68,55 +168,121 @@ class IRGraph {
         return it != labelToBlock.end() ? it->second : nullptr;
     }
 
-    std::unique_ptr<Inst> createMovi(SSAValue *res, uint64_t imm) {
-        return std::make_unique<MoviInst>(res, imm);
+    MoviInst *createMovi(SSAValue *res, uint64_t imm) {
+        return createInst<MoviInst>(res, imm);
     }
-    std::unique_ptr<Inst> createCast(SSAValue *res, SSAValue *src) {
-        return std::make_unique<CastInst>(res, src);
+    CastInst *createCast(SSAValue *res, SSAValue *src) {
+        return createInst<CastInst>(res, src);
     }
-    std::unique_ptr<Inst> createCmp(SSAValue *left, SSAValue *right) {
-        return std::make_unique<CmpInst>(left, right);
+    CmpInst *createCmp(SSAValue *left, SSAValue *right) {
+        return createInst<CmpInst>(left, right);
     }
-    std::unique_ptr<Inst> createJa(BasicBlock *target) {
-        return std::make_unique<JaInst>(target);
+    JaInst *createJa(BasicBlock *target) {
+        return createInst<JaInst>(target);
     }
-    std::unique_ptr<Inst> createMul(SSAValue *res, SSAValue *left, SSAValue *right) {
-        return std::make_unique<MulInst>(res, left, right);
+    MulInst *createMul(SSAValue *res, SSAValue *left, SSAValue *right) {
+        return createInst<MulInst>(res, left, right);
     }
-    std::unique_ptr<Inst> createAddi(SSAValue *res, SSAValue *src, uint64_t imm) {
-        return std::make_unique<AddiInst>(res, src, imm);
+    AddiInst *createAddi(SSAValue *res, SSAValue *src, uint64_t imm) {
+        return createInst<AddiInst>(res, src, imm);
     }
-    std::unique_ptr<Inst> createJmp(BasicBlock *target) {
-        return std::make_unique<JmpInst>(target);
+    JmpInst *createJmp(BasicBlock *target) {
+        return createInst<JmpInst>(target);
     }
-    std::unique_ptr<Inst> createRet(SSAValue *src) {
-        return std::make_unique<RetInst>(src);
+    RetInst *createRet(SSAValue *src) {
+        return createInst<RetInst>(src);
     }
-    std::unique_ptr<Inst> createPhi(SSAValue *res, std::vector<std::pair<BasicBlock *, SSAValue *>> sources) {
-        return std::make_unique<PhiInst>(res, std::move(sources));
+    PhiInst *createPhi(SSAValue *res, const std::vector<std::pair<BasicBlock *, SSAValue *>> &sources) {
+        return createInst<PhiInst>(res, sources);
     }
 
+    size_t numBlocks() const {
+        return blocks.size();
+    }
+    // Walks every block; O(blocks).
+    size_t numInsts() const {
+        size_t n = 0;
+        for (const BasicBlock *bb : blocks)
+            n += bb->insts.size();
+        return n;
+    }
+    size_t numValues() const {
+        return all_values_.size();
+    }
+    uint32_t blockIdBound() const {
+        return next_block_id_;
+    }
+    uint32_t valueIdBound() const {
+        return next_val_id_;
+    }
+    const Arena &arena() const {
+        return arena_;
+    }
+
+    // createArg binds an argument's value by type and name, so set the
+    // signature before creating the arguments.
     void setSignature(std::string ret, std::string name, std::vector<Arg> args) {
         func_ret_ = std::move(ret);
         func_name_ = std::move(name);
         func_args_ = std::move(args);
     }
+    const std::string &returnType() const {
+        return func_ret_;
+    }
+    const std::string &name() const {
+        return func_name_;
+    }
+    const std::vector<Arg> &args() const {
+        return func_args_;
+    }
+
+    // Replaces the block order; order must hold every block exactly once.
+    // Its first block becomes the entry.
+    void setLayout(std::vector<BasicBlock *> order) {
+        assert(order.size() == blocks.size() && "layout must be a permutation of the blocks");
+        blocks = std::move(order);
+        ++*cfg_epoch_;
+    }
 
-    void print() const {
-        std::cout << func_ret_ << " " << func_name_ << "(";
+    // Every block gets a label line with its name (see bbName). When its
+    // successors are not the ones impliedSuccessors gives, in any order,
+    // the line lists them after "; succs:", so parseText (ir/text_parser.h)
+    // can rebuild the exact CFG. Output goes through one buffered
+    // TextWriter.
+    void print(TextWriter &w) const {
+        w << func_ret_ << ' ' << func_name_ << '(';
         for (size_t i = 0; i < func_args_.size(); ++i) {
-            std::cout << func_args_[i].type << " " << func_args_[i].name;
-            if (i + 1 < func_args_.size())
-                std::cout << ", ";
+            if (i > 0)
+                w << ", ";
+            w << func_args_[i].type << ' ' << func_args_[i].name;
         }
-        std::cout << "):\n";
-        for (const auto &bb : blocks) {
-            if (!bb->label.empty() && bb->label != "entry" && bb->label != "body") {
-                std::cout << bb->label << ":\n";
+        w << "):";
+        w.endLine();
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            const BasicBlock *bb = blocks[i];
+            w.block(bb);
+            w << ':';
+            auto implied = impliedSuccessors(bb, i + 1 < blocks.size() ? blocks[i + 1] : nullptr);
+            if (!std::is_permutation(implied.begin(), implied.end(), bb->successors.begin(), bb->successors.end())) {
+                w << "  ; succs:";
+                for (size_t k = 0; k < bb->successors.size(); ++k) {
+                    w << (k ? ", " : " ");
+                    w.block(bb->successors[k]);
+                }
             }
-            std::cout << bb->toString();
+            w.endLine();
+            bb->print(w);
         }
     }
+    void print(std::ostream &os = std::cout) const {
+        TextWriter w(os);
+        print(w);
+    }
+    std::string toString() const {
+        TextWriter w;
+        print(w);
+        return w.take();
+    }
 
     bool checkControlFlow(const std::map<std::string, std::vector<std::string>> &expected) const {
         for (const auto &bb : blocks) {
@@ -137,17 +303,16 @@ class IRGraph {
 
     bool checkDataFlow() const {
         for (const auto &bb : blocks) {
-            for (const auto &up : bb->insts) {
-                const Inst *I = up.get();
+            for (const Inst *I : bb->insts) {
 
                 if (auto *r = I->result()) {
                     if (r->def != I)
                         return false;
                 }
 
-                for (const auto &op : I->operands()) {
-                    if (std::holds_alternative<SSAValue *>(op)) {
-                        auto *v = std::get<SSAValue *>(op);
+                for (const Operand &op : I->operands()) {
+                    if (op.isValue()) {
+                        auto *v = op.value();
                         if (!v)
                             return false;
                         if (!v->is_arg && v->def == nullptr)
@@ -163,14 +328,14 @@ class IRGraph {
                     auto *P = dynamic_cast<const PhiInst *>(I);
                     if (!P)
                         return false;
-                    for (auto &in : P->incomings()) {
-                        auto *pred = in.first;
+                    for (size_t i = 0; i < P->numIncomings(); ++i) {
+                        auto *pred = P->incomingBlock(i);
                         if (!pred)
                             return false;
                         if (std::find(bb->predecessors.begin(), bb->predecessors.end(), pred) == bb->predecessors.end()) {
                             return false;
                         }
-                        auto *val = in.second;
+                        auto *val = P->incomingValue(i);
                         if (!val)
                             return false;
                         if (!val->is_arg && val->def == nullptr)
@@ -196,4 +361,34 @@ class IRGraph {
         return true;
     }
 };
-} 
\ No newline at end of file
+
+// Blocks entered with flags that a ja may still read: those that read
+// incoming flags, and cmp-free blocks that pass flags on to one of them.
+// The flags a block leaves with are live if any successor is in the set.
+// Linear in the size of the graph.
+inline BlockMap<bool> flagsLiveIn(const IRGraph &g) {
+    BlockMap<bool> live;
+    std::vector<const BasicBlock *> work;
+    for (const BasicBlock *b : g.getBlocks())
+        if (readsIncomingFlags(b)) {
+            live[b] = true;
+            work.push_back(b);
+        }
+    auto setsFlags = [](const BasicBlock *b) {
+        for (const Inst *I : b->insts)
+            if (I->opcode() == Opcode::CMP_U64)
+                return true;
+        return false;
+    };
+    while (!work.empty()) {
+        const BasicBlock *b = work.back();
+        work.pop_back();
+        for (const BasicBlock *p : b->predecessors)
+            if (!live.get(p) && !setsFlags(p)) {
+                live[p] = true;
+                work.push_back(p);
+            }
+    }
+    return live;
+}
+}
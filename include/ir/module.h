@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ir/ir_graph.h"
+
+namespace ir {
+
+// A set of functions, one IRGraph each, in creation order. Graphs share
+// no state (each owns its arena and numbering), so different functions can
+// be worked on from different threads.
+class Module {
+    std::vector<std::unique_ptr<IRGraph>> functions_;
+
+  public:
+    // A new function with the given signature; builders that create their
+    // own arguments may replace the arguments but keep the name.
+    IRGraph &createFunction(std::string name, std::vector<IRGraph::Arg> args = {}, std::string ret = "u64") {
+        functions_.push_back(std::make_unique<IRGraph>());
+        functions_.back()->setSignature(std::move(ret), std::move(name), std::move(args));
+        return *functions_.back();
+    }
+    size_t size() const {
+        return functions_.size();
+    }
+    // Null once the function's IR has been released.
+    IRGraph *function(size_t i) const {
+        return functions_[i].get();
+    }
+    // Frees the function's IR, keeping its slot (and every index) in place.
+    // Different slots may be released from different threads.
+    void releaseFunction(size_t i) {
+        functions_[i].reset();
+    }
+    // Linear search by name.
+    IRGraph *getFunction(std::string_view name) const {
+        for (auto &f : functions_)
+            if (f && f->name() == name)
+                return f.get();
+        return nullptr;
+    }
+    size_t numInsts() const {
+        size_t n = 0;
+        for (auto &f : functions_)
+            if (f)
+                n += f->numInsts();
+        return n;
+    }
+
+    // Functions separated by blank lines; parseModuleText
+    // (ir/text_parser.h) reads it back.
+    void print(TextWriter &w) const {
+        bool first = true;
+        for (auto &f : functions_) {
+            if (!f)
+                continue;
+            if (!first)
+                w.endLine();
+            first = false;
+            f->print(w);
+        }
+    }
+    std::string toString() const {
+        TextWriter w;
+        print(w);
+        return w.take();
+    }
+};
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace ir {
+class BasicBlock;
+struct SSAValue;
+
+// One operand slot of an instruction: an SSA input, an immediate or a block
+// target. Slots are stored inline in the instruction and read in place.
+struct Operand {
+    enum class Kind : uint8_t {
+        Value,
+        Imm,
+        Block
+    };
+
+    Kind kind;
+    union {
+        SSAValue *val;
+        uint64_t imm_;
+        BasicBlock *bb;
+    };
+
+    static Operand ofValue(SSAValue *v) {
+        Operand o;
+        o.kind = Kind::Value;
+        o.val = v;
+        return o;
+    }
+    static Operand ofImm(uint64_t i) {
+        Operand o;
+        o.kind = Kind::Imm;
+        o.imm_ = i;
+        return o;
+    }
+    static Operand ofBlock(BasicBlock *b) {
+        Operand o;
+        o.kind = Kind::Block;
+        o.bb = b;
+        return o;
+    }
+
+    bool isValue() const {
+        return kind == Kind::Value;
+    }
+    bool isImm() const {
+        return kind == Kind::Imm;
+    }
+    bool isBlock() const {
+        return kind == Kind::Block;
+    }
+    SSAValue *value() const {
+        return isValue() ? val : nullptr;
+    }
+    uint64_t imm() const {
+        return isImm() ? imm_ : 0;
+    }
+    BasicBlock *block() const {
+        return isBlock() ? bb : nullptr;
+    }
+
+    bool operator==(const Operand &o) const {
+        if (kind != o.kind)
+            return false;
+        switch (kind) {
+        case Kind::Value:
+            return val == o.val;
+        case Kind::Imm:
+            return imm_ == o.imm_;
+        default:
+            return bb == o.bb;
+        }
+    }
+    bool operator!=(const Operand &o) const {
+        return !(*this == o);
+    }
+    size_t hash() const {
+        uint64_t x;
+        switch (kind) {
+        case Kind::Value:
+            x = reinterpret_cast<uintptr_t>(val);
+            break;
+        case Kind::Imm:
+            x = imm_;
+            break;
+        default:
+            x = reinterpret_cast<uintptr_t>(bb);
+            break;
+        }
+        x ^= static_cast<uint64_t>(kind) << 62; // splitmix64 finalizer below
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return static_cast<size_t>(x ^ (x >> 31));
+    }
+};
+
+class OperandSpan {
+    const Operand *begin_;
+    const Operand *end_;
+
+  public:
+    OperandSpan(const Operand *b = nullptr, size_t n = 0) : begin_(b), end_(b + n) {
+    }
+    const Operand *begin() const {
+        return begin_;
+    }
+    const Operand *end() const {
+        return end_;
+    }
+    size_t size() const {
+        return static_cast<size_t>(end_ - begin_);
+    }
+    bool empty() const {
+        return begin_ == end_;
+    }
+    const Operand &operator[](size_t i) const {
+        return begin_[i];
+    }
+};
+}
@@ -0,0 +1,193 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ir/id_map.h"
+#include "ir/ir_graph.h"
+
+namespace ir {
+
+// On-the-fly SSA construction (Braun et al., "Simple and Efficient
+// Construction of Static Single Assignment Form"). A front end declares
+// mutable variables, records writes per block and asks for reads; the
+// builder answers each read with the reaching SSAValue, creating PHI_U64s
+// only where a read meets several definitions. No dominator tree is needed.
+//
+// A block must be sealed once all of its predecessors are known. Reads in
+// unsealed blocks create placeholder phis that are completed on sealing.
+// Trivial phis are removed as soon as they are complete, so the result is
+// minimal for reducible CFGs and pruned, since phis are only made on reads.
+class SSABuilder {
+  public:
+    using Variable = uint32_t;
+
+  private:
+    IRGraph &g_;
+    std::vector<std::string> var_names_;
+    // Per variable, the value it holds at the end of each block so far.
+    std::vector<BlockMap<SSAValue *>> current_def_;
+    BlockMap<bool> sealed_;
+    // Phis whose operand list is not final yet must not be folded.
+    ValueMap<bool> pending_;
+    BlockMap<std::vector<std::pair<Variable, PhiInst *>>> incomplete_;
+    // Results of removed trivial phis forward to their replacement, so
+    // stale current_def_ entries resolve lazily.
+    ValueMap<SSAValue *> replaced_;
+    SSAValue *undef_ = nullptr;
+    size_t phis_created_ = 0;
+    size_t phis_removed_ = 0;
+
+    SSAValue *resolve(SSAValue *v) {
+        SSAValue *r = v;
+        while (r && replaced_.get(r))
+            r = replaced_.get(r);
+        while (v && v != r) { // path compression
+            SSAValue *next = replaced_.get(v);
+            replaced_[v] = r;
+            v = next;
+        }
+        return r;
+    }
+
+    // Value read for a variable that has no definition on some path. The
+    // IR has no undef, so it is materialized as a zero at the entry.
+    SSAValue *undef() {
+        if (!undef_) {
+            undef_ = g_.createValue();
+            g_.entry()->insertBefore(g_.entry()->firstNonPhi(), g_.createMovi(undef_, 0));
+        }
+        return undef_;
+    }
+
+    PhiInst *newPhi(BasicBlock *bb) {
+        auto *phi = g_.createPhi(g_.createValue(), {});
+        bb->insertBefore(bb->firstNonPhi(), phi);
+        pending_[phi->result()] = true;
+        ++phis_created_;
+        return phi;
+    }
+
+    SSAValue *readRecursive(Variable var, BasicBlock *bb) {
+        // Walk straight-line chains of sealed single-predecessor blocks
+        // iteratively; long generated functions would overflow otherwise.
+        std::vector<BasicBlock *> chain;
+        SSAValue *val = nullptr;
+        while (!val) {
+            if (!sealed_.get(bb)) {
+                auto *phi = newPhi(bb);
+                incomplete_[bb].emplace_back(var, phi);
+                val = phi->result();
+            } else if (bb->predecessors.empty()) {
+                val = undef();
+            } else if (bb->predecessors.size() == 1 && chain.size() <= g_.numBlocks()) {
+                chain.push_back(bb);
+                bb = bb->predecessors.front();
+                if (auto *def = resolve(current_def_[var].get(bb)))
+                    val = def;
+                continue;
+            } else if (bb->predecessors.size() == 1) {
+                val = undef(); // unreachable cycle of single-pred blocks
+            } else {
+                // Record the phi first to break cycles through loops.
+                auto *phi = newPhi(bb);
+                current_def_[var][bb] = phi->result();
+                val = addPhiOperands(var, phi);
+            }
+            current_def_[var][bb] = val;
+        }
+        for (auto *c : chain)
+            current_def_[var][c] = val;
+        return val;
+    }
+
+    SSAValue *addPhiOperands(Variable var, PhiInst *phi) {
+        BasicBlock *bb = phi->parent();
+        for (auto *pred : bb->predecessors)
+            phi->addIncoming(pred, readVariable(var, pred));
+        pending_[phi->result()] = false;
+        return tryRemoveTrivialPhi(phi);
+    }
+
+    SSAValue *tryRemoveTrivialPhi(PhiInst *phi) {
+        SSAValue *res = phi->result();
+        if (replaced_.get(res) || pending_.get(res))
+            return resolve(res);
+        SSAValue *same = nullptr;
+        for (size_t i = 0; i < phi->numIncomings(); ++i) {
+            SSAValue *op = phi->incomingValue(i);
+            if (op == same || op == res)
+                continue;
+            if (same)
+                return res; // merges at least two values
+            same = op;
+        }
+        if (!same)
+            same = undef();
+
+        std::vector<PhiInst *> phiUsers;
+        for (auto *U : res->users)
+            if (U != phi && U->opcode() == Opcode::PHI_U64)
+                phiUsers.push_back(static_cast<PhiInst *>(U));
+        phi->eraseFromParent();
+        res->replaceAllUsesWith(same);
+        replaced_[res] = same;
+        ++phis_removed_;
+
+        for (auto *U : phiUsers)
+            tryRemoveTrivialPhi(U);
+        return resolve(same);
+    }
+
+  public:
+    explicit SSABuilder(IRGraph &g) : g_(g) {
+    }
+
+    Variable declareVariable(std::string name = "") {
+        var_names_.push_back(std::move(name));
+        current_def_.emplace_back();
+        return static_cast<Variable>(var_names_.size() - 1);
+    }
+    const std::string &variableName(Variable var) const {
+        return var_names_[var];
+    }
+    size_t numVariables() const {
+        return var_names_.size();
+    }
+
+    void writeVariable(Variable var, BasicBlock *bb, SSAValue *val) {
+        current_def_[var][bb] = val;
+    }
+
+    SSAValue *readVariable(Variable var, BasicBlock *bb) {
+        if (auto *def = resolve(current_def_[var].get(bb)))
+            return def;
+        return readRecursive(var, bb);
+    }
+
+    // Declares that every predecessor of bb has been added.
+    void sealBlock(BasicBlock *bb) {
+        if (sealed_.get(bb))
+            return;
+        auto pending = std::move(incomplete_[bb]);
+        incomplete_[bb].clear();
+        sealed_[bb] = true;
+        for (auto &[var, phi] : pending)
+            addPhiOperands(var, phi);
+    }
+    void sealAll() {
+        for (auto *bb : g_.getBlocks())
+            sealBlock(bb);
+    }
+    bool isSealed(const BasicBlock *bb) const {
+        return sealed_.get(bb);
+    }
+
+    size_t numPhisCreated() const {
+        return phis_created_;
+    }
+    size_t numPhisRemoved() const {
+        return phis_removed_;
+    }
+};
+}
@@ -0,0 +1,393 @@
+#pragma once
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "ir/ir_graph.h"
+#include "ir/module.h"
+
+namespace ir {
+
+// Parses the text IRGraph::print writes: the signature line, then label
+// lines (with an optional "; succs:" list) each followed by indented
+// instructions. One pass over the text builds blocks, values and
+// instructions. Names are looked up as views into the text, and bb<N> and
+// v<N> through vectors indexed by N, so nothing is copied but the labels
+// and names the graph keeps. Forward references to blocks and values are
+// resolved when they are defined. Successors come from the "; succs:"
+// list or else impliedSuccessors.
+//
+// A block printed as bb<N> comes back unlabeled with id N, and a value
+// printed as v<N> gets id N where possible, so ids survive a round trip;
+// other names become labels and debug names.
+class TextParser {
+    struct BlockInfo {
+        bool defined = false;
+        bool explicitSuccs = false;
+        std::string_view name;
+        size_t line = 0; // first reference
+        std::vector<BasicBlock *> succs;
+    };
+    enum : uint8_t { kFree, kNumbered, kNamed };
+
+    IRGraph &g_;
+    const char *p_, *end_;
+    size_t line_ = 1;
+
+    std::unordered_map<std::string_view, BasicBlock *> blockByName_;
+    std::vector<BasicBlock *> byNumber_; // bb<N> by N
+    std::vector<BlockInfo> blockInfo_;   // by block id
+    std::vector<BasicBlock *> layout_;
+    std::unordered_map<std::string_view, SSAValue *> named_;
+    std::vector<SSAValue *> values_; // by value id
+    std::vector<uint8_t> valueKind_;
+    bool argShadowsNumbered_ = false;
+    std::vector<std::pair<BasicBlock *, SSAValue *>> incomings_;
+
+    [[noreturn]] void fail(const std::string &what) const {
+        throw std::runtime_error("IR text:" + std::to_string(line_) + ": " + what);
+    }
+
+    void skipSpaces() {
+        while (p_ != end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\r'))
+            ++p_;
+    }
+    bool atEol() {
+        skipSpaces();
+        return p_ == end_ || *p_ == '\n';
+    }
+    bool consume(char c) {
+        skipSpaces();
+        if (p_ == end_ || *p_ != c)
+            return false;
+        ++p_;
+        return true;
+    }
+    void expect(char c) {
+        if (!consume(c))
+            fail(std::string("expected '") + c + "'");
+    }
+    static bool isNameChar(char c) {
+        switch (c) {
+        case ' ': case '\t': case '\r': case '\n': case ',': case ':': case '=': case ';': case '(': case ')':
+            return false;
+        default:
+            return true;
+        }
+    }
+    std::string_view name() {
+        skipSpaces();
+        const char *start = p_;
+        while (p_ != end_ && isNameChar(*p_))
+            ++p_;
+        if (p_ == start)
+            fail("expected a name");
+        return std::string_view(start, p_ - start);
+    }
+    uint64_t number() {
+        skipSpaces();
+        const char *start = p_;
+        uint64_t n = 0;
+        for (; p_ != end_ && *p_ >= '0' && *p_ <= '9'; ++p_) {
+            uint64_t d = *p_ - '0';
+            if (n > (UINT64_MAX - d) / 10)
+                fail("immediate out of range");
+            n = n * 10 + d;
+        }
+        if (p_ == start)
+            fail("expected an immediate");
+        return n;
+    }
+    void endLine() {
+        if (!atEol())
+            fail("unexpected '" + std::string(1, *p_) + "'");
+        if (p_ != end_)
+            ++p_;
+        ++line_;
+    }
+
+    BasicBlock *createBlock(std::string_view s, bool numbered) {
+        blockInfo_.emplace_back();
+        blockInfo_.back().name = s;
+        blockInfo_.back().line = line_;
+        return g_.createBlock(numbered ? std::string() : std::string(s));
+    }
+    BasicBlock *block(std::string_view s) {
+        // bb<N>, as bbName prints an unlabeled block, skips the hash.
+        uint64_t n;
+        if (numberedName(s, "bb", n) && n < byNumber_.size() + static_cast<size_t>(end_ - p_)) {
+            if (n >= byNumber_.size())
+                byNumber_.resize(n + 1);
+            if (!byNumber_[n])
+                byNumber_[n] = createBlock(s, true);
+            return byNumber_[n];
+        }
+        auto [it, inserted] = blockByName_.try_emplace(s, nullptr);
+        if (inserted)
+            it->second = createBlock(s, false);
+        return it->second;
+    }
+    BasicBlock *block() {
+        return block(name());
+    }
+
+    SSAValue *createValue(std::string_view dbg, uint8_t kind) {
+        SSAValue *v = g_.createValue(std::string(dbg));
+        values_.push_back(v);
+        valueKind_.push_back(kind);
+        return v;
+    }
+    // prefix<N> without leading zeros, as fmtVal prints an unnamed value
+    // (v<N>) and bbName an unlabeled block (bb<N>).
+    static bool numberedName(std::string_view s, std::string_view prefix, uint64_t &n) {
+        if (s.size() <= prefix.size() || s.size() > prefix.size() + 10 || s.substr(0, prefix.size()) != prefix)
+            return false;
+        s.remove_prefix(prefix.size());
+        if (s[0] == '0' && s.size() > 1)
+            return false;
+        n = 0;
+        for (char c : s) {
+            if (c < '0' || c > '9')
+                return false;
+            n = n * 10 + (c - '0');
+        }
+        return true;
+    }
+    SSAValue *value(std::string_view s) {
+        if (argShadowsNumbered_)
+            if (auto it = named_.find(s); it != named_.end())
+                return it->second;
+        uint64_t id;
+        // Ids far beyond anything the text could number are kept as names.
+        if (numberedName(s, "v", id) && id < values_.size() + static_cast<size_t>(end_ - p_) + 1) {
+            while (values_.size() <= id)
+                createValue("", kFree);
+            if (valueKind_[id] == kFree)
+                valueKind_[id] = kNumbered;
+            if (valueKind_[id] == kNumbered)
+                return values_[id];
+        }
+        auto [it, inserted] = named_.try_emplace(s, nullptr);
+        if (inserted)
+            it->second = createValue(s, kNamed);
+        return it->second;
+    }
+    SSAValue *value() {
+        return value(name());
+    }
+    SSAValue *result() {
+        std::string_view s = name();
+        SSAValue *v = value(s);
+        if (v->def || v->is_arg)
+            fail("redefinition of " + std::string(s));
+        return v;
+    }
+
+    void parseSignature() {
+        std::string ret(name()), fname(name());
+        std::vector<IRGraph::Arg> args;
+        expect('(');
+        if (!consume(')')) {
+            do {
+                std::string type(name());
+                args.push_back({type, std::string(name())});
+            } while (consume(','));
+            expect(')');
+        }
+        expect(':');
+        endLine();
+        g_.setSignature(std::move(ret), std::move(fname), args);
+        for (auto &a : args) {
+            // Keyed by the value's own copy of the name.
+            SSAValue *v = g_.createArg(a.type, a.name);
+            if (!named_.emplace(v->dbg_name, v).second)
+                fail("duplicate argument " + a.name);
+            uint64_t id;
+            argShadowsNumbered_ |= numberedName(v->dbg_name, "v", id);
+            values_.push_back(v);
+            valueKind_.push_back(kNamed);
+        }
+    }
+
+    void parseLabel(std::string_view label) {
+        BasicBlock *bb = block(label);
+        BlockInfo &info = blockInfo_[bb->id];
+        if (info.defined)
+            fail("duplicate label " + std::string(label));
+        info.defined = true;
+        layout_.push_back(bb);
+        expect(':');
+        if (consume(';')) {
+            if (name() != "succs")
+                fail("expected 'succs'");
+            expect(':');
+            info.explicitSuccs = true;
+            if (!atEol()) {
+                do {
+                    BasicBlock *s = block(); // may grow blockInfo_
+                    blockInfo_[bb->id].succs.push_back(s);
+                } while (consume(','));
+            }
+        }
+        endLine();
+    }
+
+    Inst *parseInst() {
+        std::string_view op = name();
+        if (op == "movi.u64") {
+            SSAValue *r = result();
+            expect(',');
+            return g_.createMovi(r, number());
+        }
+        if (op == "u32tou64") {
+            SSAValue *r = result();
+            expect(',');
+            return g_.createCast(r, value());
+        }
+        if (op == "cmp.u64") {
+            SSAValue *l = value();
+            expect(',');
+            return g_.createCmp(l, value());
+        }
+        if (op == "ja")
+            return g_.createJa(block());
+        if (op == "mul.u64") {
+            SSAValue *r = result();
+            expect(',');
+            SSAValue *l = value();
+            expect(',');
+            return g_.createMul(r, l, value());
+        }
+        if (op == "addi.u64") {
+            SSAValue *r = result();
+            expect(',');
+            SSAValue *s = value();
+            expect(',');
+            return g_.createAddi(r, s, number());
+        }
+        if (op == "jmp")
+            return g_.createJmp(block());
+        if (op == "ret.u64")
+            return g_.createRet(value());
+        if (op == "phi.u64") {
+            SSAValue *r = result();
+            expect('=');
+            incomings_.clear();
+            if (!atEol()) {
+                do {
+                    BasicBlock *b = block();
+                    expect(':');
+                    incomings_.emplace_back(b, value());
+                } while (consume(','));
+            }
+            return g_.createPhi(r, incomings_);
+        }
+        fail("unknown instruction " + std::string(op));
+    }
+
+    void finish() {
+        for (BasicBlock *bb : g_.getBlocks())
+            if (!blockInfo_[bb->id].defined) {
+                line_ = blockInfo_[bb->id].line;
+                fail("undefined label " + std::string(blockInfo_[bb->id].name));
+            }
+        for (SSAValue *v : values_)
+            if (!v->def && !v->is_arg && !v->users.empty())
+                throw std::runtime_error("IR text: undefined value " + fmtVal(v));
+        g_.setLayout(layout_);
+        for (size_t i = 0; i < layout_.size(); ++i) {
+            BasicBlock *bb = layout_[i];
+            const BlockInfo &info = blockInfo_[bb->id];
+            auto succs = info.explicitSuccs
+                             ? info.succs
+                             : impliedSuccessors(bb, i + 1 < layout_.size() ? layout_[i + 1] : nullptr);
+            for (auto *s : succs)
+                bb->addSuccessor(s);
+        }
+
+        // bb<N> gets id N back; labeled blocks take the ids left over.
+        std::vector<bool> claimed(byNumber_.size());
+        for (size_t n = 0; n < byNumber_.size(); ++n)
+            claimed[n] = byNumber_[n] != nullptr;
+        uint32_t next = 0;
+        for (BasicBlock *bb : layout_) {
+            if (!bb->label.empty()) {
+                while (next < claimed.size() && claimed[next])
+                    ++next;
+                g_.setBlockId(bb, next++);
+            }
+        }
+        for (size_t n = 0; n < byNumber_.size(); ++n)
+            if (byNumber_[n])
+                g_.setBlockId(byNumber_[n], static_cast<uint32_t>(n));
+    }
+
+  public:
+    // firstLine numbers the text's first line in error messages.
+    TextParser(std::string_view text, IRGraph &g, size_t firstLine = 1)
+        : g_(g), p_(text.data()), end_(text.data() + text.size()), line_(firstLine) {
+    }
+
+    void run() {
+        if (g_.numBlocks() != 0 || g_.numValues() != 0)
+            throw std::runtime_error("IR text: graph must be empty");
+        while (p_ != end_ && atEol())
+            endLine();
+        if (p_ == end_)
+            fail("missing signature");
+        parseSignature();
+        BasicBlock *cur = nullptr;
+        while (p_ != end_) {
+            bool indented = *p_ == ' ' || *p_ == '\t';
+            if (atEol()) {
+                endLine();
+            } else if (!indented) {
+                std::string_view label = name();
+                parseLabel(label);
+                cur = layout_.back();
+            } else {
+                if (!cur)
+                    fail("instruction before the first label");
+                cur->addInst(parseInst());
+                endLine();
+            }
+        }
+        if (layout_.empty())
+            fail("function has no blocks");
+        finish();
+    }
+};
+
+// Parses text in IRGraph::print's format into g, which must be empty.
+// Throws std::runtime_error naming the line on malformed input.
+inline void parseText(std::string_view text, IRGraph &g) {
+    TextParser(text, g).run();
+}
+
+// Parses the functions of Module::print's output into M, one per
+// signature line (the only unindented lines with a '(').
+inline void parseModuleText(std::string_view text, Module &M) {
+    size_t start = 0, startLine = 1, line = 1;
+    auto flush = [&](size_t end) {
+        std::string_view part = text.substr(start, end - start);
+        if (part.find_first_not_of(" \t\r\n") != std::string_view::npos)
+            TextParser(part, M.createFunction(""), startLine).run(); // sets the signature
+    };
+    for (size_t pos = 0; pos < text.size(); ++line) {
+        size_t eol = text.find('\n', pos);
+        if (eol == std::string_view::npos)
+            eol = text.size();
+        std::string_view l = text.substr(pos, eol - pos);
+        if (pos > start && !l.empty() && l[0] != ' ' && l[0] != '\t' && l.find('(') != std::string_view::npos) {
+            flush(pos);
+            start = pos;
+            startLine = line;
+        }
+        pos = eol + 1;
+    }
+    flush(text.size());
+}
+}
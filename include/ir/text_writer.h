@@ -0,0 +1,89 @@
+#pragma once
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include "ir/value.h"
+
+namespace ir {
+
+class BasicBlock;
+
+// Appends IR text to one growing buffer, without a temporary string per
+// instruction or operand. Writing to an ostream flushes the buffer in
+// large chunks; otherwise take() returns what was written.
+class TextWriter {
+    std::ostream *os_ = nullptr;
+    std::string buf_;
+    static constexpr size_t kFlushSize = 1 << 16;
+
+    void maybeFlush() {
+        if (os_ && buf_.size() >= kFlushSize)
+            flush();
+    }
+
+  public:
+    TextWriter() = default;
+    explicit TextWriter(std::ostream &os) : os_(&os) {
+        buf_.reserve(kFlushSize + 256);
+    }
+    TextWriter(const TextWriter &) = delete;
+    TextWriter &operator=(const TextWriter &) = delete;
+    ~TextWriter() {
+        flush();
+    }
+
+    void flush() {
+        if (os_ && !buf_.empty()) {
+            os_->write(buf_.data(), static_cast<std::streamsize>(buf_.size()));
+            buf_.clear();
+        }
+    }
+    std::string take() {
+        return std::move(buf_);
+    }
+
+    TextWriter &operator<<(std::string_view s) {
+        buf_.append(s.data(), s.size());
+        return *this;
+    }
+    TextWriter &operator<<(char c) {
+        buf_.push_back(c);
+        return *this;
+    }
+    TextWriter &operator<<(uint64_t n) {
+        char tmp[20];
+        auto end = std::to_chars(tmp, tmp + sizeof(tmp), n).ptr;
+        buf_.append(tmp, end - tmp);
+        return *this;
+    }
+
+    // The mnemonic padded to the operand column.
+    void mnemonic(std::string_view m) {
+        buf_.append(m.data(), m.size());
+        buf_.append(m.size() < 12 ? 12 - m.size() : 1, ' ');
+    }
+    // Ends a line; the buffer is flushed only between lines.
+    void endLine() {
+        buf_.push_back('\n');
+        maybeFlush();
+    }
+
+    // The value's name, or v<id> for an unnamed value; fmtVal returns
+    // the same as a string.
+    void value(const SSAValue *v) {
+        if (!v)
+            *this << "<null>";
+        else if (!v->dbg_name.empty())
+            *this << v->dbg_name;
+        else
+            *this << 'v' << static_cast<uint64_t>(v->id);
+    }
+    // The block's label, or bb<id> for an unlabeled block; bbName
+    // returns the same as a string. Defined in basic_block.h.
+    inline void block(const BasicBlock *b);
+};
+}
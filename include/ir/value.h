@@ -1,7 +1,6 @@
 #pragma once
 #include <cstdint>
 #include <string>
-#include <variant>
 #include <vector>
 
 namespace ir {
@@ -16,8 +15,16 @@ struct SSAValue {
     void addUser(Inst *I) {
         users.push_back(I);
     }
+    // Drops one occurrence; an inst using a value twice is listed twice.
+    void removeUser(Inst *I) {
+        for (size_t i = 0; i < users.size(); ++i) {
+            if (users[i] == I) {
+                users[i] = users.back();
+                users.pop_back();
+                return;
+            }
+        }
+    }
+    void replaceAllUsesWith(SSAValue *to);
 };
-
-
-using Value = std::variant<SSAValue *, std::string, uint64_t>;
 } 
\ No newline at end of file
@@ -0,0 +1,200 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+#include "ir/id_map.h"
+#include "ir/ir_graph.h"
+
+namespace opt {
+using ir::BasicBlock;
+using ir::BlockMap;
+using ir::Inst;
+using ir::SSAValue;
+
+// Dead code elimination plus CFG cleanup, repeated until nothing changes:
+//  - blocks unreachable from the entry are erased with their phi incomings;
+//  - a value is live if a ret, or the cmp a branch reads, depends on it
+//    through any chain of operands; everything else that produces a result
+//    is erased, including phi cycles that only feed each other, and so is
+//    every cmp whose flags are overwritten before any branch;
+//  - a block is merged into its only predecessor when that predecessor has
+//    no other successor;
+//  - a jmp to the next block in layout order is dropped (the block then
+//    falls through to its single successor).
+class DCE {
+  public:
+    size_t numInstsRemoved = 0;
+    size_t numBlocksRemoved = 0;
+    size_t numBlocksMerged = 0;
+    size_t numJumpsRemoved = 0;
+
+  private:
+    ir::IRGraph *g_ = nullptr;
+
+    bool removeUnreachable() {
+        ir::IRGraph &g = *g_;
+        BlockMap<bool> seen;
+        std::vector<BasicBlock *> stack{g.entry()};
+        seen[g.entry()] = true;
+        while (!stack.empty()) {
+            BasicBlock *b = stack.back();
+            stack.pop_back();
+            for (auto *s : b->successors)
+                if (!seen[s]) {
+                    seen[s] = true;
+                    stack.push_back(s);
+                }
+        }
+        std::vector<BasicBlock *> dead;
+        for (auto *b : g.getBlocks())
+            if (!seen.get(b))
+                dead.push_back(b);
+        numBlocksRemoved += dead.size();
+        g.eraseBlocks(dead);
+        return !dead.empty();
+    }
+
+    // The last cmp of a block may set the flags its branch, or a successor
+    // without its own cmp, reads; unless the block returns, it is kept.
+    static Inst *flagsRoot(BasicBlock *b) {
+        Inst *T = b->insts.back();
+        if (T && T->opcode() == Opcode::RET_U64)
+            return nullptr;
+        for (Inst *I = T; I; I = I->prev())
+            if (I->opcode() == Opcode::CMP_U64)
+                return I;
+        return nullptr;
+    }
+
+    bool removeDeadInsts() {
+        ir::IRGraph &g = *g_;
+        ir::ValueMap<bool> live;
+        std::vector<SSAValue *> work;
+        auto markOperands = [&](const Inst *I) {
+            for (const auto &op : I->operands())
+                if (op.isValue() && op.value() && !live[op.value()]) {
+                    live[op.value()] = true;
+                    work.push_back(op.value());
+                }
+        };
+        BlockMap<Inst *> flags;
+        for (auto *b : g.getBlocks()) {
+            flags[b] = flagsRoot(b);
+            if (flags[b])
+                markOperands(flags[b]);
+            if (Inst *T = b->insts.back(); T && T->opcode() == Opcode::RET_U64)
+                markOperands(T);
+        }
+        while (!work.empty()) {
+            SSAValue *v = work.back();
+            work.pop_back();
+            if (v->def)
+                markOperands(v->def);
+        }
+
+        size_t before = numInstsRemoved;
+        for (auto *b : g.getBlocks())
+            for (Inst *I = b->insts.front(); I;) {
+                Inst *next = I->next();
+                SSAValue *r = I->result();
+                bool dead = r ? !live.get(r)
+                              : I->opcode() == Opcode::CMP_U64 && I != flags.get(b);
+                if (dead) {
+                    I->eraseFromParent();
+                    ++numInstsRemoved;
+                }
+                I = next;
+            }
+        return numInstsRemoved != before;
+    }
+
+    static bool endsInJumpOrFallthrough(const BasicBlock *b) {
+        const Inst *T = b->insts.back();
+        return !T || T->opcode() == Opcode::JMP ||
+               (T->opcode() != Opcode::JA_U64 && T->opcode() != Opcode::RET_U64);
+    }
+
+    static bool endsInJumpOrRet(const BasicBlock *b) {
+        const Inst *T = b->insts.back();
+        return T && (T->opcode() == Opcode::JMP || T->opcode() == Opcode::RET_U64);
+    }
+
+    bool mergeChains() {
+        ir::IRGraph &g = *g_;
+        std::vector<BasicBlock *> merged;
+        BlockMap<bool> gone;
+        std::vector<BasicBlock *> layout = g.getBlocks();
+        for (size_t i = 0; i < layout.size(); ++i) {
+            BasicBlock *b = layout[i];
+            size_t next = i + 1;
+            while (!gone.get(b) && b->successors.size() == 1 && endsInJumpOrFallthrough(b)) {
+                BasicBlock *s = b->successors.front();
+                if (s == b || s == g.entry() || s->predecessors.size() != 1)
+                    break;
+                // b takes over s's fall-through, which stays correct only if
+                // s comes right after b in layout.
+                while (next < layout.size() && gone.get(layout[next]))
+                    ++next;
+                if (!endsInJumpOrRet(s) && (next == layout.size() || layout[next] != s))
+                    break;
+                // A phi with one incoming is a copy.
+                while (Inst *I = s->insts.front()) {
+                    if (I->opcode() != Opcode::PHI_U64)
+                        break;
+                    auto *P = static_cast<ir::PhiInst *>(I);
+                    P->result()->replaceAllUsesWith(P->incomingValue(0));
+                    P->eraseFromParent();
+                }
+                if (Inst *T = b->insts.back(); T && T->opcode() == Opcode::JMP)
+                    T->eraseFromParent();
+                if (Inst *first = s->insts.front())
+                    b->splice(nullptr, s, first);
+                b->removeSuccessor(s);
+                while (!s->successors.empty()) {
+                    BasicBlock *t = s->successors.front();
+                    t->replacePhiIncomingBlock(s, b);
+                    s->removeSuccessor(t);
+                    b->addSuccessor(t);
+                }
+                gone[s] = true;
+                merged.push_back(s);
+            }
+        }
+        numBlocksMerged += merged.size();
+        g.eraseBlocks(merged);
+        return !merged.empty();
+    }
+
+    bool removeJumpsToNext() {
+        const auto &blocks = g_->getBlocks();
+        size_t before = numJumpsRemoved;
+        for (size_t i = 0; i + 1 < blocks.size(); ++i) {
+            Inst *T = blocks[i]->insts.back();
+            if (T && T->opcode() == Opcode::JMP &&
+                static_cast<ir::JmpInst *>(T)->target() == blocks[i + 1]) {
+                T->eraseFromParent();
+                ++numJumpsRemoved;
+            }
+        }
+        return numJumpsRemoved != before;
+    }
+
+  public:
+    // Returns true if the graph changed.
+    bool run(ir::IRGraph &g) {
+        g_ = &g;
+        numInstsRemoved = numBlocksRemoved = numBlocksMerged = numJumpsRemoved = 0;
+        if (!g.entry())
+            return false;
+        bool changed = false;
+        for (bool again = true; again;) {
+            again = removeUnreachable();
+            again |= removeDeadInsts();
+            again |= mergeChains();
+            changed |= again;
+        }
+        changed |= removeJumpsToNext();
+        return changed;
+    }
+};
+}
@@ -0,0 +1,169 @@
+#pragma once
+#include <cstddef>
+#include <unordered_set>
+#include <vector>
+
+#include "analysis/analysis_manager.h"
+#include "analysis/dominator_tree.h"
+#include "ir/ir_graph.h"
+
+namespace opt {
+using ir::BasicBlock;
+using ir::Inst;
+
+// Dominator-based global value numbering: a preorder walk of the dominator
+// tree with a hash table of the instructions available at each block,
+// scoped so that leaving a subtree forgets what it added. An instruction
+// structurally identical (Inst::isIdenticalTo) to one that dominates it is
+// redundant: its users are pointed at the dominating result and it is
+// erased. Phis are compared within their block instead, since a back-edge
+// operand may still be rewritten while the phi is in scope; a phi whose
+// incomings all carry one other value is replaced by that value.
+// Rewrites can expose more matches, so the walk repeats until none is found.
+class GVN {
+  public:
+    size_t numReplaced = 0;
+    size_t numPhisReplaced = 0;
+
+  private:
+    struct InstHash {
+        size_t operator()(const Inst *I) const {
+            return I->hash();
+        }
+    };
+    struct InstEqual {
+        bool operator()(const Inst *a, const Inst *b) const {
+            return a->isIdenticalTo(b);
+        }
+    };
+    std::unordered_set<Inst *, InstHash, InstEqual> available_;
+    std::unordered_set<Inst *, InstHash, InstEqual> phis_;
+    std::vector<Inst *> scopeLog_;
+
+    static bool isNumbered(const Inst *I) {
+        switch (I->opcode()) {
+        case Opcode::MOVI_U64:
+        case Opcode::U32TOU64:
+        case Opcode::MUL_U64:
+        case Opcode::ADDI_U64:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    static void replace(Inst *I, ir::SSAValue *by) {
+        I->result()->replaceAllUsesWith(by);
+        I->eraseFromParent();
+    }
+
+    // The single value a phi forwards, ignoring self-references.
+    static ir::SSAValue *uniqueIncoming(const ir::PhiInst *P) {
+        ir::SSAValue *same = nullptr;
+        for (size_t i = 0; i < P->numIncomings(); ++i) {
+            ir::SSAValue *v = P->incomingValue(i);
+            if (v == P->result() || v == same)
+                continue;
+            if (same)
+                return nullptr;
+            same = v;
+        }
+        return same;
+    }
+
+    // Phis are numbered in a table of their own, cleared per block. A
+    // replacement can rewrite the incomings of a phi already in the table;
+    // a match missed that way is found on the next walk.
+    bool visitPhis(BasicBlock *bb) {
+        bool changed = false;
+        phis_.clear();
+        for (Inst *I = bb->insts.front(); I && I->opcode() == Opcode::PHI_U64;) {
+            Inst *next = I->next();
+            auto *P = static_cast<ir::PhiInst *>(I);
+            ir::SSAValue *by = uniqueIncoming(P);
+            if (!by) {
+                auto [it, inserted] = phis_.insert(P);
+                if (!inserted)
+                    by = (*it)->result();
+            }
+            if (by) {
+                replace(P, by);
+                ++numPhisReplaced;
+                changed = true;
+            }
+            I = next;
+        }
+        return changed;
+    }
+
+    bool visitBlock(BasicBlock *bb) {
+        bool changed = visitPhis(bb);
+        for (Inst *I = bb->insts.front(); I;) {
+            Inst *next = I->next();
+            if (isNumbered(I)) {
+                auto [it, inserted] = available_.insert(I);
+                if (inserted) {
+                    scopeLog_.push_back(I);
+                } else {
+                    replace(I, (*it)->result());
+                    ++numReplaced;
+                    changed = true;
+                }
+            }
+            I = next;
+        }
+        return changed;
+    }
+
+    bool runOnce(ir::IRGraph &g, const analysis::DominatorTree &DT) {
+        available_.clear();
+        scopeLog_.clear();
+        bool changed = false;
+        struct Frame {
+            BasicBlock *bb;
+            size_t child;
+            size_t logMark;
+        };
+        std::vector<Frame> stack;
+        stack.push_back({g.entry(), 0, 0});
+        changed |= visitBlock(g.entry());
+        while (!stack.empty()) {
+            Frame &f = stack.back();
+            const auto &kids = DT.children(f.bb);
+            if (f.child < kids.size()) {
+                BasicBlock *c = kids[f.child++];
+                size_t mark = scopeLog_.size();
+                stack.push_back({c, 0, mark});
+                changed |= visitBlock(c);
+                continue;
+            }
+            while (scopeLog_.size() > f.logMark) {
+                available_.erase(scopeLog_.back());
+                scopeLog_.pop_back();
+            }
+            stack.pop_back();
+        }
+        return changed;
+    }
+
+  public:
+    // Returns true if the graph changed.
+    bool run(ir::IRGraph &g) {
+        analysis::AnalysisManager AM(g);
+        return run(AM);
+    }
+    // Takes the dominator tree from AM. GVN leaves the CFG alone, so the
+    // tree stays valid (and cached) across its walks.
+    bool run(analysis::AnalysisManager &AM) {
+        ir::IRGraph &g = AM.graph();
+        numReplaced = numPhisReplaced = 0;
+        if (!g.entry())
+            return false;
+        const analysis::DominatorTree &DT = AM.getDomTree();
+        bool changed = false;
+        while (runOnce(g, DT))
+            changed = true;
+        return changed;
+    }
+};
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+#include "opt/loop_utils.h"
+
+namespace opt {
+
+// Loop-invariant code motion. Loops are visited innermost first; each
+// reducible loop gets a preheader (inserted when missing) and every movi,
+// cast, mul or addi in it whose value operands are all defined outside the
+// loop is moved to the end of the preheader. Blocks are walked in dominance
+// order, so a chain of invariant insts moves in one pass, and what an inner
+// loop hoists lands in its preheader where the enclosing loop sees it next.
+// These ops cannot trap, so moving them off a conditional path is safe.
+// Irreducible loops, loops headed by the entry block and loops whose header
+// branches on flags set outside it are left alone.
+class LICM {
+  public:
+    size_t numHoisted = 0;
+    size_t numPreheadersInserted = 0;
+    size_t numLoopsSkipped = 0;
+
+  private:
+    static bool isHoistable(const Inst *I) {
+        switch (I->opcode()) {
+        case Opcode::MOVI_U64:
+        case Opcode::U32TOU64:
+        case Opcode::MUL_U64:
+        case Opcode::ADDI_U64:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    static bool isInvariant(const Inst *I, const BlockMap<bool> &in) {
+        for (const auto &op : I->operands())
+            if (op.isValue() && op.value() && op.value()->def &&
+                in.get(op.value()->def->parent()))
+                return false;
+        return true;
+    }
+
+    void hoist(BasicBlock *pre, LoopMembership &members) {
+        const BlockMap<bool> &in = members.get();
+        Inst *T = pre->insts.back();
+        Inst *pos = T && T->opcode() == Opcode::JMP ? T : nullptr;
+        for (auto *b : members.blocksInOrder())
+            for (Inst *I = b->insts.front(); I;) {
+                Inst *next = I->next();
+                if (isHoistable(I) && isInvariant(I, in)) {
+                    if (pos)
+                        I->moveBefore(pos);
+                    else
+                        I->moveToEnd(pre);
+                    ++numHoisted;
+                }
+                I = next;
+            }
+    }
+
+  public:
+    // Returns true if the graph changed.
+    bool run(ir::IRGraph &g) {
+        analysis::AnalysisManager AM(g);
+        return run(AM);
+    }
+    // Works on AM's loop nest, keeping it in step with the preheaders it
+    // inserts.
+    bool run(analysis::AnalysisManager &AM) {
+        ir::IRGraph &g = AM.graph();
+        numHoisted = numPreheadersInserted = numLoopsSkipped = 0;
+        if (!g.entry())
+            return false;
+        LoopAnalyzer &LA = AM.getLoopsForUpdate();
+        LoopMembership members;
+        for (Loop *L : loopsInnermostFirst(LA)) {
+            if (L->irreducible || L->header == g.entry() || readsIncomingFlags(L->header)) {
+                ++numLoopsSkipped;
+                continue;
+            }
+            const BlockMap<bool> &in = members.mark(*L);
+            BasicBlock *pre = loopPreheader(*L, in);
+            if (!pre) {
+                pre = insertPreheader(g, LA, *L, in);
+                ++numPreheadersInserted;
+            }
+            hoist(pre, members);
+        }
+        return numHoisted || numPreheadersInserted;
+    }
+};
+}
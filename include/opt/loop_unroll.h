@@ -0,0 +1,349 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "analysis/induction_vars.h"
+#include "opt/loop_utils.h"
+
+namespace opt {
+using analysis::InductionVars;
+using ir::SSAValue;
+
+// Unrolls innermost reducible loops that are tested at the top: the header
+// is the only block that leaves the loop, through a compare of an induction
+// variable against an invariant bound, and there is a single latch.
+//
+// An unrolled copy of the loop is put in front of the original, which is
+// kept as the remainder loop. Its header takes the original header's phis
+// and checks that `factor` more iterations will all pass the exit test;
+// then one iteration's worth of header code and body runs `factor` times
+// without any test in between. When the check fails, control moves to the
+// original loop through a new block, carrying the current phi values.
+// With a constant trip count the check is a single compare against a
+// precomputed limit; otherwise it compares iv + (factor - 1) * step with
+// the bound, after checking that the addition did not wrap.
+//
+// The factor is at most maxFactor, keeps factor * loop size within
+// sizeBudget instructions and, when the trip count is known, does not
+// exceed the number of times the body runs.
+class LoopUnroll {
+  public:
+    unsigned maxFactor = 4;
+    size_t sizeBudget = 64;
+    size_t numUnrolled = 0;
+    size_t numPreheadersInserted = 0;
+
+  private:
+    struct Shape {
+        BasicBlock *header, *latch, *bodyEntry;
+        const Inst *test, *branch;
+        analysis::LoopExitTest exit;
+        uint64_t step;
+        std::optional<uint64_t> tripCount;
+        uint64_t start; // test iv on the first iteration, with a trip count
+    };
+
+    // in holds L's blocks.
+    static std::optional<Shape> match(const Loop &L, const InductionVars &IV, const BlockMap<bool> &in) {
+        const analysis::LoopIVs *info = IV.loopInfo(&L);
+        if (L.irreducible || !L.children.empty() || L.latches.size() != 1 || !info ||
+            !info->exitTest || info->exitTest->exiting != L.header)
+            return std::nullopt;
+        Shape s;
+        s.header = L.header;
+        s.latch = L.latches[0];
+        s.exit = *info->exitTest;
+        for (auto *b : L.blocks)
+            if (readsIncomingFlags(b))
+                return std::nullopt;
+        s.bodyEntry = nullptr;
+        for (auto *succ : s.header->successors)
+            if (in.get(succ))
+                s.bodyEntry = succ;
+        if (!s.bodyEntry || s.bodyEntry == s.header)
+            return std::nullopt;
+        s.branch = s.header->insts.back();
+        s.test = s.branch->prev();
+        while (s.test->opcode() != Opcode::CMP_U64)
+            s.test = s.test->prev();
+        analysis::InductionVar form = IV.ivOf(s.exit.iv);
+        s.step = 0;
+        for (auto &b : info->basics)
+            if (b.phi->result() == form.base) {
+                s.step = b.step;
+                s.tripCount = info->tripCount;
+                if (s.tripCount)
+                    s.start = static_cast<const ir::MoviInst *>(b.init->def)->imm() + form.offset;
+            }
+        // The guard assumes the iv counts up; a step that looks negative is
+        // a count-down loop, whose guard value could wrap past the bound.
+        if (s.step == 0 || s.step > std::numeric_limits<int64_t>::max())
+            return std::nullopt;
+        return s;
+    }
+
+    static size_t loopSize(const Loop &L) {
+        size_t n = 0;
+        for (auto *b : L.blocks)
+            for (const Inst *I : b->insts)
+                n += I->opcode() != Opcode::PHI_U64;
+        return n;
+    }
+
+    // Blocks outside the unrolled loop that are still inside the loops
+    // around it.
+    static void addToEnclosing(LoopAnalyzer &LA, Loop *outer, BasicBlock *b) {
+        LA.loopOfBlock[b] = outer;
+        for (Loop *A = outer; A && A != LA.rootLoop; A = A->parent)
+            A->blocks.push_back(b);
+    }
+
+    unsigned factorOf(const Loop &L, const Shape &s) const {
+        size_t size = std::max<size_t>(loopSize(L), 1);
+        size_t factor = std::min<size_t>(maxFactor, sizeBudget / size);
+        if (s.tripCount)
+            factor = std::min<size_t>(factor, *s.tripCount - 1);
+        return factor >= 2 ? static_cast<unsigned>(factor) : 0;
+    }
+
+    // Tables reused for every loop of a graph and every copy; only the
+    // entries a copy sets are reset, so they are sized once per function.
+    struct Scratch {
+        LoopMembership members;
+        ir::ValueMap<SSAValue *> vmap, prev;
+        BlockMap<BasicBlock *> bmap;
+    };
+
+  public:
+    // The factor run() would unroll L by, or 0 to leave it alone.
+    unsigned factorFor(const Loop &L, const InductionVars &IV) const {
+        LoopMembership members;
+        auto s = match(L, IV, members.mark(L));
+        return s ? factorOf(L, *s) : 0;
+    }
+
+    // Unrolls L by factor (see factorFor) and returns the unrolled loop,
+    // which is appended to LA.loops. LA's dominator tree and DFS data are
+    // left stale.
+    Loop *unroll(ir::IRGraph &g, LoopAnalyzer &LA, const InductionVars &IV, Loop &L, unsigned factor) {
+        Scratch t;
+        return unroll(g, LA, L, *match(L, IV, t.members.mark(L)), factor, t);
+    }
+
+  private:
+    // L must be the loop marked in t.members.
+    Loop *unroll(ir::IRGraph &g, LoopAnalyzer &LA, Loop &L, const Shape &s, unsigned factor, Scratch &t) {
+        assert(factor >= 2 && (!s.tripCount || factor < *s.tripCount));
+        BasicBlock *H = s.header;
+        const BlockMap<bool> &in = t.members.get();
+        BasicBlock *pre = loopPreheader(L, in);
+        if (!pre) {
+            pre = insertPreheader(g, LA, L, in);
+            ++numPreheadersInserted;
+        }
+        std::vector<ir::PhiInst *> phis;
+        std::vector<const Inst *> headerInsts;
+        for (Inst *I = H->insts.front(); I; I = I->next())
+            if (I->opcode() == Opcode::PHI_U64)
+                phis.push_back(static_cast<ir::PhiInst *>(I));
+            else if (I != s.test && I != s.branch)
+                headerInsts.push_back(I);
+        std::vector<BasicBlock *> body = t.members.blocksInOrder();
+        body.erase(body.begin());
+        std::vector<SSAValue *> keys;
+        for (auto *P : phis)
+            keys.push_back(P->result());
+        for (auto *b : body)
+            for (const Inst *I : b->insts)
+                if (SSAValue *r = I->result())
+                    keys.push_back(r);
+        for (const Inst *I : headerInsts)
+            if (SSAValue *r = I->result())
+                keys.push_back(r);
+
+        auto U = std::make_unique<Loop>();
+        BasicBlock *UH = g.createBlock();
+        BasicBlock *remPre = g.createBlock();
+        U->header = UH;
+        U->blocks.push_back(UH);
+        std::vector<SSAValue *> uhPhis;
+        for (auto *P : phis) {
+            uhPhis.push_back(g.createValue());
+            UH->addInst(g.createPhi(uhPhis.back(), {{pre, P->incomingFor(pre)}}));
+        }
+
+        ir::ValueMap<SSAValue *> &vmap = t.vmap, &prev = t.prev;
+        BlockMap<BasicBlock *> &bmap = t.bmap;
+        auto lookup = [](const ir::ValueMap<SSAValue *> &m, SSAValue *v) {
+            SSAValue *w = v ? m.get(v) : nullptr;
+            return w ? w : v;
+        };
+        BasicBlock *headerPart = UH, *lastLatch = nullptr;
+        for (unsigned k = 0; k < factor; ++k) {
+            for (auto *v : keys)
+                vmap[v] = nullptr;
+            for (size_t i = 0; i < phis.size(); ++i)
+                vmap[phis[i]->result()] =
+                    k == 0 ? uhPhis[i] : lookup(prev, phis[i]->incomingFor(s.latch));
+            for (auto *b : body) {
+                bmap[b] = g.createBlock();
+                U->blocks.push_back(bmap[b]);
+                for (const Inst *I : b->insts)
+                    if (SSAValue *r = I->result())
+                        vmap[r] = g.createValue();
+            }
+            for (const Inst *I : headerInsts)
+                if (SSAValue *r = I->result())
+                    vmap[r] = g.createValue();
+            auto value = [&](SSAValue *v) { return lookup(vmap, v); };
+            for (const Inst *I : headerInsts)
+                headerPart->addInst(cloneInst(g, I, value, [](BasicBlock *b) { return b; }));
+
+            // The block that branches into this copy of the body.
+            BasicBlock *entering = headerPart;
+            if (k == 0) {
+                entering = emitGuard(g, s, UH, bmap.get(s.bodyEntry), remPre, value(s.exit.iv), factor);
+                if (entering != UH)
+                    U->blocks.push_back(entering);
+            } else {
+                headerPart->addInst(g.createJmp(bmap.get(s.bodyEntry)));
+                headerPart->addSuccessor(bmap.get(s.bodyEntry));
+            }
+
+            BasicBlock *next = k + 1 < factor ? g.createBlock() : UH;
+            auto target = [&](BasicBlock *b) { return b == H ? next : bmap.get(b); };
+            for (auto *b : body) {
+                BasicBlock *c = bmap.get(b);
+                for (const Inst *I : b->insts) {
+                    bool phi = I->opcode() == Opcode::PHI_U64;
+                    c->addInst(cloneInst(g, I, value, [&](BasicBlock *t) {
+                        return phi && t == H ? entering : target(t);
+                    }));
+                }
+                for (auto *succ : b->successors)
+                    c->addSuccessor(target(succ));
+            }
+
+            lastLatch = bmap.get(s.latch);
+            if (next != UH)
+                U->blocks.push_back(next);
+            headerPart = next;
+            std::swap(prev, vmap);
+        }
+        for (size_t i = 0; i < phis.size(); ++i)
+            static_cast<ir::PhiInst *>(uhPhis[i]->def)
+                ->addIncoming(lastLatch, lookup(prev, phis[i]->incomingFor(s.latch)));
+        for (auto *v : keys)
+            vmap[v] = prev[v] = nullptr;
+        for (auto *b : body)
+            bmap[b] = nullptr;
+
+        // The original loop now starts from wherever the unrolled one stopped.
+        for (size_t i = 0; i < phis.size(); ++i) {
+            phis[i]->removeIncoming(pre);
+            phis[i]->addIncoming(remPre, uhPhis[i]);
+        }
+        remPre->addInst(g.createJmp(H));
+        remPre->addSuccessor(H);
+        pre->replaceSuccessor(H, UH);
+
+        U->latches.push_back(lastLatch);
+        Loop *outer = L.parent != LA.rootLoop ? L.parent : nullptr;
+        U->parent = L.parent;
+        L.parent->children.push_back(U.get());
+        for (auto *b : U->blocks)
+            addToEnclosing(LA, outer, b);
+        for (auto *b : U->blocks)
+            if (b != UH)
+                LA.loopOfBlock[b] = U.get();
+        addToEnclosing(LA, outer, remPre);
+        Loop *result = U.get();
+        LA.loops.push_back(std::move(U));
+        ++numUnrolled;
+        return result;
+    }
+
+    // Ends UH with the check that factor more iterations pass the exit
+    // test; returns the last block of the check.
+    static BasicBlock *emitGuard(ir::IRGraph &g, const Shape &s, BasicBlock *UH, BasicBlock *body,
+                                 BasicBlock *remPre, SSAValue *iv, unsigned factor) {
+        uint64_t span = (factor - 1) * s.step;
+        auto branchOut = [&](BasicBlock *from, BasicBlock *fallthrough) {
+            from->addInst(g.createJa(remPre));
+            from->addSuccessor(fallthrough);
+            from->addSuccessor(remPre);
+        };
+        if (s.tripCount) {
+            // The iv on the last iteration that runs the body, pulled back so
+            // factor iterations fit.
+            uint64_t passes = *s.tripCount - 1;
+            SSAValue *limit = g.createValue();
+            UH->addInst(g.createMovi(limit, s.start + (passes - factor) * s.step));
+            UH->addInst(g.createCmp(iv, limit));
+            branchOut(UH, body);
+            return UH;
+        }
+        BasicBlock *check = g.createBlock();
+        SSAValue *last = g.createValue();
+        UH->addInst(g.createAddi(last, iv, span));
+        UH->addInst(g.createCmp(iv, last));
+        branchOut(UH, check);
+        if (s.exit.inclusive) {
+            // Loops while iv <= bound.
+            check->addInst(g.createCmp(last, s.exit.bound));
+            branchOut(check, body);
+        } else {
+            // Loops while bound > iv.
+            check->addInst(g.createCmp(s.exit.bound, last));
+            check->addInst(g.createJa(body));
+            check->addSuccessor(remPre);
+            check->addSuccessor(body);
+        }
+        return check;
+    }
+
+  public:
+    // Returns true if the graph changed.
+    bool run(ir::IRGraph &g) {
+        analysis::AnalysisManager AM(g);
+        return run(AM);
+    }
+    // Works on AM's loop nest, keeping it in step with the preheaders and
+    // unrolled loops it adds.
+    bool run(analysis::AnalysisManager &AM) {
+        ir::IRGraph &g = AM.graph();
+        numUnrolled = numPreheadersInserted = 0;
+        if (!g.entry())
+            return false;
+        LoopAnalyzer &LA = AM.getLoopsForUpdate();
+        InductionVars IV;
+        IV.run(LA);
+        struct Job {
+            Loop *loop;
+            Shape shape;
+            unsigned factor;
+        };
+        // Unrolling a loop leaves the others' blocks alone, so their shapes
+        // stay valid.
+        std::vector<Job> todo;
+        Scratch t;
+        for (auto &L : LA.loops) {
+            if (L->header == g.entry() || !L->children.empty())
+                continue;
+            if (auto s = match(*L, IV, t.members.mark(*L)))
+                if (unsigned f = factorOf(*L, *s))
+                    todo.push_back({L.get(), *s, f});
+        }
+        for (auto &j : todo) {
+            t.members.mark(*j.loop);
+            unroll(g, LA, *j.loop, j.shape, j.factor, t);
+        }
+        return numUnrolled != 0 || numPreheadersInserted != 0;
+    }
+};
+}
@@ -0,0 +1,186 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+#include "analysis/analysis_manager.h"
+#include "analysis/loop_analyzer.h"
+#include "ir/id_map.h"
+#include "ir/ir_graph.h"
+
+namespace opt {
+using analysis::Loop;
+using analysis::LoopAnalyzer;
+using ir::BasicBlock;
+using ir::BlockMap;
+using ir::Inst;
+using ir::readsIncomingFlags;
+
+// Every loop of LA with inner loops before the loops enclosing them.
+inline std::vector<Loop *> loopsInnermostFirst(const LoopAnalyzer &LA) {
+    std::vector<Loop *> order;
+    if (!LA.rootLoop)
+        return order;
+    std::vector<std::pair<Loop *, size_t>> stack{{LA.rootLoop, 0}};
+    while (!stack.empty()) {
+        auto &[L, i] = stack.back();
+        if (i < L->children.size()) {
+            Loop *c = L->children[i++];
+            stack.emplace_back(c, 0);
+            continue;
+        }
+        if (L != LA.rootLoop)
+            order.push_back(L);
+        stack.pop_back();
+    }
+    return order;
+}
+
+// The blocks of one loop at a time. Marking a loop clears only the entries
+// the previous one set, so a pass visiting every loop pays for their sizes
+// rather than the function's for each.
+class LoopMembership {
+    BlockMap<bool> in_, seen_;
+    std::vector<BasicBlock *> marked_;
+    BasicBlock *header_ = nullptr;
+
+  public:
+    const BlockMap<bool> &mark(const Loop &L) {
+        for (auto *b : marked_)
+            in_[b] = false;
+        marked_ = L.blocks;
+        for (auto *b : marked_)
+            in_[b] = true;
+        header_ = L.header;
+        return in_;
+    }
+    const BlockMap<bool> &get() const {
+        return in_;
+    }
+
+    // The marked loop's blocks in DFS preorder from the header over edges
+    // that stay in the loop. In a reducible loop a block comes after all of
+    // its dominators.
+    std::vector<BasicBlock *> blocksInOrder() {
+        std::vector<BasicBlock *> order;
+        std::vector<BasicBlock *> stack{header_};
+        seen_[header_] = true;
+        while (!stack.empty()) {
+            BasicBlock *b = stack.back();
+            stack.pop_back();
+            order.push_back(b);
+            for (auto it = b->successors.rbegin(); it != b->successors.rend(); ++it)
+                if (in_.get(*it) && !seen_[*it]) {
+                    seen_[*it] = true;
+                    stack.push_back(*it);
+                }
+        }
+        for (auto *b : order)
+            seen_[b] = false;
+        return order;
+    }
+};
+
+// A copy of I with its result and value operands mapped through value()
+// and its block operands through block().
+template <typename ValueFn, typename BlockFn>
+inline Inst *cloneInst(ir::IRGraph &g, const Inst *I, ValueFn value, BlockFn block) {
+    switch (I->opcode()) {
+    case Opcode::MOVI_U64: {
+        auto *M = static_cast<const ir::MoviInst *>(I);
+        return g.createMovi(value(M->result()), M->imm());
+    }
+    case Opcode::U32TOU64: {
+        auto *C = static_cast<const ir::CastInst *>(I);
+        return g.createCast(value(C->result()), value(C->src()));
+    }
+    case Opcode::CMP_U64: {
+        auto *C = static_cast<const ir::CmpInst *>(I);
+        return g.createCmp(value(C->left()), value(C->right()));
+    }
+    case Opcode::JA_U64:
+        return g.createJa(block(static_cast<const ir::JaInst *>(I)->target()));
+    case Opcode::MUL_U64: {
+        auto *M = static_cast<const ir::MulInst *>(I);
+        return g.createMul(value(M->result()), value(M->left()), value(M->right()));
+    }
+    case Opcode::ADDI_U64: {
+        auto *A = static_cast<const ir::AddiInst *>(I);
+        return g.createAddi(value(A->result()), value(A->src()), A->imm());
+    }
+    case Opcode::JMP:
+        return g.createJmp(block(static_cast<const ir::JmpInst *>(I)->target()));
+    case Opcode::RET_U64:
+        return g.createRet(value(static_cast<const ir::RetInst *>(I)->src()));
+    case Opcode::PHI_U64: {
+        auto *P = static_cast<const ir::PhiInst *>(I);
+        std::vector<std::pair<BasicBlock *, ir::SSAValue *>> incomings;
+        for (size_t i = 0; i < P->numIncomings(); ++i)
+            incomings.emplace_back(block(P->incomingBlock(i)), value(P->incomingValue(i)));
+        return g.createPhi(value(P->result()), incomings);
+    }
+    }
+    return nullptr;
+}
+
+// The single block outside the loop that enters it, if that block's only
+// successor is the header; null otherwise.
+inline BasicBlock *loopPreheader(const Loop &L, const BlockMap<bool> &in) {
+    BasicBlock *pre = nullptr;
+    for (auto *p : L.header->predecessors) {
+        if (in.get(p))
+            continue;
+        if (pre && pre != p)
+            return nullptr;
+        pre = p;
+    }
+    if (!pre || pre->successors.size() != 1)
+        return nullptr;
+    return pre;
+}
+
+// Gives the loop a preheader: a new block that every edge entering the
+// header from outside now goes through, ending in a jmp to the header.
+// Header phis get one incoming from it; values arriving along several
+// outside edges are merged by a phi in the preheader first. The new block
+// is added to the enclosing loops in LA, whose dominator tree and DFS data
+// are then stale. The header must not be the entry block; in holds L's
+// blocks.
+inline BasicBlock *insertPreheader(ir::IRGraph &g, LoopAnalyzer &LA, Loop &L, const BlockMap<bool> &in) {
+    BasicBlock *H = L.header;
+    assert(H != g.entry() && "the entry block cannot get a preheader");
+    std::vector<BasicBlock *> outside;
+    for (auto *p : H->predecessors)
+        if (!in.get(p) && std::find(outside.begin(), outside.end(), p) == outside.end())
+            outside.push_back(p);
+
+    BasicBlock *P = g.createBlock();
+    for (Inst *I = H->insts.front(); I && I->opcode() == Opcode::PHI_U64; I = I->next()) {
+        auto *phi = static_cast<ir::PhiInst *>(I);
+        std::vector<std::pair<BasicBlock *, ir::SSAValue *>> incomings;
+        for (auto *o : outside)
+            incomings.emplace_back(o, phi->incomingFor(o));
+        ir::SSAValue *v = incomings.front().second;
+        bool same = std::all_of(incomings.begin(), incomings.end(),
+                                [&](const auto &e) { return e.second == v; });
+        if (!same) {
+            v = g.createValue();
+            P->addInst(g.createPhi(v, incomings));
+        }
+        for (auto *o : outside)
+            while (phi->removeIncoming(o)) {
+            }
+        phi->addIncoming(P, v);
+    }
+    for (auto *o : outside)
+        o->replaceSuccessor(H, P);
+    P->addInst(g.createJmp(H));
+    P->addSuccessor(H);
+
+    Loop *outer = L.parent != LA.rootLoop ? L.parent : nullptr;
+    LA.loopOfBlock[P] = outer;
+    for (Loop *A = outer; A && A != LA.rootLoop; A = A->parent)
+        A->blocks.push_back(P);
+    return P;
+}
+}
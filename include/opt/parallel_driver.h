@@ -0,0 +1,125 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ir/arena.h"
+#include "ir/module.h"
+#include "opt/pass_manager.h"
+#include "opt/thread_pool.h"
+
+namespace opt {
+
+// What the pipeline did to one function of a module.
+struct FunctionResult {
+    std::string name;
+    bool changed = false;
+    std::vector<PassRecord> records;
+    // Empty unless the pipeline (or emit) threw for this function.
+    std::string error;
+};
+
+// Runs a pass pipeline over every function of a module on a
+// WorkStealingPool. Functions share no IR state, so each task touches only
+// its own IRGraph; each worker has its own PassManager and ChunkCache, so
+// nothing on the hot path is shared between workers either. Results are
+// indexed by function and do not depend on the number of threads.
+class ParallelDriver {
+    std::string pipeline_;
+    WorkStealingPool pool_;
+    std::vector<std::unique_ptr<ir::ChunkCache>> caches_;
+
+  public:
+    using EmitFn = std::function<void(size_t, ir::IRGraph &)>;
+
+    bool verifyEach = false;
+    // Frees each function's IR on its worker once emitted, handing the
+    // arena's chunks to that worker's cache for the next function.
+    bool releaseIR = false;
+
+    // Throws std::runtime_error if the pipeline is invalid.
+    explicit ParallelDriver(std::string_view pipeline, unsigned numThreads = 0) : pool_(numThreads) {
+        PassManager check;
+        check.parsePipeline(pipeline);
+        pipeline_ = check.pipeline();
+        for (unsigned w = 0; w < pool_.numThreads(); ++w)
+            caches_.push_back(std::make_unique<ir::ChunkCache>());
+    }
+
+    unsigned numThreads() const {
+        return pool_.numThreads();
+    }
+    const ir::ChunkCache &cache(unsigned worker) const {
+        return *caches_[worker];
+    }
+
+    // Optimizes every function still in M, then calls emit (if given) on
+    // it from the same worker. Released functions are skipped.
+    std::vector<FunctionResult> run(ir::Module &M, const EmitFn &emit = nullptr) {
+        std::vector<FunctionResult> results(M.size());
+        std::vector<PassManager> managers(pool_.numThreads());
+        for (auto &PM : managers) {
+            PM.parsePipeline(pipeline_);
+            PM.verifyEach = verifyEach;
+        }
+        pool_.parallelFor(M.size(), [&](size_t i, unsigned w) {
+            ir::IRGraph *g = M.function(i);
+            if (!g)
+                return;
+            ir::ChunkCache::Scope scope(*caches_[w]);
+            FunctionResult &r = results[i];
+            r.name = g->name();
+            try {
+                r.changed = managers[w].run(*g);
+                r.records = managers[w].records();
+                if (emit)
+                    emit(i, *g);
+            } catch (const std::exception &e) {
+                r.records = managers[w].records();
+                r.error = e.what();
+            }
+            if (releaseIR)
+                M.releaseFunction(i);
+        });
+        return results;
+    }
+
+    // Per-pass totals over all functions, one row per pipeline position so
+    // a pass that runs twice gets two rows, then the functions that failed.
+    static void printReport(const std::vector<FunctionResult> &results, std::ostream &os) {
+        struct Total {
+            std::string name;
+            double ms = 0;
+            size_t instsBefore = 0, instsAfter = 0, changed = 0;
+        };
+        // A function that failed has records for a prefix of the pipeline.
+        std::vector<Total> totals;
+        for (auto &r : results)
+            for (size_t k = 0; k < r.records.size(); ++k) {
+                const PassRecord &p = r.records[k];
+                if (k == totals.size())
+                    totals.push_back({p.name});
+                Total &tot = totals[k];
+                tot.ms += p.ms;
+                tot.instsBefore += p.instsBefore;
+                tot.instsAfter += p.instsAfter;
+                tot.changed += p.changed;
+            }
+        ReportTable t({{18}, {10, true}, {24}});
+        t.row({"pass", "ms", "insts", "changed"});
+        for (auto &tot : totals) {
+            t.row({tot.name, ReportTable::ms(tot.ms),
+                   std::to_string(tot.instsBefore) + " -> " + std::to_string(tot.instsAfter),
+                   std::to_string(tot.changed) + "/" + std::to_string(results.size())});
+        }
+        for (auto &r : results)
+            if (!r.error.empty())
+                t.line("error in " + r.name + ": " + r.error);
+        t.print(os);
+    }
+};
+}
@@ -0,0 +1,303 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "analysis/analysis_manager.h"
+#include "opt/dce.h"
+#include "opt/gvn.h"
+#include "opt/licm.h"
+#include "opt/loop_unroll.h"
+#include "opt/sccp.h"
+#include "opt/strength_reduce.h"
+
+namespace opt {
+using analysis::AnalysisManager;
+
+// What one pass did on one run of the pipeline.
+struct PassRecord {
+    std::string name;
+    double ms = 0;
+    size_t instsBefore = 0, instsAfter = 0;
+    size_t blocksBefore = 0, blocksAfter = 0;
+    bool changed = false;
+    // Analyses the manager held before the pass and no longer holds after
+    // it: those a CFG edit made stale (see AnalysisManager).
+    std::vector<AnalysisManager::Kind> invalidated;
+    // The pass's own counters, e.g. {"insts removed", 12}.
+    std::vector<std::pair<std::string, size_t>> stats;
+};
+
+// A fixed-width text table for pass reports. Rows are formatted into a
+// buffer of its own, so printing leaves the destination stream's flags and
+// precision as they were.
+class ReportTable {
+  public:
+    struct Column {
+        int width;
+        // Right-aligned cells are followed by two spaces.
+        bool right = false;
+    };
+
+  private:
+    std::vector<Column> columns_;
+    std::ostringstream buf_;
+
+  public:
+    explicit ReportTable(std::vector<Column> columns) : columns_(std::move(columns)) {
+    }
+
+    // Cells beyond the columns, and the last cell of the row, are not padded.
+    void row(const std::vector<std::string> &cells) {
+        for (size_t i = 0; i < cells.size(); ++i) {
+            if (i + 1 == cells.size() || i >= columns_.size()) {
+                buf_ << cells[i];
+                continue;
+            }
+            const Column &c = columns_[i];
+            buf_ << (c.right ? std::right : std::left) << std::setw(c.width) << cells[i] << (c.right ? "  " : "");
+        }
+        buf_ << "\n";
+    }
+    void line(std::string_view text) {
+        buf_ << text << "\n";
+    }
+    void print(std::ostream &os) const {
+        os << buf_.str();
+    }
+
+    // A time in milliseconds with three decimals.
+    static std::string ms(double ms) {
+        std::ostringstream s;
+        s << std::fixed << std::setprecision(3) << ms;
+        return s.str();
+    }
+};
+
+// Runs a pipeline of function passes over an IRGraph and records, for each
+// pass, its wall time, instruction and block counts before and after, and
+// the analyses it invalidated. Passes share one AnalysisManager per run:
+// gvn takes its dominator tree from it and the loop passes work on its loop
+// nest, so an analysis computed by one (or by an analysis pass such as
+// "loops") stays cached for the next until the CFG changes.
+//
+// A pipeline is a comma-separated list of registered pass names, e.g.
+// "sccp,gvn,licm,strength-reduce,loop-unroll,dce".
+class PassManager {
+  public:
+    using Stats = std::vector<std::pair<std::string, size_t>>;
+    // Returns true if the graph changed.
+    using PassFn = std::function<bool(ir::IRGraph &, AnalysisManager &, Stats &)>;
+
+    // Checks def-use chains after every pass; a broken graph throws
+    // std::runtime_error naming the pass.
+    bool verifyEach = false;
+
+  private:
+    struct Pass {
+        std::string name;
+        PassFn fn;
+    };
+    std::vector<Pass> passes_;
+    std::vector<PassRecord> records_;
+
+  public:
+    // The passes a pipeline string can name.
+    static std::vector<std::string> registeredPasses() {
+        return {"sccp", "dce", "gvn", "licm", "strength-reduce", "loop-unroll", "rpo", "domtree", "loops"};
+    }
+
+    // Returns false if name is not a registered pass.
+    bool addPass(std::string_view name) {
+        PassFn fn;
+        if (name == "sccp") {
+            fn = [](ir::IRGraph &g, AnalysisManager &, Stats &s) {
+                SCCP p;
+                bool changed = p.run(g);
+                s = {{"constants folded", p.numConstantsFolded},
+                     {"branches folded", p.numBranchesFolded},
+                     {"blocks removed", p.numBlocksRemoved}};
+                return changed;
+            };
+        } else if (name == "dce") {
+            fn = [](ir::IRGraph &g, AnalysisManager &, Stats &s) {
+                DCE p;
+                bool changed = p.run(g);
+                s = {{"insts removed", p.numInstsRemoved},
+                     {"blocks removed", p.numBlocksRemoved},
+                     {"blocks merged", p.numBlocksMerged},
+                     {"jumps removed", p.numJumpsRemoved}};
+                return changed;
+            };
+        } else if (name == "gvn") {
+            fn = [](ir::IRGraph &, AnalysisManager &AM, Stats &s) {
+                GVN p;
+                bool changed = p.run(AM);
+                s = {{"replaced", p.numReplaced}, {"phis replaced", p.numPhisReplaced}};
+                return changed;
+            };
+        } else if (name == "licm") {
+            fn = [](ir::IRGraph &, AnalysisManager &AM, Stats &s) {
+                LICM p;
+                bool changed = p.run(AM);
+                s = {{"hoisted", p.numHoisted},
+                     {"preheaders inserted", p.numPreheadersInserted},
+                     {"loops skipped", p.numLoopsSkipped}};
+                return changed;
+            };
+        } else if (name == "strength-reduce") {
+            fn = [](ir::IRGraph &, AnalysisManager &AM, Stats &s) {
+                StrengthReduction p;
+                bool changed = p.run(AM);
+                s = {{"reduced", p.numReduced}, {"preheaders inserted", p.numPreheadersInserted}};
+                return changed;
+            };
+        } else if (name == "loop-unroll") {
+            fn = [](ir::IRGraph &, AnalysisManager &AM, Stats &s) {
+                LoopUnroll p;
+                bool changed = p.run(AM);
+                s = {{"unrolled", p.numUnrolled}, {"preheaders inserted", p.numPreheadersInserted}};
+                return changed;
+            };
+        } else if (name == "rpo") {
+            fn = [](ir::IRGraph &, AnalysisManager &AM, Stats &) {
+                AM.getRPO();
+                return false;
+            };
+        } else if (name == "domtree") {
+            fn = [](ir::IRGraph &, AnalysisManager &AM, Stats &) {
+                AM.getDomTree();
+                return false;
+            };
+        } else if (name == "loops") {
+            fn = [](ir::IRGraph &, AnalysisManager &AM, Stats &) {
+                AM.getLoops();
+                return false;
+            };
+        } else {
+            return false;
+        }
+        addPass(std::string(name), std::move(fn));
+        return true;
+    }
+    void addPass(std::string name, PassFn fn) {
+        passes_.push_back({std::move(name), std::move(fn)});
+    }
+
+    // Appends the passes of a pipeline string; names may be surrounded by
+    // spaces. Throws std::runtime_error on an unknown or empty name, leaving
+    // the pipeline as it was.
+    void parsePipeline(std::string_view text) {
+        std::vector<std::string> names;
+        size_t pos = 0;
+        while (pos <= text.size()) {
+            size_t comma = text.find(',', pos);
+            if (comma == std::string_view::npos)
+                comma = text.size();
+            std::string_view name = text.substr(pos, comma - pos);
+            while (!name.empty() && name.front() == ' ')
+                name.remove_prefix(1);
+            while (!name.empty() && name.back() == ' ')
+                name.remove_suffix(1);
+            if (name.empty() && !(names.empty() && comma == text.size()))
+                throw std::runtime_error("pipeline: empty pass name");
+            if (!name.empty())
+                names.emplace_back(name);
+            pos = comma + 1;
+        }
+        size_t before = passes_.size();
+        for (auto &n : names)
+            if (!addPass(n)) {
+                passes_.resize(before);
+                throw std::runtime_error("pipeline: unknown pass '" + n + "'");
+            }
+    }
+    // The pipeline as a string parsePipeline accepts.
+    std::string pipeline() const {
+        std::string s;
+        for (auto &p : passes_) {
+            if (!s.empty())
+                s += ',';
+            s += p.name;
+        }
+        return s;
+    }
+    size_t numPasses() const {
+        return passes_.size();
+    }
+
+    // Runs every pass in order; records replace those of the previous run.
+    // Returns true if any pass changed the graph.
+    bool run(ir::IRGraph &g) {
+        records_.clear();
+        AnalysisManager AM(g);
+        bool changed = false;
+        for (auto &p : passes_) {
+            PassRecord r;
+            r.name = p.name;
+            r.instsBefore = g.numInsts();
+            r.blocksBefore = g.numBlocks();
+            bool held[AnalysisManager::NUM_KINDS];
+            for (int k = 0; k < AnalysisManager::NUM_KINDS; ++k)
+                held[k] = AM.isCached(static_cast<AnalysisManager::Kind>(k));
+            auto start = std::chrono::steady_clock::now();
+            r.changed = p.fn(g, AM, r.stats);
+            r.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            r.instsAfter = g.numInsts();
+            r.blocksAfter = g.numBlocks();
+            for (int k = 0; k < AnalysisManager::NUM_KINDS; ++k) {
+                auto kind = static_cast<AnalysisManager::Kind>(k);
+                if (held[k] && !AM.isCached(kind))
+                    r.invalidated.push_back(kind);
+            }
+            changed |= r.changed;
+            records_.push_back(std::move(r));
+            if (verifyEach && !g.checkDataFlow())
+                throw std::runtime_error("pass '" + p.name + "' broke def-use chains");
+        }
+        return changed;
+    }
+
+    const std::vector<PassRecord> &records() const {
+        return records_;
+    }
+    double totalMs() const {
+        double ms = 0;
+        for (auto &r : records_)
+            ms += r.ms;
+        return ms;
+    }
+
+    // One line per pass of the last run, then the totals.
+    void printReport(std::ostream &os) const {
+        auto counts = [](size_t before, size_t after) {
+            return std::to_string(before) + " -> " + std::to_string(after);
+        };
+        ReportTable t({{18}, {10, true}, {16}, {16}, {9}});
+        t.row({"pass", "ms", "insts", "blocks", "changed", "invalidated"});
+        for (auto &r : records_) {
+            std::string inv;
+            for (auto k : r.invalidated)
+                inv += (inv.empty() ? "" : ",") + std::string(AnalysisManager::kindName(k));
+            t.row({r.name, ReportTable::ms(r.ms), counts(r.instsBefore, r.instsAfter),
+                   counts(r.blocksBefore, r.blocksAfter), r.changed ? "yes" : "no", inv.empty() ? "-" : inv});
+            for (auto &[what, n] : r.stats)
+                if (n)
+                    t.line("    " + what + ": " + std::to_string(n));
+        }
+        if (!records_.empty())
+            t.row({"total", ReportTable::ms(totalMs()),
+                   counts(records_.front().instsBefore, records_.back().instsAfter),
+                   counts(records_.front().blocksBefore, records_.back().blocksAfter)});
+        t.print(os);
+    }
+};
+}
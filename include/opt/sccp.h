@@ -0,0 +1,337 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "ir/id_map.h"
+#include "ir/ir_graph.h"
+
+namespace opt {
+using ir::BasicBlock;
+using ir::BlockMap;
+using ir::Inst;
+using ir::SSAValue;
+
+// Sparse conditional constant propagation (Wegman & Zadeck). Values start
+// optimistically undefined and only blocks reached over executable edges
+// are evaluated, so constants that flow around a loop or through a branch
+// that always goes one way are found. Afterwards every constant result is
+// rewritten to a movi in place, JA branches with a known condition become
+// jmps, and blocks that never became executable are erased; a phi left
+// with one incoming is replaced by that value.
+//
+// knownArgs[i], when set, is the value of the i-th function argument, for
+// specializing a call site whose arguments are constant.
+class SCCP {
+  public:
+    struct Lattice {
+        enum Kind : uint8_t {
+            Undef,
+            Const,
+            Over
+        };
+        Kind kind = Undef;
+        uint64_t value = 0;
+
+        bool isConst() const {
+            return kind == Const;
+        }
+        bool operator==(const Lattice &o) const {
+            return kind == o.kind && (kind != Const || value == o.value);
+        }
+        bool operator!=(const Lattice &o) const {
+            return !(*this == o);
+        }
+    };
+
+    size_t numConstantsFolded = 0;
+    size_t numBranchesFolded = 0;
+    size_t numBlocksRemoved = 0;
+
+  private:
+    ir::IRGraph *g_ = nullptr;
+    ir::ValueMap<Lattice> state_;
+    BlockMap<bool> executable_;
+    BlockMap<std::vector<BasicBlock *>> execPreds_; // sources of executable edges
+    std::vector<std::pair<BasicBlock *, BasicBlock *>> cfgWork_;
+    std::vector<SSAValue *> ssaWork_;
+
+    static Lattice constant(uint64_t c) {
+        return {Lattice::Const, c};
+    }
+    static Lattice overdefined() {
+        return {Lattice::Over, 0};
+    }
+    static Lattice meet(Lattice a, Lattice b) {
+        if (a.kind == Lattice::Undef)
+            return b;
+        if (b.kind == Lattice::Undef || a == b)
+            return a;
+        return overdefined();
+    }
+
+    Lattice get(const SSAValue *v) const {
+        return v ? state_.get(v) : overdefined();
+    }
+    void update(SSAValue *v, Lattice l) {
+        Lattice &cur = state_[v];
+        Lattice merged = meet(cur, l);
+        if (merged != cur) {
+            cur = merged;
+            ssaWork_.push_back(v);
+        }
+    }
+
+    bool isEdgeExecutable(const BasicBlock *from, BasicBlock *to) const {
+        for (auto *p : execPreds_.get(to))
+            if (p == from)
+                return true;
+        return false;
+    }
+    void markEdge(BasicBlock *from, BasicBlock *to) {
+        if (!isEdgeExecutable(from, to))
+            cfgWork_.emplace_back(from, to);
+    }
+
+    // The CMP a block's JA reads: the last one before it.
+    static ir::CmpInst *flagsFor(const Inst *ja) {
+        for (Inst *I = ja->prev(); I; I = I->prev())
+            if (I->opcode() == Opcode::CMP_U64)
+                return static_cast<ir::CmpInst *>(I);
+        return nullptr;
+    }
+    static BasicBlock *notTaken(const BasicBlock *bb, const BasicBlock *taken) {
+        for (auto *s : bb->successors)
+            if (s != taken)
+                return s;
+        return const_cast<BasicBlock *>(taken);
+    }
+
+    // Resolves the branch at the end of bb as far as the lattice allows.
+    void visitTerminator(BasicBlock *bb) {
+        const Inst *T = bb->insts.back();
+        if (!T || (T->opcode() != Opcode::JA_U64 && T->opcode() != Opcode::JMP &&
+                   T->opcode() != Opcode::RET_U64)) {
+            for (auto *s : bb->successors)
+                markEdge(bb, s);
+            return;
+        }
+        if (T->opcode() == Opcode::RET_U64)
+            return;
+        if (T->opcode() == Opcode::JMP) {
+            markEdge(bb, static_cast<const ir::JmpInst *>(T)->target());
+            return;
+        }
+        BasicBlock *taken = static_cast<const ir::JaInst *>(T)->target();
+        const ir::CmpInst *C = flagsFor(T);
+        Lattice l = C ? get(C->left()) : overdefined();
+        Lattice r = C ? get(C->right()) : overdefined();
+        if (l.kind == Lattice::Undef || r.kind == Lattice::Undef)
+            return;
+        if (l.isConst() && r.isConst()) {
+            markEdge(bb, l.value > r.value ? taken : notTaken(bb, taken));
+            return;
+        }
+        for (auto *s : bb->successors)
+            markEdge(bb, s);
+    }
+
+    void visitPhi(const ir::PhiInst *P) {
+        BasicBlock *bb = P->parent();
+        Lattice l;
+        for (size_t i = 0; i < P->numIncomings(); ++i)
+            if (isEdgeExecutable(P->incomingBlock(i), bb))
+                l = meet(l, get(P->incomingValue(i)));
+        update(P->result(), l);
+    }
+
+    void visit(const Inst *I) {
+        switch (I->opcode()) {
+        case Opcode::MOVI_U64:
+            update(I->result(), constant(static_cast<const ir::MoviInst *>(I)->imm()));
+            break;
+        case Opcode::U32TOU64: {
+            Lattice s = get(static_cast<const ir::CastInst *>(I)->src());
+            if (s.isConst())
+                s.value &= 0xffffffffULL;
+            update(I->result(), s);
+            break;
+        }
+        case Opcode::ADDI_U64: {
+            auto *A = static_cast<const ir::AddiInst *>(I);
+            Lattice s = get(A->src());
+            if (s.isConst())
+                s.value += A->imm();
+            update(I->result(), s);
+            break;
+        }
+        case Opcode::MUL_U64: {
+            auto *M = static_cast<const ir::MulInst *>(I);
+            Lattice a = get(M->left()), b = get(M->right());
+            if ((a.isConst() && a.value == 0) || (b.isConst() && b.value == 0))
+                update(I->result(), constant(0));
+            else if (a.isConst() && b.isConst())
+                update(I->result(), constant(a.value * b.value));
+            else if (a.kind == Lattice::Over || b.kind == Lattice::Over)
+                update(I->result(), overdefined());
+            break;
+        }
+        case Opcode::PHI_U64:
+            visitPhi(static_cast<const ir::PhiInst *>(I));
+            break;
+        case Opcode::CMP_U64:
+        case Opcode::JA_U64:
+            visitTerminator(I->parent());
+            break;
+        default:
+            break;
+        }
+    }
+
+    void solve(const std::vector<std::optional<uint64_t>> &knownArgs) {
+        for (size_t i = 0; i < g_->args().size(); ++i)
+            if (SSAValue *a = g_->args()[i].val)
+                state_[a] = i < knownArgs.size() && knownArgs[i] ? constant(*knownArgs[i]) : overdefined();
+
+        cfgWork_.emplace_back(nullptr, g_->entry());
+        while (!cfgWork_.empty() || !ssaWork_.empty()) {
+            while (!cfgWork_.empty()) {
+                auto [from, to] = cfgWork_.back();
+                cfgWork_.pop_back();
+                if (from) {
+                    if (isEdgeExecutable(from, to))
+                        continue;
+                    execPreds_[to].push_back(from);
+                }
+                if (executable_[to]) {
+                    // Only the phis see a new edge.
+                    for (const Inst *I = to->insts.front(); I && I->opcode() == Opcode::PHI_U64;
+                         I = I->next())
+                        visitPhi(static_cast<const ir::PhiInst *>(I));
+                    continue;
+                }
+                executable_[to] = true;
+                for (const Inst *I : to->insts)
+                    visit(I);
+                visitTerminator(to);
+            }
+            while (!ssaWork_.empty()) {
+                SSAValue *v = ssaWork_.back();
+                ssaWork_.pop_back();
+                for (const Inst *U : v->users)
+                    if (U->parent() && executable_.get(U->parent()))
+                        visit(U);
+            }
+        }
+    }
+
+    void rewrite() {
+        ir::IRGraph &g = *g_;
+        // Arguments with a known value get a movi at the top of the entry.
+        for (auto &a : g.args()) {
+            if (!a.val || !state_.get(a.val).isConst() || a.val->users.empty())
+                continue;
+            SSAValue *c = g.createValue();
+            Inst *M = g.createMovi(c, state_.get(a.val).value);
+            BasicBlock *entry = g.entry();
+            if (Inst *pos = entry->firstNonPhi())
+                entry->insertBefore(pos, M);
+            else
+                entry->addInst(M);
+            a.val->replaceAllUsesWith(c);
+            ++numConstantsFolded;
+        }
+
+        // Folding only removes edges, so this stays conservative.
+        BlockMap<bool> flagsLiveIn = ir::flagsLiveIn(g);
+        std::vector<BasicBlock *> dead;
+        for (auto *bb : g.getBlocks()) {
+            if (!executable_.get(bb)) {
+                dead.push_back(bb);
+                continue;
+            }
+            Inst *pos = bb->firstNonPhi();
+            for (Inst *I = bb->insts.front(); I;) {
+                Inst *next = I->next();
+                SSAValue *r = I->result();
+                if (r && I->opcode() != Opcode::MOVI_U64 && state_.get(r).isConst()) {
+                    // The new movi takes over r, so its users stay as they are.
+                    Inst *M = g.createMovi(r, state_.get(r).value);
+                    if (I->opcode() == Opcode::PHI_U64 && pos)
+                        bb->insertBefore(pos, M);
+                    else if (I->opcode() == Opcode::PHI_U64)
+                        bb->addInst(M);
+                    else
+                        bb->insertBefore(I, M);
+                    I->eraseFromParent();
+                    ++numConstantsFolded;
+                }
+                I = next;
+            }
+            foldBranch(bb, flagsLiveIn);
+        }
+        numBlocksRemoved += dead.size();
+        g.eraseBlocks(dead);
+
+        // Phis that lost all but one incoming are copies.
+        for (auto *bb : g.getBlocks())
+            for (Inst *I = bb->insts.front(); I && I->opcode() == Opcode::PHI_U64;) {
+                Inst *next = I->next();
+                auto *P = static_cast<ir::PhiInst *>(I);
+                if (P->numIncomings() == 1 && P->incomingValue(0) != P->result()) {
+                    P->result()->replaceAllUsesWith(P->incomingValue(0));
+                    P->eraseFromParent();
+                }
+                I = next;
+            }
+    }
+
+    void foldBranch(BasicBlock *bb, const BlockMap<bool> &flagsLiveIn) {
+        Inst *T = bb->insts.back();
+        if (!T || T->opcode() != Opcode::JA_U64)
+            return;
+        BasicBlock *taken = static_cast<ir::JaInst *>(T)->target();
+        BasicBlock *other = notTaken(bb, taken);
+        bool toTaken = isEdgeExecutable(bb, taken), toOther = isEdgeExecutable(bb, other);
+        if (taken != other && toTaken == toOther)
+            return;
+        BasicBlock *live = toTaken ? taken : other;
+        BasicBlock *gone = toTaken ? other : taken;
+        // The cmp stays when a ja from live on, possibly past blocks that
+        // only jump, still reads its flags.
+        if (ir::CmpInst *C = flagsFor(T); C && !flagsLiveIn.get(live))
+            C->eraseFromParent();
+        T->eraseFromParent();
+        bb->addInst(g_->createJmp(live));
+        if (gone != live)
+            gone->removePhiIncomings(bb);
+        bb->removeSuccessor(gone);
+        ++numBranchesFolded;
+    }
+
+  public:
+    // Returns true if the graph changed.
+    bool run(ir::IRGraph &g, const std::vector<std::optional<uint64_t>> &knownArgs = {}) {
+        g_ = &g;
+        state_.clear();
+        executable_.clear();
+        execPreds_.clear();
+        cfgWork_.clear();
+        ssaWork_.clear();
+        numConstantsFolded = numBranchesFolded = numBlocksRemoved = 0;
+        if (!g.entry())
+            return false;
+        solve(knownArgs);
+        rewrite();
+        return numConstantsFolded + numBranchesFolded + numBlocksRemoved > 0;
+    }
+
+    Lattice valueOf(const SSAValue *v) const {
+        return state_.get(v);
+    }
+    bool isExecutable(const BasicBlock *bb) const {
+        return executable_.get(bb);
+    }
+};
+}
@@ -0,0 +1,143 @@
+#pragma once
+#include <cstddef>
+#include <unordered_set>
+#include <vector>
+
+#include "analysis/induction_vars.h"
+#include "opt/loop_utils.h"
+
+namespace opt {
+using analysis::InductionVar;
+using analysis::InductionVars;
+using ir::SSAValue;
+
+// Replaces each mul that computes an induction variable, scale * i + offset
+// for a basic IV i = init, init + step, ..., with a new header phi that
+// starts at scale * init + offset in the preheader (inserted when missing)
+// and grows by scale * step, an addi, on every back edge. Muls computing
+// the same linear form share one phi. Loops are visited innermost first
+// over one analysis; a loop around a rewritten one is analyzed again before
+// its turn, since the mul emitted in the inner preheader may be an IV of
+// it. Loops LICM would skip are skipped too.
+class StrengthReduction {
+  public:
+    size_t numReduced = 0;
+    size_t numPreheadersInserted = 0;
+
+  private:
+    struct Reduced {
+        InductionVar form;
+        SSAValue *phi;
+    };
+
+    static Inst *insertionPoint(BasicBlock *pre) {
+        Inst *T = pre->insts.back();
+        return T && T->opcode() == Opcode::JMP ? T : nullptr;
+    }
+    static void emit(BasicBlock *bb, Inst *pos, Inst *I) {
+        if (pos)
+            bb->insertBefore(pos, I);
+        else
+            bb->addInst(I);
+    }
+
+    SSAValue *startValue(ir::IRGraph &g, BasicBlock *pre, const analysis::BasicIV &basic,
+                         const InductionVar &form) {
+        Inst *pos = insertionPoint(pre);
+        SSAValue *v = g.createValue();
+        SSAValue *init = basic.init;
+        if (init->def && init->def->opcode() == Opcode::MOVI_U64) {
+            uint64_t c = static_cast<ir::MoviInst *>(init->def)->imm();
+            emit(pre, pos, g.createMovi(v, form.scale * c + form.offset));
+            return v;
+        }
+        SSAValue *k = g.createValue();
+        emit(pre, pos, g.createMovi(k, form.scale));
+        emit(pre, pos, g.createMul(v, init, k));
+        if (form.offset == 0)
+            return v;
+        SSAValue *w = g.createValue();
+        emit(pre, pos, g.createAddi(w, v, form.offset));
+        return w;
+    }
+
+    void reduceLoop(ir::IRGraph &g, analysis::LoopAnalyzer &LA, Loop &L, const BlockMap<bool> &in,
+                    const InductionVars &IV, const std::vector<Inst *> &muls) {
+        BasicBlock *pre = loopPreheader(L, in);
+        if (!pre) {
+            pre = insertPreheader(g, LA, L, in);
+            ++numPreheadersInserted;
+        }
+        const analysis::LoopIVs *info = IV.loopInfo(&L);
+        std::vector<Reduced> done;
+        for (Inst *M : muls) {
+            InductionVar form = IV.ivOf(M->result());
+            SSAValue *phi = nullptr;
+            for (auto &d : done)
+                if (d.form.base == form.base && d.form.scale == form.scale && d.form.offset == form.offset)
+                    phi = d.phi;
+            if (!phi) {
+                const analysis::BasicIV *basic = nullptr;
+                for (auto &b : info->basics)
+                    if (b.phi->result() == form.base)
+                        basic = &b;
+                SSAValue *start = startValue(g, pre, *basic, form);
+                phi = g.createValue();
+                SSAValue *next = g.createValue();
+                std::vector<std::pair<BasicBlock *, SSAValue *>> incomings;
+                for (size_t i = 0; i < basic->phi->numIncomings(); ++i) {
+                    BasicBlock *from = basic->phi->incomingBlock(i);
+                    incomings.emplace_back(from, in.get(from) ? next : start);
+                }
+                BasicBlock *H = L.header;
+                Inst *first = H->firstNonPhi();
+                Inst *P = g.createPhi(phi, incomings);
+                Inst *A = g.createAddi(next, phi, form.scale * basic->step);
+                emit(H, first, P);
+                emit(H, first, A);
+                done.push_back({form, phi});
+            }
+            M->result()->replaceAllUsesWith(phi);
+            M->eraseFromParent();
+            ++numReduced;
+        }
+    }
+
+  public:
+    // Returns true if the graph changed.
+    bool run(ir::IRGraph &g) {
+        analysis::AnalysisManager AM(g);
+        return run(AM);
+    }
+    // Works on AM's loop nest, keeping it in step with the preheaders it
+    // inserts.
+    bool run(analysis::AnalysisManager &AM) {
+        ir::IRGraph &g = AM.graph();
+        numReduced = numPreheadersInserted = 0;
+        if (!g.entry())
+            return false;
+        LoopAnalyzer &LA = AM.getLoopsForUpdate();
+        InductionVars IV;
+        IV.run(LA);
+        LoopMembership members;
+        std::unordered_set<const Loop *> stale;
+        for (Loop *L : loopsInnermostFirst(LA)) {
+            if (L->irreducible || L->header == g.entry() || readsIncomingFlags(L->header))
+                continue;
+            if (stale.count(L))
+                IV.update(*L);
+            std::vector<Inst *> muls;
+            for (auto *b : L->blocks)
+                for (Inst *I : b->insts)
+                    if (I->opcode() == Opcode::MUL_U64 && IV.ivOf(I->result()).loop == L)
+                        muls.push_back(I);
+            if (muls.empty())
+                continue;
+            reduceLoop(g, LA, *L, members.mark(*L), IV, muls);
+            for (Loop *A = L->parent; A != LA.rootLoop && stale.insert(A).second; A = A->parent) {
+            }
+        }
+        return numReduced != 0;
+    }
+};
+}
@@ -0,0 +1,145 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace opt {
+
+// A fixed set of workers for independent tasks of uneven cost. The calling
+// thread is worker 0; the others are started once and sleep between
+// batches. Each worker pops tasks from the front of its own deque and,
+// when that runs dry, steals from the back of another's, so one slow task
+// does not leave the rest of its share waiting.
+class WorkStealingPool {
+    struct Worker {
+        std::mutex m;
+        std::deque<size_t> tasks;
+    };
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+
+    // The current batch.
+    const std::function<void(size_t, unsigned)> *fn_ = nullptr;
+    std::vector<std::exception_ptr> errors_;
+
+    std::mutex m_;
+    std::condition_variable start_, done_;
+    uint64_t generation_ = 0;
+    unsigned busy_ = 0;
+    bool stop_ = false;
+
+    bool pop(unsigned w, size_t &task) {
+        for (unsigned i = 0; i < workers_.size(); ++i) {
+            Worker &v = *workers_[(w + i) % workers_.size()];
+            std::lock_guard<std::mutex> lock(v.m);
+            if (v.tasks.empty())
+                continue;
+            if (i == 0) {
+                task = v.tasks.front();
+                v.tasks.pop_front();
+            } else {
+                task = v.tasks.back();
+                v.tasks.pop_back();
+            }
+            return true;
+        }
+        return false;
+    }
+
+    void work(unsigned w) {
+        size_t task;
+        while (pop(w, task)) {
+            try {
+                (*fn_)(task, w);
+            } catch (...) {
+                errors_[task] = std::current_exception();
+            }
+        }
+    }
+
+    void loop(unsigned w) {
+        uint64_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(m_);
+                start_.wait(lock, [&] { return stop_ || generation_ != seen; });
+                if (stop_)
+                    return;
+                seen = generation_;
+            }
+            work(w);
+            std::lock_guard<std::mutex> lock(m_);
+            if (--busy_ == 0)
+                done_.notify_one();
+        }
+    }
+
+  public:
+    // 0 means one worker per hardware thread.
+    explicit WorkStealingPool(unsigned numThreads = 0) {
+        if (numThreads == 0)
+            numThreads = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned w = 0; w < numThreads; ++w)
+            workers_.push_back(std::make_unique<Worker>());
+        for (unsigned w = 1; w < numThreads; ++w)
+            threads_.emplace_back([this, w] { loop(w); });
+    }
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_);
+            stop_ = true;
+        }
+        start_.notify_all();
+        for (auto &t : threads_)
+            t.join();
+    }
+
+    unsigned numThreads() const {
+        return static_cast<unsigned>(workers_.size());
+    }
+
+    // Calls fn(task, worker) for every task in [0, n) and waits for all of
+    // them. A worker runs one task at a time, so per-worker state indexed by
+    // the worker number needs no locking. If tasks throw, the exception of
+    // the lowest-numbered one is rethrown once all have finished.
+    void parallelFor(size_t n, const std::function<void(size_t, unsigned)> &fn) {
+        if (n == 0)
+            return;
+        unsigned nw = numThreads();
+        // Contiguous shares keep neighbouring tasks on one worker until
+        // stealing kicks in.
+        for (unsigned w = 0; w < nw; ++w) {
+            std::lock_guard<std::mutex> lock(workers_[w]->m);
+            for (size_t t = n * w / nw; t < n * (w + 1) / nw; ++t)
+                workers_[w]->tasks.push_back(t);
+        }
+        fn_ = &fn;
+        errors_.assign(n, nullptr);
+        {
+            std::lock_guard<std::mutex> lock(m_);
+            busy_ = nw - 1;
+            ++generation_;
+        }
+        start_.notify_all();
+        work(0);
+        {
+            std::unique_lock<std::mutex> lock(m_);
+            done_.wait(lock, [&] { return busy_ == 0; });
+        }
+        fn_ = nullptr;
+        for (auto &e : errors_)
+            if (e)
+                std::rethrow_exception(e);
+    }
+};
+}
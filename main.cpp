@@ -1,3 +1,5 @@
+#include "codegen/x86_64_jit.h"
+#include "exec/interpreter.h"
 #include "ir/ir_graph.h"
 #include <algorithm>
 #include <cassert>
@@ -67,9 +69,27 @@ int main() {
     assert(graph.checkDataFlow() && "Data flow error");
     std::cout << "DataFlow OK.\n";
 
+    exec::BytecodeFunction fact = exec::lowerToBytecode(graph);
+    uint64_t fact10 = exec::interpret(fact, {10});
+    assert(fact10 == 3628800 && "interpreter error");
+    std::cout << "fact(10) = " << fact10 << " (interpreted)\n";
+    codegen::x86_64::JitFunction native = codegen::x86_64::compileX86_64(graph);
+    uint64_t native10 = native.as<uint64_t(uint32_t)>()(10);
+    assert(native10 == fact10 && "JIT error");
+    std::cout << "fact(10) = " << native10 << " (native, " << native.codeSize() << " bytes)\n";
+
     testExample1();
     testExample2();
     testExample3();
+    testDeepChainTraversals();
+    testDominanceQueries();
+    testDomTreeIncrementalSingle();
+    testDomTreeIncrementalBatch();
+    testDomTreeDeleteMakesUnreachable();
+    testDomTreeVerifyUpdatesThrows();
+    testBitVectorBasics();
+    testDominanceFrontierExamples();
+    testDominanceFrontierRandom();
 
     test1();
     test2();
@@ -77,6 +97,68 @@ int main() {
     testLoopsExample1();
     testLoopsExample2();
     testLoopsExample3();
+    testLoopsDeepNesting();
+    testAnalysisManagerCaching();
+
+    testArenaAllocation();
+    testArenaOwnsGraph();
+    testArenaChunkCache();
+    testInstListEditing();
+    testOperandAccess();
+    testDenseIdMaps();
+    testSSABuilderFactorial();
+    testSSABuilderDiamond();
+    testSSABuilderNestedLoopsAndChains();
+    testParallelMoves();
+    testInterpreterFactorial();
+    testInterpreterPhiCycles();
+    testX86Encoding();
+    testJitFactorial();
+    testJitPhiCycles();
+    testJitDifferential();
+    testLinearScanLoopOrder();
+    testLinearScanFactorial();
+    testLinearScanRandomPrograms();
+    testLivenessFactorial();
+    testLivenessIrreducible();
+    testLivenessRandomPrograms();
+    testSCCPDiamond();
+    testSCCPLoops();
+    testSCCPRandomPrograms();
+    testDCEDeadValuesAndPhiCycles();
+    testDCECfgSimplify();
+    testDCERandomPrograms();
+    testInstStructuralHash();
+    testGVNScopes();
+    testGVNRandomPrograms();
+    testLICMHoistsInvariants();
+    testLICMPreheaderInsertion();
+    testLICMSkipsIrreducible();
+    testLICMRandomPrograms();
+    testInductionVarsFactorial();
+    testInductionVarsTripCounts();
+    testStrengthReduction();
+    testStrengthReductionRandomPrograms();
+    testLoopUnrollFactorial();
+    testLoopUnrollCountedLoops();
+    testLoopUnrollRandomPrograms();
+    testBinaryRoundTrip();
+    testBinaryKeepsBlockIds();
+    testBinaryMappedFile();
+    testBinaryRejectsMalformed();
+    testTextRoundTrip();
+    testTextParserHandWritten();
+    testTextParserRandomPrograms();
+    testTextParserErrors();
+    testUniqueBlockNames();
+    testStreamingPrinter();
+    testPassManagerPipeline();
+    testPassManagerRandomPrograms();
+    testPassManagerReportAndErrors();
+    testWorkStealingPool();
+    testModuleText();
+    testParallelDriverDeterminism();
+    testParallelDriverReleaseAndErrors();
     std::cout << "All tests passed.\n";
 
     return 0;
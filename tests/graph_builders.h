@@ -4,8 +4,10 @@
 #include "analysis/loop_analyzer.h"
 #include "analysis/rpo.h"
 #include "ir/ir_graph.h"
+#include <cstdint>
 #include <map>
 #include <string>
+#include <vector>
 
 struct BuiltCFG {
     ir::IRGraph g;
@@ -19,4 +21,157 @@ inline ir::BasicBlock *BB(BuiltCFG &W, const std::string &name) {
 }
 inline void EDGE(ir::BasicBlock *u, ir::BasicBlock *v) {
     u->addSuccessor(v);
-}
\ No newline at end of file
+}
+// Instructions with opcode op in blocks, e.g. g.getBlocks() or L->blocks.
+inline size_t countOpcode(const std::vector<ir::BasicBlock *> &blocks, Opcode op) {
+    size_t n = 0;
+    for (auto *bb : blocks)
+        for (const ir::Inst *I : bb->insts)
+            n += I->opcode() == op;
+    return n;
+}
+// The course's fact(u32) example, as built in main.cpp. Named fact unless
+// g already has a name.
+inline void buildFactorial(ir::IRGraph &g) {
+    using namespace ir;
+    g.setSignature("u64", g.name().empty() ? "fact" : g.name(), {{"u32", "a0"}});
+    auto *entry = g.createBlock("entry");
+    auto *loop = g.createBlock("loop");
+    auto *body = g.createBlock("body");
+    auto *done = g.createBlock("done");
+    SSAValue *a0 = g.createArg("u32", "a0");
+    SSAValue *v0 = g.createValue(), *v1 = g.createValue(), *v2 = g.createValue();
+    SSAValue *p0 = g.createValue(), *p1 = g.createValue();
+    SSAValue *m = g.createValue(), *n = g.createValue();
+    entry->addInst(g.createMovi(v0, 1));
+    entry->addInst(g.createMovi(v1, 2));
+    entry->addInst(g.createCast(v2, a0));
+    entry->addSuccessor(loop);
+    loop->addInst(g.createPhi(p0, {{entry, v0}, {body, m}}));
+    loop->addInst(g.createPhi(p1, {{entry, v1}, {body, n}}));
+    loop->addInst(g.createCmp(p1, v2));
+    loop->addInst(g.createJa(done));
+    loop->addSuccessor(done);
+    loop->addSuccessor(body);
+    body->addInst(g.createMul(m, p0, p1));
+    body->addInst(g.createAddi(n, p1, 1));
+    body->addInst(g.createJmp(loop));
+    body->addSuccessor(loop);
+    done->addInst(g.createRet(p0));
+}
+
+// do { (a, b) = (b, a); i++; } while (n > i); return a;
+// The back edge is the taken side of the JA and carries a swap cycle.
+inline void buildSwapLoop(ir::IRGraph &g, bool fuse) {
+    using namespace ir;
+    g.setSignature("u64", "swap", {{"u32", "n"}});
+    auto *entry = g.createBlock("entry");
+    auto *loop = g.createBlock("loop");
+    auto *exit = g.createBlock("exit");
+    SSAValue *n0 = g.createArg("u32", "n");
+    SSAValue *x = g.createValue(), *y = g.createValue(), *z = g.createValue(), *n = g.createValue();
+    SSAValue *a = g.createValue(), *b = g.createValue(), *i = g.createValue(), *i2 = g.createValue();
+    entry->addInst(g.createMovi(x, 11));
+    entry->addInst(g.createMovi(y, 22));
+    entry->addInst(g.createMovi(z, 0));
+    entry->addInst(g.createCast(n, n0));
+    entry->addSuccessor(loop);
+    loop->addInst(g.createPhi(a, {{entry, x}, {loop, b}}));
+    loop->addInst(g.createPhi(b, {{entry, y}, {loop, a}}));
+    loop->addInst(g.createPhi(i, {{entry, z}, {loop, i2}}));
+    if (fuse) {
+        loop->addInst(g.createAddi(i2, i, 1));
+        loop->addInst(g.createCmp(n, i2));
+    } else {
+        loop->addInst(g.createCmp(n, i));
+        loop->addInst(g.createAddi(i2, i, 1));
+    }
+    loop->addInst(g.createJa(loop));
+    loop->addSuccessor(loop);
+    loop->addSuccessor(exit);
+    exit->addInst(g.createRet(a));
+}
+
+// entry: cmp 5, 3 (or 3, 5 when !above), then on to a either way: as the
+// ja's target or its fall-through. a has no cmp of its own, so its ja x
+// reads entry's flags; x returns 5 and y returns 3, so the graph returns 5
+// when above and 3 otherwise. With hop, a only jumps to m, which holds the
+// ja x, so the flags pass through a on their way.
+inline void buildFlagsAcrossBlocks(ir::IRGraph &g, bool above, bool hop = false) {
+    using namespace ir;
+    g.setSignature("u64", "flags", {});
+    auto *entry = g.createBlock("entry");
+    auto *a = g.createBlock("a");
+    auto *b = g.createBlock("b");
+    auto *x = g.createBlock("x");
+    auto *y = g.createBlock("y");
+    SSAValue *five = g.createValue(), *three = g.createValue();
+    entry->addInst(g.createMovi(five, 5));
+    entry->addInst(g.createMovi(three, 3));
+    if (above) {
+        entry->addInst(g.createCmp(five, three));
+        entry->addInst(g.createJa(a));
+        entry->addSuccessor(b);
+        entry->addSuccessor(a);
+    } else {
+        entry->addInst(g.createCmp(three, five));
+        entry->addInst(g.createJa(b));
+        entry->addSuccessor(a);
+        entry->addSuccessor(b);
+    }
+    BasicBlock *reader = a;
+    if (hop) {
+        reader = g.createBlock("m");
+        a->addInst(g.createJmp(reader));
+        a->addSuccessor(reader);
+    }
+    reader->addInst(g.createJa(x));
+    reader->addSuccessor(y);
+    reader->addSuccessor(x);
+    b->addInst(g.createRet(three));
+    x->addInst(g.createRet(five));
+    y->addInst(g.createRet(three));
+}
+
+inline uint64_t referenceFactorial(uint32_t n) {
+    uint64_t r = 1;
+    for (uint64_t i = 2; i <= n; ++i)
+        r *= i;
+    return r;
+}
+
+// i = start; while (i <= bound) (or bound > i) i += step; returns the number
+// of times the header ran.
+inline void buildCountedLoop(ir::IRGraph &g, uint64_t start, uint64_t bound, uint64_t step, bool inclusive) {
+    using namespace ir;
+    g.setSignature("u64", "count", {});
+    auto *entry = g.createBlock("entry");
+    auto *head = g.createBlock("head");
+    auto *body = g.createBlock("body");
+    auto *exit = g.createBlock("exit");
+    SSAValue *i0 = g.createValue(), *B = g.createValue(), *z = g.createValue();
+    SSAValue *i = g.createValue(), *c = g.createValue(), *c1 = g.createValue(), *i2 = g.createValue();
+    entry->addInst(g.createMovi(i0, start));
+    entry->addInst(g.createMovi(B, bound));
+    entry->addInst(g.createMovi(z, 0));
+    entry->addInst(g.createJmp(head));
+    entry->addSuccessor(head);
+    head->addInst(g.createPhi(i, {{entry, i0}, {body, i2}}));
+    head->addInst(g.createPhi(c, {{entry, z}, {body, c1}}));
+    head->addInst(g.createAddi(c1, c, 1));
+    if (inclusive) {
+        head->addInst(g.createCmp(i, B));
+        head->addInst(g.createJa(exit));
+        head->addSuccessor(body);
+        head->addSuccessor(exit);
+    } else {
+        head->addInst(g.createCmp(B, i));
+        head->addInst(g.createJa(body));
+        head->addSuccessor(exit);
+        head->addSuccessor(body);
+    }
+    body->addInst(g.createAddi(i2, i, step));
+    body->addInst(g.createJmp(head));
+    body->addSuccessor(head);
+    exit->addInst(g.createRet(c1));
+}
@@ -0,0 +1,193 @@
+#pragma once
+#include "codegen/x86_64_jit.h"
+#include "exec/interpreter.h"
+#include "ir/ir_graph.h"
+#include "ir/ssa_builder.h"
+#include <cassert>
+#include <functional>
+#include <random>
+#include <vector>
+
+// Random structured programs over a few mutable variables, put into SSA by
+// SSABuilder: straight-line arithmetic, diamonds and counted loops.
+struct ProgramGen {
+    ir::IRGraph &g;
+    ir::SSABuilder B;
+    std::mt19937_64 &rng;
+    std::vector<ir::SSABuilder::Variable> vars;
+    ir::BasicBlock *cur = nullptr;
+    // Also emit counter * k + c expressions inside loops.
+    bool ivExprs = false;
+    std::vector<ir::SSABuilder::Variable> counters;
+    // Also start some loops at a nonzero constant and bound them by a0, so
+    // their trip count is only known at run time.
+    bool argBounds = false;
+    ir::SSAValue *argBound = nullptr;
+
+    ProgramGen(ir::IRGraph &graph, std::mt19937_64 &r) : g(graph), B(graph), rng(r) {
+    }
+
+    ir::SSAValue *read(size_t k) {
+        return B.readVariable(vars[k], cur);
+    }
+    ir::SSAValue *constant(uint64_t c) {
+        ir::SSAValue *v = g.createValue();
+        cur->addInst(g.createMovi(v, c));
+        return v;
+    }
+    ir::BasicBlock *newBlock() {
+        return g.createBlock();
+    }
+    void stmt() {
+        size_t d = rng() % vars.size();
+        ir::SSAValue *r = g.createValue();
+        switch (rng() % (ivExprs && !counters.empty() ? 4 : 3)) {
+        case 0:
+            cur->addInst(g.createMovi(r, rng() % 1000));
+            break;
+        case 1:
+            cur->addInst(g.createMul(r, read(rng() % vars.size()), read(rng() % vars.size())));
+            break;
+        case 2:
+            cur->addInst(g.createAddi(r, read(rng() % vars.size()), rng() % 50));
+            break;
+        default: {
+            ir::SSAValue *i = B.readVariable(counters[rng() % counters.size()], cur);
+            ir::SSAValue *x = g.createValue();
+            cur->addInst(g.createAddi(x, i, rng() % 5));
+            cur->addInst(g.createMul(r, x, constant(1 + rng() % 9)));
+            break;
+        }
+        }
+        B.writeVariable(vars[d], cur, r);
+    }
+    void seq(int depth, int len) {
+        for (int i = 0; i < len; ++i) {
+            unsigned k = rng() % 6;
+            if (depth > 0 && k == 0)
+                diamond(depth - 1);
+            else if (depth > 0 && k == 1)
+                loop(depth - 1);
+            else
+                stmt();
+        }
+    }
+    void diamond(int depth) {
+        auto *thenB = newBlock();
+        auto *elseB = newBlock();
+        auto *join = newBlock();
+        cur->addInst(g.createCmp(read(rng() % vars.size()), read(rng() % vars.size())));
+        cur->addInst(g.createJa(thenB));
+        cur->addSuccessor(elseB);
+        cur->addSuccessor(thenB);
+        B.sealBlock(thenB);
+        B.sealBlock(elseB);
+        cur = elseB;
+        seq(depth, 2);
+        cur->addInst(g.createJmp(join));
+        cur->addSuccessor(join);
+        cur = thenB;
+        seq(depth, 2);
+        cur->addInst(g.createJmp(join));
+        cur->addSuccessor(join);
+        B.sealBlock(join);
+        cur = join;
+    }
+    void loop(int depth) {
+        auto counter = B.declareVariable();
+        bool fromArg = argBounds && rng() % 2;
+        B.writeVariable(counter, cur, constant(fromArg ? 1 + rng() % 3 : 0));
+        ir::SSAValue *limit = fromArg ? argBound : constant(1 + rng() % 4);
+        auto *header = newBlock();
+        auto *body = newBlock();
+        auto *exit = newBlock();
+        cur->addInst(g.createJmp(header));
+        cur->addSuccessor(header);
+        cur = header;
+        cur->addInst(g.createCmp(B.readVariable(counter, header), limit));
+        cur->addInst(g.createJa(exit));
+        cur->addSuccessor(exit);
+        cur->addSuccessor(body);
+        B.sealBlock(body);
+        cur = body;
+        counters.push_back(counter);
+        seq(depth, 3);
+        counters.pop_back();
+        ir::SSAValue *next = g.createValue();
+        cur->addInst(g.createAddi(next, B.readVariable(counter, cur), ivExprs ? 1 + rng() % 3 : 1));
+        B.writeVariable(counter, cur, next);
+        cur->addInst(g.createJmp(header));
+        cur->addSuccessor(header);
+        B.sealBlock(header);
+        B.sealBlock(exit);
+        cur = exit;
+    }
+    // Named rand unless g already has a name.
+    void build(size_t numVars) {
+        g.setSignature("u64", g.name().empty() ? "rand" : g.name(), {{"u32", "a0"}, {"u64", "a1"}});
+        cur = g.createBlock("entry");
+        B.sealBlock(cur);
+        ir::SSAValue *a0 = g.createArg("u32", "a0");
+        ir::SSAValue *a1 = g.createArg("u64", "a1");
+        ir::SSAValue *w = g.createValue();
+        cur->addInst(g.createCast(w, a0));
+        argBound = w;
+        for (size_t i = 0; i < numVars; ++i) {
+            vars.push_back(B.declareVariable());
+            B.writeVariable(vars.back(), cur, i % 3 == 0 ? w : i % 3 == 1 ? a1 : constant(i + 2));
+        }
+        seq(2, 6);
+        ir::SSAValue *acc = read(0);
+        for (size_t i = 1; i < vars.size(); ++i) {
+            ir::SSAValue *m = g.createValue();
+            cur->addInst(g.createMul(m, acc, read(i)));
+            acc = m;
+        }
+        cur->addInst(g.createRet(acc));
+    }
+};
+
+// Runs before and after on `trials` random (a0, a1) inputs and asserts they
+// agree. a0 stays small, so loops bounded by it stay short.
+inline void checkSameResults(const exec::BytecodeFunction &before, const exec::BytecodeFunction &after,
+                             std::mt19937_64 &rng, int trials = 4) {
+    for (int t = 0; t < trials; ++t) {
+        uint64_t a0 = rng() % 8, a1 = rng();
+        assert(exec::interpret(after, {a0, a1}) == exec::interpret(before, {a0, a1}));
+    }
+}
+// The same, running after both in the interpreter and as native code.
+inline void checkSameResults(const exec::BytecodeFunction &before, const ir::IRGraph &after,
+                             std::mt19937_64 &rng, int trials = 4) {
+    exec::BytecodeFunction bc = exec::lowerToBytecode(after);
+    auto native = codegen::x86_64::compileX86_64(after);
+    for (int t = 0; t < trials; ++t) {
+        uint64_t a0 = rng() % 8, a1 = rng();
+        uint64_t expect = exec::interpret(before, {a0, a1});
+        assert(exec::interpret(bc, {a0, a1}) == expect && native.call({a0, a1}) == expect);
+    }
+}
+
+// Differential test of a transform: builds `iters` random programs from
+// seed, each configured by setup(gen, iter) if given, applies
+// transform(g, iter) and checks that the result keeps its def-use chains and
+// computes what the original did. Returns the sum of what transform
+// returned, usually the pass's counter.
+template <typename Transform>
+size_t checkPassOnRandomPrograms(uint64_t seed, int iters, Transform transform,
+                                 const std::function<void(ProgramGen &, int)> &setup = nullptr) {
+    std::mt19937_64 rng(seed);
+    size_t total = 0;
+    for (int iter = 0; iter < iters; ++iter) {
+        ir::IRGraph g;
+        ProgramGen gen(g, rng);
+        if (setup)
+            setup(gen, iter);
+        gen.build(2 + iter % 8);
+        exec::BytecodeFunction before = exec::lowerToBytecode(g);
+        total += transform(g, iter);
+        assert(g.checkDataFlow());
+        checkSameResults(before, g, rng);
+    }
+    return total;
+}
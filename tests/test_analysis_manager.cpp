@@ -0,0 +1,49 @@
+#include "analysis/analysis_manager.h"
+#include "graph_builders.h"
+#include <cassert>
+
+using namespace ir;
+using namespace analysis;
+
+void testAnalysisManagerCaching() {
+    BuiltCFG W;
+    auto *S = BB(W, "S");
+    auto *H = BB(W, "H");
+    auto *B = BB(W, "B");
+    auto *X = BB(W, "X");
+    EDGE(S, H);
+    EDGE(H, B);
+    EDGE(B, H);
+    EDGE(H, X);
+
+    AnalysisManager AM(W.g);
+    assert(!AM.isCached(AnalysisManager::DOM_TREE));
+    const LoopAnalyzer &LA = AM.getLoops();
+    assert(LA.loops.size() == 1 && LA.loops[0]->header == H);
+    assert(AM.timesComputed(AnalysisManager::DOM_TREE) == 1);
+
+    AM.getDomTree();
+    AM.getLoops();
+    AM.getRPO();
+    AM.getRPO();
+    assert(AM.timesComputed(AnalysisManager::DOM_TREE) == 1);
+    assert(AM.timesComputed(AnalysisManager::LOOPS) == 1);
+    assert(AM.timesComputed(AnalysisManager::RPO_ANALYSIS) == 1);
+
+    SSAValue *v = W.g.createValue();
+    B->addInst(W.g.createMovi(v, 1));
+    assert(AM.isCached(AnalysisManager::LOOPS));
+
+    uint64_t before = W.g.cfgEpoch();
+    EDGE(X, S);
+    assert(W.g.cfgEpoch() != before);
+    assert(!AM.isCached(AnalysisManager::DOM_TREE) && !AM.isCached(AnalysisManager::RPO_ANALYSIS));
+    const LoopAnalyzer &LA2 = AM.getLoops();
+    assert(LA2.loops.size() == 2);
+    assert(AM.timesComputed(AnalysisManager::DOM_TREE) == 2);
+    assert(AM.getDomTree().idom(H) == S);
+
+    AM.invalidate(AnalysisManager::RPO_ANALYSIS);
+    assert(AM.getRPO().rpo.front() == S);
+    assert(AM.timesComputed(AnalysisManager::RPO_ANALYSIS) == 2);
+}
@@ -0,0 +1,99 @@
+#include "graph_builders.h"
+#include "ir/arena.h"
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+using namespace ir;
+
+namespace {
+struct Tracked {
+    std::vector<int> *log;
+    int tag;
+    Tracked(std::vector<int> *l, int t) : log(l), tag(t) {
+    }
+    ~Tracked() {
+        log->push_back(tag);
+    }
+};
+}
+
+void testArenaAllocation() {
+    Arena A(256);
+    for (size_t align : {1u, 2u, 4u, 8u, 16u}) {
+        void *p = A.allocate(3, align);
+        assert(reinterpret_cast<uintptr_t>(p) % align == 0);
+    }
+    void *big = A.allocate(4096, 64);
+    assert(big && reinterpret_cast<uintptr_t>(big) % 64 == 0);
+    assert(A.numChunks() >= 2);
+
+    std::vector<int> log;
+    {
+        Arena B;
+        B.create<Tracked>(&log, 1);
+        B.create<Tracked>(&log, 2);
+        Arena C(std::move(B));
+        C.create<Tracked>(&log, 3);
+        assert(log.empty());
+    }
+    assert((log == std::vector<int>{3, 2, 1}));
+}
+
+void testArenaOwnsGraph() {
+    BuiltCFG W;
+    auto *A = BB(W, "A");
+    auto *B = BB(W, "B");
+    EDGE(A, B);
+    SSAValue *x = W.g.createValue();
+    SSAValue *y = W.g.createValue();
+    A->addInst(W.g.createMovi(x, 7));
+    A->addInst(W.g.createAddi(y, x, 1));
+    B->addInst(W.g.createRet(y));
+
+    size_t used = W.g.arena().bytesUsed();
+    assert(used > 0);
+    IRGraph moved = std::move(W.g);
+    assert(moved.numBlocks() == 2 && moved.numValues() == 2);
+    assert(moved.arena().bytesUsed() == used);
+    assert(x->def == A->insts.front() && y->users.front() == B->insts.front());
+    assert(moved.checkDataFlow());
+}
+
+void testArenaChunkCache() {
+    ChunkCache cache(4096, 4);
+    assert(!ChunkCache::current());
+    {
+        ChunkCache::Scope scope(cache);
+        assert(ChunkCache::current() == &cache);
+        {
+            Arena A(4096);
+            for (int i = 0; i < 6; ++i)
+                A.allocate(3000, 8);
+            A.allocate(10000, 8);
+            assert(A.numChunks() == 7 && cache.numTaken() == 6 && cache.numReused() == 0);
+        }
+        // Only chunks of the cache's size are kept, up to its limit.
+        assert(cache.numCached() == 4);
+        Arena B(4096);
+        B.allocate(3000, 8);
+        B.allocate(3000, 8);
+        assert(cache.numReused() == 2 && cache.numCached() == 2);
+        {
+            ChunkCache other;
+            ChunkCache::Scope inner(other);
+            assert(ChunkCache::current() == &other);
+        }
+        assert(ChunkCache::current() == &cache);
+    }
+    assert(!ChunkCache::current());
+
+    // Graphs built and dropped under a cache recycle their memory.
+    ChunkCache graphs;
+    ChunkCache::Scope scope(graphs);
+    for (int i = 0; i < 3; ++i) {
+        IRGraph g;
+        buildFactorial(g);
+    }
+    assert(graphs.numTaken() == 3 && graphs.numReused() == 2 && graphs.numCached() == 1);
+}
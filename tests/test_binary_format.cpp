@@ -0,0 +1,192 @@
+#include "exec/interpreter.h"
+#include "graph_builders.h"
+#include "ir/binary_format.h"
+#include "ir/text_parser.h"
+#include "opt/loop_unroll.h"
+#include "program_gen.h"
+#include <cassert>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+
+using namespace ir;
+
+namespace {
+bool sameText(const IRGraph &a, const IRGraph &b) {
+    if (a.numBlocks() != b.numBlocks() || a.name() != b.name() || a.returnType() != b.returnType())
+        return false;
+    for (size_t i = 0; i < a.numBlocks(); ++i) {
+        const BasicBlock *x = a.getBlocks()[i], *y = b.getBlocks()[i];
+        if (x->label != y->label || x->toString() != y->toString() ||
+            x->successors.size() != y->successors.size())
+            return false;
+    }
+    return true;
+}
+
+template <typename F>
+bool throwsRuntimeError(F f) {
+    try {
+        f();
+    } catch (const std::runtime_error &) {
+        return true;
+    }
+    return false;
+}
+}
+
+void testBinaryRoundTrip() {
+    IRGraph g;
+    buildFactorial(g);
+    std::vector<uint8_t> bytes = writeBinary(g);
+    BinaryView V(bytes.data(), bytes.size());
+    assert(V.functionName() == "fact" && V.numBlocks() == 4 && V.numInsts() == 11 && V.numArgs() == 1);
+
+    // Walk the tables in place.
+    size_t phis = 0, muls = 0;
+    for (uint32_t b = 0; b < V.numBlocks(); ++b) {
+        const binary::Block &B = V.block(b);
+        for (uint32_t i = B.firstInst; i < B.firstInst + B.numInsts; ++i) {
+            phis += V.inst(i).opcode == static_cast<uint8_t>(Opcode::PHI_U64);
+            muls += V.inst(i).opcode == static_cast<uint8_t>(Opcode::MUL_U64);
+        }
+    }
+    assert(phis == 2 && muls == 1);
+    assert(V.str(V.block(1).label) == "loop" && V.block(1).numSuccs == 2);
+    assert(V.successor(V.block(1).firstSucc) == 3);
+    assert(V.str(V.arg(0).name) == "a0" && V.value(V.arg(0).value).flags == binary::kValueIsArg);
+
+    IRGraph h;
+    readBinary(V, h);
+    assert(sameText(g, h) && h.checkDataFlow() && h.valueIdBound() == g.valueIdBound());
+    assert(h.args()[0].val && h.args()[0].val->is_arg);
+    assert(h.getBlock("done")->predecessors.size() == 1);
+    auto bc = exec::lowerToBytecode(h);
+    for (uint32_t n = 0; n < 10; ++n)
+        assert(exec::interpret(bc, {n}) == referenceFactorial(n));
+    assert(writeBinary(h) == bytes);
+}
+
+void testBinaryKeepsBlockIds() {
+    const char *text = "u64 f(u32 a0):\n"
+                       "entry:\n"
+                       "    u32tou64    v1, a0\n"
+                       "    movi.u64    v2, 3\n"
+                       "    cmp.u64     v1, v2\n"
+                       "    ja          bb7\n"
+                       "bb3:\n"
+                       "    ret.u64     v2\n"
+                       "bb7:\n"
+                       "    ret.u64     v1\n";
+    IRGraph g;
+    parseText(text, g);
+    assert(g.getBlocks()[1]->id == 3 && g.getBlocks()[2]->id == 7);
+    std::vector<uint8_t> bytes = writeBinary(g);
+    BinaryView V(bytes.data(), bytes.size());
+    IRGraph h;
+    readBinary(V, h);
+    assert(h.toString() == g.toString() && h.checkDataFlow());
+    assert(h.getBlocks()[2]->id == 7 && h.blockIdBound() == g.blockIdBound());
+    // New blocks do not collide with the restored ids.
+    assert(h.createBlock()->id == 8);
+}
+
+void testBinaryMappedFile() {
+    std::mt19937_64 rng(21);
+    // Per process, so concurrent test runs do not share the file.
+    std::string name = "ir_binary_format_test." + std::to_string(getpid()) + ".irb";
+    std::string path = (std::filesystem::temp_directory_path() / name).string();
+    for (int iter = 0; iter < 40; ++iter) {
+        IRGraph g;
+        ProgramGen gen(g, rng);
+        gen.build(2 + iter % 8);
+        // Unlabeled blocks, new values and erased instructions.
+        if (iter % 2) {
+            opt::LoopUnroll unroll;
+            unroll.run(g);
+        }
+        writeBinaryFile(g, path);
+
+        MappedFile file(path);
+        BinaryView V = file.view();
+        IRGraph h;
+        readBinary(V, h);
+        assert(sameText(g, h) && h.checkDataFlow());
+        assert(writeBinary(h) == writeBinary(g));
+        checkSameResults(exec::lowerToBytecode(g), h, rng);
+    }
+    std::filesystem::remove(path);
+}
+
+void testBinaryRejectsMalformed() {
+    IRGraph g;
+    buildFactorial(g);
+    const std::vector<uint8_t> good = writeBinary(g);
+    auto load = [](std::vector<uint8_t> bytes) {
+        return throwsRuntimeError([&] {
+            BinaryView V(bytes.data(), bytes.size());
+            IRGraph h;
+            readBinary(V, h);
+        });
+    };
+    assert(!load(good));
+    assert(load(std::vector<uint8_t>(good.begin(), good.begin() + 40)));
+    assert(load(std::vector<uint8_t>(good.begin(), good.end() - 8)));
+
+    std::vector<uint8_t> bad = good;
+    bad[0] = 'X';
+    assert(load(bad));
+
+    binary::Header H;
+    std::memcpy(&H, good.data(), sizeof(H));
+    bad = good;
+    uint32_t far = 99;
+    std::memcpy(bad.data() + H.succsOff, &far, sizeof(far));
+    assert(load(bad));
+
+    bad = good;
+    binary::Inst I;
+    std::memcpy(&I, good.data() + H.instsOff, sizeof(I));
+    I.numOperands = 1000;
+    std::memcpy(bad.data() + H.instsOff, &I, sizeof(I));
+    assert(load(bad));
+
+    // The first two instructions are entry's movis: one without a result,
+    // then both defining the same value.
+    std::memcpy(&I, good.data() + H.instsOff, sizeof(I));
+    assert(static_cast<Opcode>(I.opcode) == Opcode::MOVI_U64);
+    uint32_t first = I.result;
+    I.result = binary::kNone;
+    bad = good;
+    std::memcpy(bad.data() + H.instsOff, &I, sizeof(I));
+    assert(load(bad));
+    std::memcpy(&I, good.data() + H.instsOff + sizeof(I), sizeof(I));
+    assert(static_cast<Opcode>(I.opcode) == Opcode::MOVI_U64);
+    I.result = first;
+    bad = good;
+    std::memcpy(bad.data() + H.instsOff + sizeof(I), &I, sizeof(I));
+    assert(load(bad));
+
+    // a0 no longer marked as an argument: its cast reads an undefined value.
+    binary::Arg A;
+    std::memcpy(&A, good.data() + H.argsOff, sizeof(A));
+    binary::Value R;
+    std::memcpy(&R, good.data() + H.valuesOff + A.value * sizeof(R), sizeof(R));
+    R.flags = 0;
+    bad = good;
+    std::memcpy(bad.data() + H.valuesOff + A.value * sizeof(R), &R, sizeof(R));
+    assert(load(bad));
+
+    bad = good;
+    binary::Block B;
+    std::memcpy(&B, good.data() + H.blocksOff + sizeof(B), sizeof(B));
+    B.id = 0;
+    std::memcpy(bad.data() + H.blocksOff + sizeof(B), &B, sizeof(B));
+    assert(load(bad));
+    B.id = ~0u;
+    std::memcpy(bad.data() + H.blocksOff + sizeof(B), &B, sizeof(B));
+    assert(load(bad));
+}
@@ -0,0 +1,191 @@
+#include "exec/interpreter.h"
+#include "graph_builders.h"
+#include "opt/dce.h"
+#include "opt/sccp.h"
+#include "program_gen.h"
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+using namespace ir;
+
+namespace {
+bool edgesConsistent(const IRGraph &g) {
+    for (auto *bb : g.getBlocks()) {
+        for (auto *s : bb->successors)
+            if (std::count(s->predecessors.begin(), s->predecessors.end(), bb) !=
+                std::count(bb->successors.begin(), bb->successors.end(), s))
+                return false;
+        for (auto *p : bb->predecessors)
+            if (std::find(p->successors.begin(), p->successors.end(), bb) == p->successors.end())
+                return false;
+    }
+    return true;
+}
+
+// A block without a jmp or ret falls through to the next one in layout.
+bool fallthroughsInLayout(const IRGraph &g) {
+    const auto &blocks = g.getBlocks();
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        const Inst *T = blocks[i]->insts.back();
+        if (T && (T->opcode() == Opcode::JMP || T->opcode() == Opcode::RET_U64))
+            continue;
+        const auto &succs = blocks[i]->successors;
+        if (i + 1 == blocks.size() || std::find(succs.begin(), succs.end(), blocks[i + 1]) == succs.end())
+            return false;
+    }
+    return true;
+}
+}
+
+void testDCEDeadValuesAndPhiCycles() {
+    IRGraph g;
+    buildFactorial(g);
+    auto *entry = g.getBlock("entry");
+    auto *loop = g.getBlock("loop");
+    auto *body = g.getBlock("body");
+    // A dead chain in the entry and a dead counter cycling through the loop.
+    SSAValue *d0 = g.createValue(), *d1 = g.createValue();
+    SSAValue *q = g.createValue(), *q2 = g.createValue();
+    entry->insertBefore(entry->insts.back(), g.createMovi(d0, 9));
+    entry->insertBefore(entry->insts.back(), g.createAddi(d1, d0, 1));
+    loop->insertBefore(loop->firstNonPhi(), g.createPhi(q, {{entry, d1}, {body, q2}}));
+    body->insertBefore(body->insts.back(), g.createAddi(q2, q, 3));
+    size_t before = g.numInsts();
+
+    opt::DCE dce;
+    assert(dce.run(g));
+    assert(dce.numInstsRemoved == 4 && g.numInsts() == before - 4);
+    assert(d0->users.empty() && q->users.empty() && q2->users.empty());
+    assert(g.checkDataFlow() && g.numBlocks() == 4);
+    auto bc = exec::lowerToBytecode(g);
+    for (uint32_t n = 0; n < 10; ++n)
+        assert(exec::interpret(bc, {n}) == referenceFactorial(n));
+    assert(!dce.run(g));
+}
+
+void testDCECfgSimplify() {
+    // entry -> a -> b -> join <- dead, where dead is unreachable and feeds
+    // join's phi; c sits between a and b in layout.
+    IRGraph g;
+    g.setSignature("u64", "chain", {{"u32", "a0"}});
+    auto *entry = g.createBlock("entry");
+    auto *a = g.createBlock("a");
+    auto *c = g.createBlock("c");
+    auto *b = g.createBlock("b");
+    auto *join = g.createBlock("join");
+    auto *dead = g.createBlock("dead");
+    SSAValue *a0 = g.createArg("u32", "a0");
+    SSAValue *w = g.createValue(), *x = g.createValue(), *y = g.createValue();
+    SSAValue *k = g.createValue(), *p = g.createValue(), *r = g.createValue(), *z = g.createValue();
+    entry->addInst(g.createCast(w, a0));
+    entry->addInst(g.createJmp(a));
+    entry->addSuccessor(a);
+    a->addInst(g.createAddi(x, w, 1));
+    a->addInst(g.createJmp(b));
+    a->addSuccessor(b);
+    c->addInst(g.createMovi(z, 0));
+    c->addInst(g.createRet(z));
+    b->addInst(g.createMul(y, x, x));
+    b->addInst(g.createJmp(join));
+    b->addSuccessor(join);
+    dead->addInst(g.createMovi(k, 5));
+    dead->addInst(g.createJmp(join));
+    dead->addSuccessor(join);
+    c->addSuccessor(dead);
+    join->addInst(g.createPhi(p, {{b, y}, {dead, k}}));
+    join->addInst(g.createAddi(r, p, 2));
+    join->addInst(g.createRet(r));
+
+    opt::DCE dce;
+    dce.run(g);
+    // c and dead are unreachable; a, b and join fold into entry.
+    assert(dce.numBlocksRemoved == 2 && dce.numBlocksMerged == 3);
+    assert(g.numBlocks() == 1 && g.entry() == entry && entry->successors.empty());
+    assert(!g.getBlock("dead") && !g.getBlock("join"));
+    assert(k->users.empty() && y->users.size() == 1);
+    assert(g.numInsts() == 5); // cast, addi, mul, addi, ret
+    assert(g.checkDataFlow() && edgesConsistent(g));
+    assert(exec::interpret(exec::lowerToBytecode(g), {6}) == 51);
+
+    // A jmp to the next block in layout goes; one to a later block stays.
+    IRGraph h;
+    h.setSignature("u64", "j", {{"u32", "a0"}});
+    auto *e = h.createBlock("entry");
+    auto *t = h.createBlock("t");
+    auto *f = h.createBlock("f");
+    auto *m = h.createBlock("m");
+    SSAValue *v = h.createArg("u32", "a0");
+    SSAValue *u = h.createValue(), *one = h.createValue(), *pt = h.createValue(), *pf = h.createValue();
+    SSAValue *pm = h.createValue();
+    e->addInst(h.createCast(u, v));
+    e->addInst(h.createMovi(one, 1));
+    e->addInst(h.createCmp(u, one));
+    e->addInst(h.createJa(f));
+    e->addSuccessor(t);
+    e->addSuccessor(f);
+    t->addInst(h.createAddi(pt, u, 10));
+    t->addInst(h.createJmp(m));
+    t->addSuccessor(m);
+    f->addInst(h.createAddi(pf, u, 20));
+    f->addInst(h.createJmp(m));
+    f->addSuccessor(m);
+    m->addInst(h.createPhi(pm, {{t, pt}, {f, pf}}));
+    m->addInst(h.createRet(pm));
+    opt::DCE jumps;
+    jumps.run(h);
+    assert(jumps.numJumpsRemoved == 1 && jumps.numBlocksMerged == 0);
+    assert(t->insts.back()->opcode() == Opcode::JMP && f->insts.back()->opcode() == Opcode::ADDI_U64);
+    auto bc = exec::lowerToBytecode(h);
+    assert(exec::interpret(bc, {0}) == 10 && exec::interpret(bc, {5}) == 25);
+
+    // x jumps to s further down, and s ends in a ja that falls through to
+    // u: folding s into x would leave x falling through to mid.
+    IRGraph l;
+    l.setSignature("u64", "late", {{"u32", "a0"}});
+    auto *le = l.createBlock("entry");
+    auto *lx = l.createBlock("x");
+    auto *lmid = l.createBlock("mid");
+    auto *ls = l.createBlock("s");
+    auto *lu = l.createBlock("u");
+    SSAValue *la = l.createArg("u32", "a0");
+    SSAValue *l1 = l.createValue(), *l2 = l.createValue(), *l3 = l.createValue();
+    le->addInst(l.createCast(l1, la));
+    le->addInst(l.createMovi(l2, 5));
+    le->addInst(l.createCmp(l1, l2));
+    le->addInst(l.createJa(lmid));
+    le->addSuccessor(lx);
+    le->addSuccessor(lmid);
+    lx->addInst(l.createJmp(ls));
+    lx->addSuccessor(ls);
+    lmid->addInst(l.createRet(l2));
+    ls->addInst(l.createAddi(l3, l1, 1));
+    ls->addInst(l.createCmp(l3, l2));
+    ls->addInst(l.createJa(lmid));
+    ls->addSuccessor(lu);
+    ls->addSuccessor(lmid);
+    lu->addInst(l.createRet(l3));
+    opt::DCE late;
+    late.run(l);
+    assert(late.numBlocksMerged == 0 && l.numBlocks() == 5);
+    assert(fallthroughsInLayout(l) && l.toString().find("; succs:") == std::string::npos);
+    bc = exec::lowerToBytecode(l);
+    assert(exec::interpret(bc, {2}) == 3 && exec::interpret(bc, {4}) == 5 && exec::interpret(bc, {7}) == 5);
+}
+
+void testDCERandomPrograms() {
+    size_t removed = checkPassOnRandomPrograms(16, 80, [](IRGraph &g, int iter) {
+        size_t instsBefore = g.numInsts();
+        if (iter % 2) {
+            opt::SCCP sccp;
+            sccp.run(g);
+        }
+        opt::DCE dce;
+        dce.run(g);
+        assert(edgesConsistent(g) && g.numInsts() <= instsBefore);
+        opt::DCE again;
+        assert(!again.run(g));
+        return instsBefore - g.numInsts();
+    });
+    assert(removed > 0);
+}
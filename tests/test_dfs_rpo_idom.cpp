@@ -24,9 +24,8 @@ void expectIdoms(const DominatorTree &DT, const BuiltCFG &W,
     for (auto &[n, p] : exp) {
         BasicBlock *b = W.byName.at(n);
         BasicBlock *ip = p.empty() ? nullptr : W.byName.at(p);
-        auto it = DT.idom_map.find(b);
-        assert(it != DT.idom_map.end());
-        assert(it->second == ip && "idom mismatch");
+        assert(DT.isReachable(b));
+        assert(DT.idom_map[b] == ip && "idom mismatch");
     }
 }
 
@@ -197,4 +196,91 @@ void testExample3() {
                            {"H", "F"},
                            {"I", "B"}, 
                        });
-}
\ No newline at end of file
+}
+
+void testDeepChainTraversals() {
+    const size_t N = 200000;
+    BuiltCFG W;
+    std::vector<BasicBlock *> chain;
+    chain.reserve(N);
+    for (size_t i = 0; i < N; ++i) {
+        chain.push_back(W.g.createBlock());
+        if (i > 0)
+            EDGE(chain[i - 1], chain[i]);
+    }
+    EDGE(chain.back(), chain[1]);
+    W.entry = chain.front();
+
+    DFS dfs;
+    dfs.run(W.entry);
+    assert(dfs.preorder == chain);
+
+    RPO rpo;
+    rpo.run(W.entry);
+    assert(rpo.rpo == chain);
+
+    DominatorTree DT;
+    DT.build(W.entry);
+    assert(DT.idom(chain[0]) == nullptr);
+    for (size_t i = 1; i < N; ++i)
+        assert(DT.idom(chain[i]) == chain[i - 1]);
+
+    LoopAnalyzer LA;
+    LA.run(W.entry);
+    assert(LA.loops.size() == 1);
+    assert(LA.loops[0]->header == chain[1]);
+    assert(LA.loops[0]->blocks.size() == N - 1);
+    assert(LA.backEdges.size() == 1 && LA.backEdges[0].first == chain.back());
+}
+
+
+static bool naiveDominates(const DominatorTree &DT, BasicBlock *a, BasicBlock *b) {
+    for (auto *cur = b; cur; cur = DT.idom(cur))
+        if (cur == a)
+            return true;
+    return false;
+}
+
+static BasicBlock *naiveNCD(const DominatorTree &DT, BasicBlock *a, BasicBlock *b) {
+    for (auto *x = a; x; x = DT.idom(x))
+        if (naiveDominates(DT, x, b))
+            return x;
+    return nullptr;
+}
+
+void checkDominanceQueries(const DominatorTree &DT, const std::vector<BasicBlock *> &blocks) {
+    for (auto *a : blocks) {
+        for (auto *b : blocks) {
+            if (!DT.isReachable(a) || !DT.isReachable(b))
+                continue;
+            assert(DT.dominates(a, b) == naiveDominates(DT, a, b));
+            assert(DT.properlyDominates(a, b) == (a != b && naiveDominates(DT, a, b)));
+            assert(DT.findNearestCommonDominator(a, b) == naiveNCD(DT, a, b));
+        }
+    }
+}
+
+void testDominanceQueries() {
+    for (auto build : {buildExample1, buildExample2, buildExample3}) {
+        auto W = build();
+        DominatorTree DT;
+        DT.build(W.entry);
+        std::vector<BasicBlock *> all;
+        for (auto &[name, b] : W.byName)
+            all.push_back(b);
+        checkDominanceQueries(DT, all);
+    }
+
+    auto W = buildExample2();
+    DominatorTree DT;
+    DT.build(W.entry);
+    auto *B = W.byName["B"], *H = W.byName["H"], *K = W.byName["K"], *J = W.byName["J"];
+    assert(DT.dominates(B, K) && !DT.dominates(K, B) && DT.dominates(K, K));
+    assert(!DT.properlyDominates(K, K));
+    assert(DT.findNearestCommonDominator(H, K) == W.byName["G"]);
+    assert(DT.findNearestCommonDominator(J, K) == B);
+
+    auto *U = W.g.createBlock("U");
+    assert(!DT.isReachable(U) && DT.dominates(K, U) && !DT.dominates(U, K));
+    assert(DT.findNearestCommonDominator(U, K) == nullptr);
+}
@@ -0,0 +1,143 @@
+#include "analysis/analysis_manager.h"
+#include "graph_builders.h"
+#include <cassert>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace ir;
+using namespace analysis;
+
+void checkDominanceQueries(const DominatorTree &DT, const std::vector<BasicBlock *> &blocks);
+
+namespace {
+struct RandomCFG {
+    BuiltCFG W;
+    std::vector<BasicBlock *> bbs;
+    std::vector<std::pair<BasicBlock *, BasicBlock *>> edges;
+
+    RandomCFG(std::mt19937 &rng, size_t n, size_t m) {
+        for (size_t i = 0; i < n; ++i)
+            bbs.push_back(BB(W, "b" + std::to_string(i)));
+        W.entry = bbs[0];
+        for (size_t i = 0; i < m; ++i)
+            insertRandom(rng);
+    }
+    std::pair<BasicBlock *, BasicBlock *> insertRandom(std::mt19937 &rng) {
+        std::uniform_int_distribution<size_t> pick(0, bbs.size() - 1);
+        auto e = std::make_pair(bbs[pick(rng)], bbs[pick(rng)]);
+        EDGE(e.first, e.second);
+        edges.push_back(e);
+        return e;
+    }
+    std::pair<BasicBlock *, BasicBlock *> deleteRandom(std::mt19937 &rng) {
+        std::uniform_int_distribution<size_t> pick(0, edges.size() - 1);
+        size_t i = pick(rng);
+        auto e = edges[i];
+        edges.erase(edges.begin() + i);
+        e.first->removeSuccessor(e.second);
+        return e;
+    }
+};
+}
+
+void testDomTreeIncrementalSingle() {
+    for (unsigned seed = 1; seed <= 20; ++seed) {
+        std::mt19937 rng(seed);
+        RandomCFG G(rng, 24, 30);
+        DominatorTree DT;
+        DT.verifyUpdates = true;
+        DT.build(G.W.entry);
+        for (int step = 0; step < 150; ++step) {
+            bool del = !G.edges.empty() && rng() % 2;
+            if (del) {
+                auto [u, v] = G.deleteRandom(rng);
+                DT.deleteEdge(u, v);
+            } else {
+                auto [u, v] = G.insertRandom(rng);
+                DT.insertEdge(u, v);
+            }
+            assert(DT.verify());
+            if (step % 25 == 0)
+                checkDominanceQueries(DT, G.bbs);
+        }
+    }
+}
+
+void testDomTreeIncrementalBatch() {
+    using U = DominatorTree::Update;
+    for (unsigned seed = 100; seed < 120; ++seed) {
+        std::mt19937 rng(seed);
+        RandomCFG G(rng, 40, 55);
+        AnalysisManager AM(G.W.g);
+        AM.getDomTree();
+        for (int round = 0; round < 40; ++round) {
+            uint64_t before = G.W.g.cfgEpoch();
+            std::vector<U> batch;
+            for (int k = 0; k < 6; ++k) {
+                if (!G.edges.empty() && rng() % 2) {
+                    auto [u, v] = G.deleteRandom(rng);
+                    batch.push_back({U::Delete, u, v});
+                } else {
+                    auto [u, v] = G.insertRandom(rng);
+                    batch.push_back({U::Insert, u, v});
+                }
+            }
+            AM.applyDomTreeUpdates(batch, before);
+            assert(AM.isCached(AnalysisManager::DOM_TREE));
+            assert(AM.getDomTree().verify());
+        }
+        assert(AM.timesComputed(AnalysisManager::DOM_TREE) == 1);
+    }
+}
+
+void testDomTreeDeleteMakesUnreachable() {
+    BuiltCFG W;
+    auto *A = BB(W, "A");
+    auto *B = BB(W, "B");
+    auto *C = BB(W, "C");
+    auto *D = BB(W, "D");
+    auto *E = BB(W, "E");
+    EDGE(A, B);
+    EDGE(A, C);
+    EDGE(B, D);
+    EDGE(C, D);
+    EDGE(D, E);
+    EDGE(E, B);
+    DominatorTree DT;
+    DT.verifyUpdates = true;
+    DT.build(A);
+    assert(DT.idom(D) == A && DT.idom(B) == A);
+
+    A->removeSuccessor(C);
+    DT.deleteEdge(A, C);
+    assert(!DT.isReachable(C));
+    assert(DT.idom(D) == B && DT.idom(E) == D && DT.level(E) == 4);
+
+    A->addSuccessor(C);
+    DT.insertEdge(A, C);
+    assert(DT.isReachable(C) && DT.idom(C) == A && DT.idom(D) == A);
+    assert(DT.idom(B) == A && DT.idom(E) == D);
+}
+
+void testDomTreeVerifyUpdatesThrows() {
+    BuiltCFG W;
+    auto *A = BB(W, "A");
+    auto *B = BB(W, "B");
+    auto *C = BB(W, "C");
+    EDGE(A, B);
+    EDGE(B, C);
+    DominatorTree DT;
+    DT.verifyUpdates = true;
+    DT.build(A);
+
+    // Reporting an edge the CFG does not have makes the repaired tree
+    // disagree with a fresh build; verification has to catch that.
+    bool threw = false;
+    try {
+        DT.insertEdge(A, C);
+    } catch (const std::runtime_error &) {
+        threw = true;
+    }
+    assert(threw);
+}
@@ -0,0 +1,145 @@
+#include "analysis/dominance_frontier.h"
+#include "graph_builders.h"
+#include <cassert>
+#include <random>
+#include <set>
+#include <string>
+
+using namespace ir;
+using namespace analysis;
+
+static std::set<std::string> names(const std::vector<BasicBlock *> &v) {
+    std::set<std::string> s;
+    for (auto *b : v)
+        s.insert(b->label);
+    return s;
+}
+
+void testDominanceFrontierExamples() {
+    BuiltCFG W;
+    auto *A = BB(W, "A");
+    auto *B = BB(W, "B");
+    auto *C = BB(W, "C");
+    auto *E = BB(W, "E");
+    auto *F = BB(W, "F");
+    auto *D = BB(W, "D");
+    auto *G = BB(W, "G");
+    EDGE(A, B);
+    EDGE(B, C);
+    EDGE(B, F);
+    EDGE(C, E);
+    EDGE(C, D);
+    EDGE(F, E);
+    EDGE(F, G);
+    EDGE(E, D);
+    EDGE(G, D);
+
+    DominatorTree DT;
+    DT.build(A);
+    DominanceFrontier DF;
+    DF.run(DT);
+    assert(DF.of(A).empty() && DF.of(B).empty() && DF.of(D).empty());
+    assert((names(DF.of(C)) == std::set<std::string>{"D", "E"}));
+    assert((names(DF.of(F)) == std::set<std::string>{"D", "E"}));
+    assert((names(DF.of(E)) == std::set<std::string>{"D"}));
+    assert((names(DF.of(G)) == std::set<std::string>{"D"}));
+
+    assert((names(DF.iterated({C})) == std::set<std::string>{"D", "E"}));
+    assert((names(DF.iterated({G})) == std::set<std::string>{"D"}));
+    assert(DF.iterated({A, B}).empty());
+
+    BitVector liveIn(DF.idBound());
+    liveIn.set(D->id);
+    assert((names(DF.iterated({C, F}, &liveIn)) == std::set<std::string>{"D"}));
+
+    BuiltCFG L;
+    auto *S = BB(L, "S");
+    auto *H = BB(L, "H");
+    auto *M = BB(L, "M");
+    auto *Z = BB(L, "Z");
+    auto *X = BB(L, "X");
+    EDGE(S, H);
+    EDGE(H, M);
+    EDGE(M, Z);
+    EDGE(Z, H);
+    EDGE(H, X);
+    DominatorTree LDT;
+    LDT.build(S);
+    DominanceFrontier LDF;
+    LDF.run(LDT);
+    assert((names(LDF.of(H)) == std::set<std::string>{"H"}));
+    assert((names(LDF.of(M)) == std::set<std::string>{"H"}));
+    assert((names(LDF.iterated({Z})) == std::set<std::string>{"H"}));
+    assert(LDF.of(X).empty());
+}
+
+void testDominanceFrontierRandom() {
+    for (unsigned seed = 7; seed < 40; ++seed) {
+        std::mt19937 rng(seed);
+        BuiltCFG W;
+        std::vector<BasicBlock *> bbs;
+        size_t n = 10 + seed % 20;
+        for (size_t i = 0; i < n; ++i)
+            bbs.push_back(BB(W, std::to_string(i)));
+        for (size_t i = 0; i < n * 2; ++i)
+            EDGE(bbs[rng() % n], bbs[rng() % n]);
+        DominatorTree DT;
+        DT.build(bbs[0]);
+        DominanceFrontier DF;
+        DF.run(DT);
+
+        for (auto *x : bbs) {
+            if (!DT.isReachable(x))
+                continue;
+            std::set<BasicBlock *> expect;
+            for (auto *y : bbs) {
+                if (!DT.isReachable(y) || DT.properlyDominates(x, y))
+                    continue;
+                for (auto *p : y->predecessors)
+                    if (DT.isReachable(p) && DT.dominates(x, p))
+                        expect.insert(y);
+            }
+            auto &got = DF.of(x);
+            assert(std::set<BasicBlock *>(got.begin(), got.end()) == expect);
+            assert(got.size() == expect.size());
+        }
+
+        std::vector<BasicBlock *> defs = {bbs[rng() % n], bbs[rng() % n]};
+        std::set<BasicBlock *> idf, frontierOf(defs.begin(), defs.end());
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (auto *x : std::set<BasicBlock *>(frontierOf)) {
+                if (!DT.isReachable(x))
+                    continue;
+                for (auto *y : DF.of(x)) {
+                    changed |= idf.insert(y).second;
+                    changed |= frontierOf.insert(y).second;
+                }
+            }
+        }
+        auto got = DF.iterated(defs);
+        assert(std::set<BasicBlock *>(got.begin(), got.end()) == idf);
+    }
+}
+
+void testBitVectorBasics() {
+    BitVector a(130), b(130);
+    a.set(0);
+    a.set(64);
+    a.set(129);
+    b.set(64);
+    b.set(100);
+    assert(a.test(129) && !a.test(128) && !a.test(1000));
+    assert(a.count() == 3);
+    assert(a.unionWith(b) && !a.unionWith(b));
+    assert(a.count() == 4);
+    a.subtract(b);
+    std::vector<size_t> bits;
+    a.forEach([&](size_t i) { bits.push_back(i); });
+    assert((bits == std::vector<size_t>{0, 129}));
+    a.reset(0);
+    a.resize(100);
+    assert(!a.any() && a.size() == 100);
+    a.clear();
+    assert(a == BitVector(100));
+}
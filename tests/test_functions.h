@@ -3,6 +3,17 @@
 void testExample1();
 void testExample2();
 void testExample3();
+void testDeepChainTraversals();
+void testDominanceQueries();
+
+void testDomTreeIncrementalSingle();
+void testDomTreeIncrementalBatch();
+void testDomTreeDeleteMakesUnreachable();
+void testDomTreeVerifyUpdatesThrows();
+
+void testBitVectorBasics();
+void testDominanceFrontierExamples();
+void testDominanceFrontierRandom();
 
 void test1();
 void test2();
@@ -11,3 +22,82 @@ void test3();
 void testLoopsExample1();
 void testLoopsExample2();
 void testLoopsExample3();
+void testLoopsDeepNesting();
+void testAnalysisManagerCaching();
+
+void testArenaAllocation();
+void testArenaOwnsGraph();
+void testArenaChunkCache();
+
+void testInstListEditing();
+void testOperandAccess();
+void testDenseIdMaps();
+
+void testSSABuilderFactorial();
+void testSSABuilderDiamond();
+void testSSABuilderNestedLoopsAndChains();
+
+void testParallelMoves();
+void testInterpreterFactorial();
+void testInterpreterPhiCycles();
+
+void testX86Encoding();
+void testJitFactorial();
+void testJitPhiCycles();
+void testJitDifferential();
+
+void testLinearScanLoopOrder();
+void testLinearScanFactorial();
+void testLinearScanRandomPrograms();
+
+void testLivenessFactorial();
+void testLivenessIrreducible();
+void testLivenessRandomPrograms();
+
+void testSCCPDiamond();
+void testSCCPLoops();
+void testSCCPRandomPrograms();
+
+void testDCEDeadValuesAndPhiCycles();
+void testDCECfgSimplify();
+void testDCERandomPrograms();
+
+void testInstStructuralHash();
+void testGVNScopes();
+void testGVNRandomPrograms();
+
+void testLICMHoistsInvariants();
+void testLICMPreheaderInsertion();
+void testLICMSkipsIrreducible();
+void testLICMRandomPrograms();
+
+void testInductionVarsFactorial();
+void testInductionVarsTripCounts();
+void testStrengthReduction();
+void testStrengthReductionRandomPrograms();
+
+void testLoopUnrollFactorial();
+void testLoopUnrollCountedLoops();
+void testLoopUnrollRandomPrograms();
+
+void testBinaryRoundTrip();
+void testBinaryKeepsBlockIds();
+void testBinaryMappedFile();
+void testBinaryRejectsMalformed();
+
+void testTextRoundTrip();
+void testTextParserHandWritten();
+void testTextParserRandomPrograms();
+void testTextParserErrors();
+
+void testUniqueBlockNames();
+void testStreamingPrinter();
+
+void testPassManagerPipeline();
+void testPassManagerRandomPrograms();
+void testPassManagerReportAndErrors();
+
+void testWorkStealingPool();
+void testModuleText();
+void testParallelDriverDeterminism();
+void testParallelDriverReleaseAndErrors();
@@ -0,0 +1,104 @@
+#include "exec/interpreter.h"
+#include "opt/gvn.h"
+#include "program_gen.h"
+#include <cassert>
+
+using namespace ir;
+
+void testInstStructuralHash() {
+    IRGraph g;
+    auto *bb = g.createBlock("entry");
+    SSAValue *a = g.createValue(), *b = g.createValue();
+    SSAValue *r[8];
+    for (auto *&v : r)
+        v = g.createValue();
+    Inst *m1 = g.createMul(r[0], a, b), *m2 = g.createMul(r[1], b, a), *m3 = g.createMul(r[2], a, a);
+    Inst *i1 = g.createAddi(r[3], a, 4), *i2 = g.createAddi(r[4], a, 4), *i3 = g.createAddi(r[5], a, 5);
+    Inst *c1 = g.createMovi(r[6], 7), *c2 = g.createMovi(r[7], 7);
+    for (Inst *I : {m1, m2, m3, i1, i2, i3, c1, c2})
+        bb->addInst(I);
+    assert(m1->isIdenticalTo(m2) && m1->hash() == m2->hash());
+    assert(!m1->isIdenticalTo(m3));
+    assert(i1->isIdenticalTo(i2) && i1->hash() == i2->hash() && !i1->isIdenticalTo(i3));
+    assert(c1->isIdenticalTo(c2) && c1->hash() == c2->hash() && !c1->isIdenticalTo(i1));
+
+    // Phis match on their incoming edges regardless of order.
+    auto *p = g.createBlock("p"), *q = g.createBlock("q"), *j = g.createBlock("j");
+    SSAValue *x = g.createValue(), *y = g.createValue(), *z = g.createValue();
+    auto *phi1 = g.createPhi(x, {{p, a}, {q, b}});
+    auto *phi2 = g.createPhi(y, {{q, b}, {p, a}});
+    auto *phi3 = g.createPhi(z, {{p, b}, {q, a}});
+    for (Inst *I : {static_cast<Inst *>(phi1), static_cast<Inst *>(phi2), static_cast<Inst *>(phi3)})
+        j->addInst(I);
+    assert(phi1->isIdenticalTo(phi2) && phi1->hash() == phi2->hash());
+    assert(!phi1->isIdenticalTo(phi3));
+}
+
+void testGVNScopes() {
+    // entry: w = cast a0; m = w*w; branch
+    // then:  m2 = w*w (redundant); n = m2+1
+    // else:  n2 = m+1 (redundant only with a dominating copy: none)
+    // join:  two identical phis and a redundant movi
+    IRGraph g;
+    g.setSignature("u64", "s", {{"u32", "a0"}});
+    auto *entry = g.createBlock("entry");
+    auto *thenB = g.createBlock("then");
+    auto *elseB = g.createBlock("else");
+    auto *join = g.createBlock("join");
+    SSAValue *a0 = g.createArg("u32", "a0");
+    SSAValue *w = g.createValue(), *w2 = g.createValue(), *m = g.createValue(), *k = g.createValue();
+    SSAValue *m2 = g.createValue(), *n = g.createValue(), *n2 = g.createValue();
+    SSAValue *p1 = g.createValue(), *p2 = g.createValue(), *k2 = g.createValue();
+    SSAValue *s = g.createValue(), *s2 = g.createValue(), *t = g.createValue();
+    entry->addInst(g.createCast(w, a0));
+    entry->addInst(g.createCast(w2, a0));
+    entry->addInst(g.createMul(m, w, w2));
+    entry->addInst(g.createMovi(k, 3));
+    entry->addInst(g.createCmp(w, k));
+    entry->addInst(g.createJa(thenB));
+    entry->addSuccessor(elseB);
+    entry->addSuccessor(thenB);
+    thenB->addInst(g.createMul(m2, w2, w));
+    thenB->addInst(g.createAddi(n, m2, 1));
+    thenB->addInst(g.createJmp(join));
+    thenB->addSuccessor(join);
+    elseB->addInst(g.createAddi(n2, m, 1));
+    elseB->addInst(g.createJmp(join));
+    elseB->addSuccessor(join);
+    join->addInst(g.createPhi(p1, {{thenB, n}, {elseB, n2}}));
+    join->addInst(g.createPhi(p2, {{elseB, n2}, {thenB, n}}));
+    join->addInst(g.createMovi(k2, 3));
+    join->addInst(g.createMul(s, p1, k2));
+    join->addInst(g.createMul(s2, p2, k));
+    join->addInst(g.createMul(t, s, s2));
+    join->addInst(g.createRet(t));
+    auto before = exec::lowerToBytecode(g);
+
+    opt::GVN gvn;
+    assert(gvn.run(g));
+    // w2, m2, k2, s2 go; n and n2 stay (neither dominates the other), which
+    // leaves p2 a copy of p1.
+    assert(gvn.numReplaced == 4 && gvn.numPhisReplaced == 1);
+    assert(!w2->def->parent() && !m2->def->parent() && !k2->def->parent() && !s2->def->parent());
+    assert(n->def->parent() == thenB && n2->def->parent() == elseB);
+    auto *T = static_cast<MulInst *>(t->def);
+    assert(T->left() == s && T->right() == s);
+    auto *N = static_cast<AddiInst *>(n->def);
+    assert(N->src() == m);
+    assert(g.checkDataFlow());
+    auto after = exec::lowerToBytecode(g);
+    for (uint64_t a : {0, 2, 3, 4, 9})
+        assert(exec::interpret(after, {a}) == exec::interpret(before, {a}));
+    assert(!gvn.run(g));
+}
+
+void testGVNRandomPrograms() {
+    size_t replaced = checkPassOnRandomPrograms(17, 80, [](IRGraph &g, int) {
+        opt::GVN gvn;
+        gvn.run(g);
+        opt::GVN again;
+        assert(!again.run(g));
+        return gvn.numReplaced + gvn.numPhisReplaced;
+    });
+    assert(replaced > 0);
+}
@@ -0,0 +1,33 @@
+#include "graph_builders.h"
+#include "ir/id_map.h"
+#include <cassert>
+
+using namespace ir;
+
+void testDenseIdMaps() {
+    BuiltCFG W;
+    auto *A = BB(W, "A");
+    auto *B = BB(W, "B");
+    auto *C = BB(W, "C");
+    assert(A->id == 0 && B->id == 1 && C->id == 2);
+    assert(W.g.blockIdBound() == 3);
+
+    BlockMap<int> num(W.g.blockIdBound(), -1);
+    num[C] = 7;
+    assert(num[A] == -1 && num.get(C) == 7);
+
+    BlockMap<bool> seen;
+    assert(!seen.get(B) && seen.size() == 0);
+    seen[B] = true;
+    assert(seen[B] && !seen[A] && seen.size() == 2);
+
+    SSAValue *x = W.g.createValue();
+    SSAValue *y = W.g.createValue();
+    assert(y->id == x->id + 1 && W.g.valueIdBound() == 2);
+    ValueMap<SSAValue *> repl;
+    repl[y] = x;
+    assert(repl.get(x) == nullptr && repl[y] == x);
+
+    const BlockMap<std::vector<BasicBlock *>> empty;
+    assert(empty.get(A).empty() && empty.size() == 0);
+}
@@ -0,0 +1,136 @@
+#include "analysis/induction_vars.h"
+#include "codegen/x86_64_jit.h"
+#include "exec/interpreter.h"
+#include "graph_builders.h"
+#include "opt/strength_reduce.h"
+#include "program_gen.h"
+#include <cassert>
+#include <limits>
+
+using namespace ir;
+
+void testInductionVarsFactorial() {
+    IRGraph g;
+    buildFactorial(g);
+    analysis::LoopAnalyzer LA;
+    LA.run(g.entry());
+    analysis::InductionVars IV;
+    IV.run(LA);
+    const analysis::Loop *L = LA.loops[0].get();
+    auto *loop = g.getBlock("loop");
+    auto *body = g.getBlock("body");
+    auto *P0 = static_cast<PhiInst *>(loop->insts.front());
+    auto *P1 = static_cast<PhiInst *>(P0->next());
+    const analysis::LoopIVs *info = IV.loopInfo(L);
+    // p1 counts; p0 is a running product.
+    assert(info && info->basics.size() == 1 && info->basics[0].phi == P1 && info->basics[0].step == 1);
+    assert(!IV.ivOf(P0->result()).loop);
+    SSAValue *n = static_cast<AddiInst *>(body->insts.front()->next())->result();
+    auto form = IV.ivOf(n);
+    assert(form.loop == L && form.base == P1->result() && form.scale == 1 && form.offset == 1);
+    // Loops while p1 <= a0, which is not a constant.
+    assert(info->exitTest && info->exitTest->exiting == loop && info->exitTest->exit == g.getBlock("done"));
+    assert(info->exitTest->iv == P1->result() && info->exitTest->inclusive);
+    assert(!IV.tripCount(L));
+
+    // The do-while swap loop tests the incremented counter against n.
+    IRGraph h;
+    buildSwapLoop(h, true);
+    analysis::LoopAnalyzer LB;
+    LB.run(h.entry());
+    IV.run(LB);
+    info = IV.loopInfo(LB.loops[0].get());
+    assert(info->basics.size() == 1 && info->exitTest && !info->exitTest->inclusive);
+    auto test = *info->exitTest;
+    assert(IV.ivOf(test.iv).offset == 1 && test.bound == h.args()[0].val->users.front()->result());
+}
+
+void testInductionVarsTripCounts() {
+    for (bool inclusive : {true, false})
+        for (uint64_t step = 1; step <= 4; ++step)
+            for (uint64_t start = 0; start <= 5; ++start)
+                for (uint64_t bound = 0; bound <= 12; ++bound) {
+                    IRGraph g;
+                    buildCountedLoop(g, start, bound, step, inclusive);
+                    analysis::LoopAnalyzer LA;
+                    LA.run(g.entry());
+                    analysis::InductionVars IV;
+                    IV.run(LA);
+                    auto trips = IV.tripCount(LA.loops[0].get());
+                    assert(trips && *trips == exec::interpret(exec::lowerToBytecode(g), {}));
+                }
+    // A counter that could wrap past the bound has no trip count.
+    uint64_t max = std::numeric_limits<uint64_t>::max();
+    for (bool inclusive : {true, false}) {
+        IRGraph g;
+        buildCountedLoop(g, 0, max - 1, 4, inclusive);
+        analysis::LoopAnalyzer LA;
+        LA.run(g.entry());
+        analysis::InductionVars IV;
+        IV.run(LA);
+        assert(IV.loopInfo(LA.loops[0].get())->exitTest && !IV.tripCount(LA.loops[0].get()));
+    }
+}
+
+void testStrengthReduction() {
+    // fact with the product taken over w = 3 * (3 * p1 + 5) instead of p1.
+    IRGraph g;
+    buildFactorial(g);
+    auto *entry = g.getBlock("entry");
+    auto *loop = g.getBlock("loop");
+    auto *body = g.getBlock("body");
+    SSAValue *p1 = static_cast<PhiInst *>(loop->insts.front()->next())->result();
+    SSAValue *k = g.createValue(), *t = g.createValue(), *u = g.createValue(), *w = g.createValue();
+    entry->addInst(g.createMovi(k, 3));
+    Inst *M = body->insts.front();
+    body->insertBefore(M, g.createMul(t, p1, k));
+    body->insertBefore(M, g.createAddi(u, t, 5));
+    body->insertBefore(M, g.createMul(w, u, k));
+    M->replaceUsesOfWith(p1, w);
+    auto reference = [](uint32_t n) {
+        uint64_t r = 1;
+        for (uint64_t i = 2; i <= n; ++i)
+            r *= 3 * (3 * i + 5);
+        return r;
+    };
+
+    opt::StrengthReduction sr;
+    assert(sr.run(g));
+    assert(sr.numReduced == 2 && sr.numPreheadersInserted == 0 && g.numBlocks() == 4);
+    assert(countOpcode({loop, body}, Opcode::MUL_U64) == 1);
+    assert(countOpcode({loop}, Opcode::PHI_U64) == 4);
+    auto *W = static_cast<PhiInst *>(static_cast<MulInst *>(M)->right()->def);
+    assert(W->opcode() == Opcode::PHI_U64 && W->parent() == loop);
+    auto *start = static_cast<MoviInst *>(W->incomingFor(entry)->def);
+    assert(start->imm() == 3 * (3 * 2 + 5) && start->parent() == entry);
+    auto *next = static_cast<AddiInst *>(W->incomingFor(body)->def);
+    assert(next->src() == W->result() && next->imm() == 9);
+    assert(g.checkDataFlow());
+    auto bc = exec::lowerToBytecode(g);
+    auto native = codegen::x86_64::compileX86_64(g);
+    for (uint32_t n = 0; n < 12; ++n)
+        assert(exec::interpret(bc, {n}) == reference(n) && native.call({n}) == reference(n));
+    assert(!sr.run(g));
+}
+
+void testStrengthReductionRandomPrograms() {
+    size_t reduced = checkPassOnRandomPrograms(
+        19, 80,
+        [](IRGraph &g, int) {
+            {
+                analysis::LoopAnalyzer LA;
+                LA.run(g.entry());
+                analysis::InductionVars IV;
+                IV.run(LA);
+                for (auto &L : LA.loops)
+                    assert(IV.loopInfo(L.get())->exitTest && IV.tripCount(L.get()));
+            }
+            opt::StrengthReduction sr;
+            sr.run(g);
+            opt::StrengthReduction again;
+            assert(!again.run(g));
+            return sr.numReduced;
+        },
+        [](ProgramGen &gen, int) { gen.ivExprs = true; });
+    assert(reduced > 0);
+}
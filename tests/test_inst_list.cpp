@@ -0,0 +1,54 @@
+#include "graph_builders.h"
+#include <cassert>
+#include <vector>
+
+using namespace ir;
+
+static std::vector<Inst *> collect(BasicBlock *bb) {
+    std::vector<Inst *> out;
+    for (Inst *I : bb->insts) {
+        assert(I->parent() == bb);
+        out.push_back(I);
+    }
+    std::vector<Inst *> back;
+    for (Inst *I = bb->insts.back(); I; I = I->prev())
+        back.insert(back.begin(), I);
+    assert(out == back && out.size() == bb->insts.size());
+    return out;
+}
+
+void testInstListEditing() {
+    BuiltCFG W;
+    auto *A = BB(W, "A");
+    auto *B = BB(W, "B");
+    SSAValue *v[4];
+    Inst *m[4];
+    for (int i = 0; i < 4; ++i) {
+        v[i] = W.g.createValue();
+        m[i] = W.g.createMovi(v[i], i);
+    }
+
+    A->addInst(m[1]);
+    A->insertBefore(m[1], m[0]);
+    A->insertAfter(m[1], m[3]);
+    A->insertBefore(m[3], m[2]);
+    assert((collect(A) == std::vector<Inst *>{m[0], m[1], m[2], m[3]}));
+
+    m[0]->moveAfter(m[3]);
+    assert((collect(A) == std::vector<Inst *>{m[1], m[2], m[3], m[0]}));
+    m[0]->moveBefore(m[1]);
+    assert((collect(A) == std::vector<Inst *>{m[0], m[1], m[2], m[3]}));
+
+    m[2]->removeFromParent();
+    assert(m[2]->parent() == nullptr && !m[2]->next() && !m[2]->prev());
+    assert((collect(A) == std::vector<Inst *>{m[0], m[1], m[3]}));
+
+    B->addInst(m[2]);
+    B->splice(m[2], A, m[1]);
+    assert((collect(A) == std::vector<Inst *>{m[0]}));
+    assert((collect(B) == std::vector<Inst *>{m[1], m[3], m[2]}));
+
+    m[0]->moveToEnd(B);
+    assert(A->insts.empty() && !A->insts.front() && !A->insts.back());
+    assert((collect(B) == std::vector<Inst *>{m[1], m[3], m[2], m[0]}));
+}
@@ -0,0 +1,96 @@
+#include "codegen/parallel_move.h"
+#include "exec/interpreter.h"
+#include "graph_builders.h"
+#include <algorithm>
+#include <cassert>
+#include <random>
+#include <vector>
+
+using namespace ir;
+using namespace exec;
+
+static bool containsOp(const BytecodeFunction &fn, BcOp op) {
+    for (size_t pc = 0; pc < fn.code.size(); pc += bcLength(static_cast<BcOp>(fn.code[pc])))
+        if (static_cast<BcOp>(fn.code[pc]) == op)
+            return true;
+    return false;
+}
+
+void testParallelMoves() {
+    std::mt19937 rng(3);
+    for (int iter = 0; iter < 2000; ++iter) {
+        const uint32_t nloc = 6, scratch = nloc;
+        std::vector<uint32_t> dsts(nloc);
+        for (uint32_t i = 0; i < nloc; ++i)
+            dsts[i] = i;
+        std::shuffle(dsts.begin(), dsts.end(), rng);
+        std::vector<codegen::Move> moves;
+        for (uint32_t i = 0; i < rng() % (nloc + 1); ++i)
+            moves.push_back({dsts[i], uint32_t(rng() % nloc)});
+
+        std::vector<uint64_t> loc(nloc + 1);
+        for (uint32_t i = 0; i < nloc; ++i)
+            loc[i] = 100 + i;
+        std::vector<uint64_t> expect = loc;
+        for (auto &m : moves)
+            expect[m.dst] = loc[m.src];
+        auto seq = codegen::sequentializeMoves(moves, scratch);
+        for (auto &m : seq)
+            loc[m.dst] = loc[m.src];
+        loc[scratch] = expect[scratch];
+        assert(loc == expect);
+    }
+    auto swap = codegen::sequentializeMoves({{0, 1}, {1, 0}}, 9);
+    assert(swap.size() == 3 && swap.front().dst == 9);
+    assert(codegen::sequentializeMoves({{2, 2}}, 9).empty());
+
+    // A long chain (i+1 <- i, listed front to back) closed into a cycle;
+    // ordering it is linear, so this is quick.
+    const uint32_t n = 20000, scratch = n;
+    std::vector<codegen::Move> chain;
+    for (uint32_t i = 0; i < n; ++i)
+        chain.push_back({(i + 1) % n, i});
+    std::vector<uint32_t> loc(n + 1);
+    for (uint32_t i = 0; i < n; ++i)
+        loc[i] = i;
+    auto seq = codegen::sequentializeMoves(chain, scratch);
+    assert(seq.size() == n + 1);
+    for (auto &m : seq)
+        loc[m.dst] = loc[m.src];
+    for (uint32_t i = 0; i < n; ++i)
+        assert(loc[(i + 1) % n] == i);
+}
+
+void testInterpreterFactorial() {
+    IRGraph g;
+    buildFactorial(g);
+    BytecodeFunction fn = lowerToBytecode(g);
+    assert(containsOp(fn, BcOp::CMP_JA) && !containsOp(fn, BcOp::CMP));
+    Interpreter interp(fn);
+    for (uint32_t n = 0; n <= 20; ++n)
+        assert(interp.run({n}) == referenceFactorial(n));
+    // The argument is a u32: the cast drops the high half.
+    assert(interpret(fn, {(1ULL << 32) | 5}) == 120);
+    assert(!fn.disassemble().empty());
+}
+
+void testInterpreterPhiCycles() {
+    IRGraph g;
+    buildSwapLoop(g, true);
+    BytecodeFunction fn = lowerToBytecode(g);
+    assert(containsOp(fn, BcOp::CMP_JA));
+    Interpreter interp(fn);
+    assert(interp.run({0}) == 11);
+    assert(interp.run({1}) == 11);
+    assert(interp.run({2}) == 22);
+    assert(interp.run({7}) == 11);
+
+    // Unfused: the compare sees i, so the loop runs one extra time.
+    IRGraph u;
+    buildSwapLoop(u, false);
+    BytecodeFunction ufn = lowerToBytecode(u);
+    assert(containsOp(ufn, BcOp::CMP) && containsOp(ufn, BcOp::JA) && !containsOp(ufn, BcOp::CMP_JA));
+    assert(interpret(ufn, {0}) == 11);
+    assert(interpret(ufn, {1}) == 22);
+    assert(interpret(ufn, {2}) == 11);
+}
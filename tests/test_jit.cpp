@@ -0,0 +1,141 @@
+#include "codegen/x86_64_jit.h"
+#include "exec/interpreter.h"
+#include "graph_builders.h"
+#include <cassert>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ir;
+using namespace codegen::x86_64;
+
+void testX86Encoding() {
+    using Bytes = std::vector<uint8_t>;
+    auto enc = [](auto f) {
+        Assembler a;
+        f(a);
+        return a.code();
+    };
+    assert((enc([](Assembler &a) { a.mov(RAX, RCX); }) == Bytes{0x48, 0x89, 0xC8}));
+    assert((enc([](Assembler &a) { a.mov(R9, RDI); }) == Bytes{0x49, 0x89, 0xF9}));
+    assert((enc([](Assembler &a) { a.mov32(RAX, RAX); }) == Bytes{0x89, 0xC0}));
+    assert((enc([](Assembler &a) { a.imul(RAX, R10); }) == Bytes{0x49, 0x0F, 0xAF, 0xC2}));
+    assert((enc([](Assembler &a) { a.cmp(RAX, RCX); }) == Bytes{0x48, 0x39, 0xC8}));
+    assert((enc([](Assembler &a) { a.addImm(RAX, 1); }) == Bytes{0x48, 0x83, 0xC0, 0x01}));
+    assert((enc([](Assembler &a) { a.movImm(RAX, 5); }) == Bytes{0xB8, 5, 0, 0, 0}));
+    assert((enc([](Assembler &a) { a.movImm(RAX, ~0ULL); }) ==
+            Bytes{0x48, 0xC7, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF}));
+    assert((enc([](Assembler &a) { a.load(RAX, Mem{RBP, -8}); }) == Bytes{0x48, 0x8B, 0x45, 0xF8}));
+    assert((enc([](Assembler &a) { a.store(Mem{RSP, 0}, R12); }) == Bytes{0x4C, 0x89, 0x64, 0x24, 0x00}));
+    assert((enc([](Assembler &a) { a.push(R12); }) == Bytes{0x41, 0x54}));
+    // Backward and forward branches get rel32 relative to the next insn.
+    Bytes loop = enc([](Assembler &a) {
+        Label top, out;
+        a.bind(top);
+        a.jcc(Cond::A, out);
+        a.jmp(top);
+        a.bind(out);
+        a.ret();
+    });
+    assert((loop == Bytes{0x0F, 0x87, 5, 0, 0, 0, 0xE9, 0xF5, 0xFF, 0xFF, 0xFF, 0xC3}));
+}
+
+void testJitFactorial() {
+    IRGraph g;
+    buildFactorial(g);
+    JitFunction fn = compileX86_64(g);
+    auto *fact = fn.as<uint64_t(uint32_t)>();
+    exec::BytecodeFunction bc = exec::lowerToBytecode(g);
+    for (uint32_t n = 0; n <= 25; ++n) {
+        assert(fact(n) == referenceFactorial(n));
+        assert(fn.call({n}) == exec::interpret(bc, {n}));
+    }
+    // Garbage in the upper half of the u32 argument register is ignored.
+    assert(fn.call({(7ULL << 32) | 6}) == 720);
+}
+
+void testJitPhiCycles() {
+    for (bool fuse : {true, false}) {
+        IRGraph g;
+        buildSwapLoop(g, fuse);
+        JitFunction fn = compileX86_64(g);
+        exec::BytecodeFunction bc = exec::lowerToBytecode(g);
+        for (uint64_t n = 0; n < 12; ++n)
+            assert(fn.call({n}) == exec::interpret(bc, {n}));
+    }
+}
+
+// Random straight-line arithmetic over many arguments, including ones
+// passed on the stack, checked against the interpreter.
+void testJitDifferential() {
+    std::mt19937_64 rng(12);
+    for (int iter = 0; iter < 50; ++iter) {
+        IRGraph g;
+        std::vector<IRGraph::Arg> sig;
+        for (int k = 0; k < 8; ++k)
+            sig.push_back({k % 2 ? "u32" : "u64", "a" + std::to_string(k)});
+        g.setSignature("u64", "f", sig);
+        auto *entry = g.createBlock("entry");
+        auto *big = g.createBlock("big");
+        auto *small = g.createBlock("small");
+        std::vector<SSAValue *> pool;
+        for (auto &a : sig) {
+            SSAValue *v = g.createArg(a.type, a.name);
+            if (a.type == "u32") {
+                SSAValue *w = g.createValue();
+                entry->addInst(g.createCast(w, v));
+                v = w;
+            }
+            pool.push_back(v);
+        }
+        for (int i = 0; i < 40; ++i) {
+            SSAValue *r = g.createValue();
+            SSAValue *x = pool[rng() % pool.size()], *y = pool[rng() % pool.size()];
+            uint64_t imm = rng() >> (rng() % 64);
+            switch (rng() % 3) {
+            case 0:
+                entry->addInst(g.createMovi(r, imm));
+                break;
+            case 1:
+                entry->addInst(g.createMul(r, x, y));
+                break;
+            default:
+                entry->addInst(g.createAddi(r, x, imm));
+                break;
+            }
+            pool.push_back(r);
+        }
+        SSAValue *l = pool[rng() % pool.size()], *rv = pool[rng() % pool.size()];
+        entry->addInst(g.createCmp(l, rv));
+        entry->addInst(g.createJa(big));
+        entry->addSuccessor(small);
+        entry->addSuccessor(big);
+        small->addInst(g.createRet(rv));
+        big->addInst(g.createRet(l));
+        // The not-taken successor is not next in layout, so it gets a jmp.
+
+        JitFunction fn = compileX86_64(g);
+        exec::BytecodeFunction bc = exec::lowerToBytecode(g);
+        using Fn8 = uint64_t(uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t,
+                             uint64_t);
+        auto *f = fn.as<Fn8>();
+        for (int t = 0; t < 4; ++t) {
+            uint64_t a[8];
+            for (auto &x : a)
+                x = rng();
+            uint64_t expect = exec::Interpreter(bc).run(a, 8);
+            assert(f(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]) == expect);
+        }
+    }
+
+    // A fused cmp + ja still stores the flag for a ja in a successor, or
+    // one further on past a block that only jumps.
+    for (bool hop : {false, true})
+        for (bool above : {true, false}) {
+            IRGraph g;
+            buildFlagsAcrossBlocks(g, above, hop);
+            uint64_t expect = above ? 5 : 3;
+            assert(exec::interpret(exec::lowerToBytecode(g), {}) == expect);
+            assert(compileX86_64(g).call({}) == expect);
+        }
+}
@@ -0,0 +1,169 @@
+#include "codegen/x86_64_jit.h"
+#include "exec/interpreter.h"
+#include "graph_builders.h"
+#include "opt/licm.h"
+#include "program_gen.h"
+#include <cassert>
+#include <vector>
+
+using namespace ir;
+
+void testLICMHoistsInvariants() {
+    // fact(n) with k = 5, c = cast n, t = c * k and u = p0 * t in the body:
+    // k, c and t move to the entry, which already is the preheader.
+    IRGraph g;
+    buildFactorial(g);
+    auto *entry = g.getBlock("entry");
+    auto *body = g.getBlock("body");
+    SSAValue *a0 = g.args()[0].val;
+    SSAValue *p0 = static_cast<MulInst *>(body->insts.front())->left();
+    SSAValue *k = g.createValue(), *c = g.createValue(), *t = g.createValue(), *u = g.createValue();
+    Inst *J = body->insts.back();
+    body->insertBefore(J, g.createMovi(k, 5));
+    body->insertBefore(J, g.createCast(c, a0));
+    body->insertBefore(J, g.createMul(t, c, k));
+    body->insertBefore(J, g.createMul(u, p0, t));
+
+    opt::LICM licm;
+    assert(licm.run(g));
+    assert(licm.numHoisted == 3 && licm.numPreheadersInserted == 0);
+    assert(k->def->parent() == entry && c->def->parent() == entry && t->def->parent() == entry);
+    assert(u->def->parent() == body);
+    assert(g.numBlocks() == 4 && g.checkDataFlow());
+    auto bc = exec::lowerToBytecode(g);
+    auto native = codegen::x86_64::compileX86_64(g);
+    for (uint32_t n = 0; n < 10; ++n)
+        assert(exec::interpret(bc, {n}) == referenceFactorial(n) && native.call({n}) == referenceFactorial(n));
+    assert(!licm.run(g));
+}
+
+void testLICMPreheaderInsertion() {
+    // entry: ja head (s = a) or fall into then (s = a + 10); both enter the
+    // outer loop, which has no preheader. The inner loop's invariants that
+    // depend on s stop at its preheader; the rest leave both loops.
+    IRGraph g;
+    g.setSignature("u64", "nest", {{"u32", "a0"}});
+    auto *entry = g.createBlock("entry");
+    auto *thenB = g.createBlock("then");
+    auto *head = g.createBlock("head");
+    auto *obody = g.createBlock("obody");
+    auto *ih = g.createBlock("ih");
+    auto *ib = g.createBlock("ib");
+    auto *olatch = g.createBlock("olatch");
+    auto *exit = g.createBlock("exit");
+    SSAValue *a0 = g.createArg("u32", "a0");
+    auto V = [&] { return g.createValue(); };
+    SSAValue *a = V(), *one = V(), *x1 = V(), *s = V(), *i = V(), *five = V(), *zero = V();
+    SSAValue *t = V(), *k = V(), *two = V(), *w = V(), *q = V(), *w2 = V(), *t2 = V(), *t3 = V();
+    SSAValue *k2 = V(), *s2 = V(), *i2 = V();
+    entry->addInst(g.createCast(a, a0));
+    entry->addInst(g.createMovi(one, 1));
+    entry->addInst(g.createCmp(a, one));
+    entry->addInst(g.createJa(head));
+    entry->addSuccessor(thenB);
+    entry->addSuccessor(head);
+    thenB->addInst(g.createAddi(x1, a, 10));
+    thenB->addInst(g.createJmp(head));
+    thenB->addSuccessor(head);
+    head->addInst(g.createPhi(s, {{entry, a}, {thenB, x1}, {olatch, s2}}));
+    head->addInst(g.createPhi(i, {{entry, a}, {thenB, a}, {olatch, i2}}));
+    head->addInst(g.createMovi(five, 5));
+    head->addInst(g.createCmp(i, five));
+    head->addInst(g.createJa(exit));
+    head->addSuccessor(obody);
+    head->addSuccessor(exit);
+    obody->addInst(g.createMovi(zero, 0));
+    obody->addInst(g.createJmp(ih));
+    obody->addSuccessor(ih);
+    ih->addInst(g.createPhi(t, {{obody, s}, {ib, t3}}));
+    ih->addInst(g.createPhi(k, {{obody, zero}, {ib, k2}}));
+    ih->addInst(g.createMovi(two, 2));
+    ih->addInst(g.createCmp(k, two));
+    ih->addInst(g.createJa(olatch));
+    ih->addSuccessor(ib);
+    ih->addSuccessor(olatch);
+    ib->addInst(g.createMul(w, s, s));
+    ib->addInst(g.createMovi(q, 7));
+    ib->addInst(g.createAddi(w2, q, 1));
+    ib->addInst(g.createMul(t2, t, w));
+    ib->addInst(g.createMul(t3, t2, w2));
+    ib->addInst(g.createAddi(k2, k, 1));
+    ib->addInst(g.createJmp(ih));
+    ib->addSuccessor(ih);
+    olatch->addInst(g.createAddi(s2, t, 1));
+    olatch->addInst(g.createAddi(i2, i, 1));
+    olatch->addInst(g.createJmp(head));
+    olatch->addSuccessor(head);
+    exit->addInst(g.createRet(s));
+    auto before = exec::lowerToBytecode(g);
+
+    opt::LICM licm;
+    assert(licm.run(g));
+    assert(licm.numPreheadersInserted == 1 && licm.numLoopsSkipped == 0);
+    // Inner: two, w, q, w2 to obody. Outer: five, zero, two, q, w2 onwards.
+    assert(licm.numHoisted == 9);
+    BasicBlock *pre = g.getBlocks().back();
+    assert(g.numBlocks() == 9 && pre->successors == std::vector<BasicBlock *>{head});
+    assert(entry->successors == (std::vector<BasicBlock *>{thenB, pre}));
+    assert(static_cast<JaInst *>(entry->insts.back())->target() == pre);
+    assert(static_cast<JmpInst *>(thenB->insts.back())->target() == pre);
+    assert(head->predecessors.size() == 2);
+    // s differs between the two entries and gets a phi; i does not.
+    auto *S = static_cast<PhiInst *>(s->def);
+    auto *I = static_cast<PhiInst *>(i->def);
+    SSAValue *merged = S->incomingFor(pre);
+    assert(merged->def->parent() == pre && merged->def->opcode() == Opcode::PHI_U64);
+    assert(I->incomingFor(pre) == a && I->numIncomings() == 2);
+    for (SSAValue *v : {five, zero, two, q, w2})
+        assert(v->def->parent() == pre);
+    assert(w->def->parent() == obody && t2->def->parent() == ib);
+    assert(g.checkDataFlow());
+
+    auto after = exec::lowerToBytecode(g);
+    auto native = codegen::x86_64::compileX86_64(g);
+    for (uint64_t n = 0; n < 8; ++n) {
+        uint64_t expect = exec::interpret(before, {n});
+        assert(exec::interpret(after, {n}) == expect && native.call({n}) == expect);
+    }
+    assert(!licm.run(g));
+}
+
+void testLICMSkipsIrreducible() {
+    // entry branches into both a and b, which jump to each other.
+    IRGraph g;
+    g.setSignature("u64", "irr", {{"u32", "a0"}});
+    auto *entry = g.createBlock("entry");
+    auto *a = g.createBlock("a");
+    auto *b = g.createBlock("b");
+    SSAValue *a0 = g.createArg("u32", "a0");
+    SSAValue *w = g.createValue(), *one = g.createValue(), *k = g.createValue(), *m = g.createValue();
+    entry->addInst(g.createCast(w, a0));
+    entry->addInst(g.createMovi(one, 1));
+    entry->addInst(g.createCmp(w, one));
+    entry->addInst(g.createJa(b));
+    entry->addSuccessor(a);
+    entry->addSuccessor(b);
+    a->addInst(g.createMovi(k, 3));
+    a->addInst(g.createJmp(b));
+    a->addSuccessor(b);
+    b->addInst(g.createMul(m, w, w));
+    b->addInst(g.createJmp(a));
+    b->addSuccessor(a);
+
+    opt::LICM licm;
+    assert(!licm.run(g));
+    assert(licm.numLoopsSkipped == 1 && licm.numHoisted == 0 && g.numBlocks() == 3);
+    assert(k->def->parent() == a && m->def->parent() == b);
+}
+
+void testLICMRandomPrograms() {
+    size_t hoisted = checkPassOnRandomPrograms(18, 80, [](IRGraph &g, int) {
+        opt::LICM licm;
+        licm.run(g);
+        assert(licm.numLoopsSkipped == 0);
+        opt::LICM again;
+        assert(!again.run(g));
+        return licm.numHoisted;
+    });
+    assert(hoisted > 0);
+}
@@ -0,0 +1,181 @@
+#include "analysis/liveness.h"
+#include "graph_builders.h"
+#include "program_gen.h"
+#include <cassert>
+#include <map>
+#include <random>
+#include <set>
+
+using namespace ir;
+using namespace analysis;
+
+namespace {
+using Sets = std::map<const BasicBlock *, std::set<uint32_t>>;
+
+// Textbook round-robin data-flow, one instruction at a time.
+void referenceLiveness(const IRGraph &g, Sets &in, Sets &out) {
+    RPO rpo;
+    rpo.run(g.entry());
+    auto isPhi = [](const Inst *I) { return I->opcode() == Opcode::PHI_U64; };
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (size_t k = rpo.rpo.size(); k-- > 0;) {
+            BasicBlock *b = rpo.rpo[k];
+            std::set<uint32_t> live;
+            for (auto *s : b->successors) {
+                std::set<uint32_t> si = in[s];
+                for (const Inst *I : s->insts)
+                    if (isPhi(I)) {
+                        si.erase(I->result()->id);
+                        if (auto *v = static_cast<const PhiInst *>(I)->incomingFor(b))
+                            live.insert(v->id);
+                    }
+                live.insert(si.begin(), si.end());
+            }
+            std::set<uint32_t> newOut = live;
+            for (const Inst *I = b->insts.back(); I; I = I->prev()) {
+                if (auto *r = I->result())
+                    live.erase(r->id);
+                if (isPhi(I))
+                    continue;
+                for (const auto &op : I->operands())
+                    if (op.isValue() && op.value())
+                        live.insert(op.value()->id);
+            }
+            for (const Inst *I : b->insts)
+                if (isPhi(I))
+                    live.insert(I->result()->id);
+            if (live != in[b] || newOut != out[b]) {
+                in[b] = live;
+                out[b] = newOut;
+                changed = true;
+            }
+        }
+    }
+}
+
+void checkAgainstReference(const IRGraph &g, Liveness &LV) {
+    Sets in, out;
+    referenceLiveness(g, in, out);
+    for (auto &[b, set] : in) {
+        std::set<uint32_t> got;
+        LV.liveIn.get(b).forEach([&](size_t id) { got.insert(static_cast<uint32_t>(id)); });
+        assert(got == set);
+        got.clear();
+        LV.liveOut.get(b).forEach([&](size_t id) { got.insert(static_cast<uint32_t>(id)); });
+        assert(got == out[b]);
+    }
+}
+
+// An interval covers a block boundary exactly when the value is live there.
+void checkIntervals(const IRGraph &g, Liveness &LV) {
+    RPO rpo;
+    rpo.run(g.entry());
+    LV.buildIntervals(g, rpo.rpo);
+    for (auto *b : rpo.rpo)
+        for (auto *x : rpo.rpo)
+            for (const Inst *I : x->insts) {
+                SSAValue *v = I->result();
+                if (!v)
+                    continue;
+                const LiveInterval &it = LV.interval(v);
+                assert(!it.empty() && it.start() <= it.end());
+                assert(it.covers(LV.blockFrom[b]) == LV.isLiveIn(v, b));
+                assert(it.covers(LV.blockTo[b]) == LV.isLiveOut(v, b));
+            }
+}
+}
+
+void testLivenessFactorial() {
+    IRGraph g;
+    buildFactorial(g);
+    Liveness LV;
+    LV.run(g);
+    assert(!LV.usedFixpoint);
+    auto *entry = g.getBlock("entry"), *loop = g.getBlock("loop");
+    auto *body = g.getBlock("body"), *done = g.getBlock("done");
+    auto ids = [](const BitVector &bv) {
+        std::set<size_t> s;
+        bv.forEach([&](size_t id) { s.insert(id); });
+        return s;
+    };
+    auto *v0 = entry->insts.front()->result();
+    auto *v2 = entry->insts.back()->result();
+    auto *p0 = loop->insts.front()->result();
+    auto *p1 = loop->insts.front()->next()->result();
+    auto *m = body->insts.front()->result();
+    auto *n = body->insts.front()->next()->result();
+    // Phi operands are live out of their own predecessor only.
+    assert(LV.isLiveOut(v0, entry) && !LV.isLiveIn(v0, loop));
+    assert(LV.isLiveOut(m, body) && LV.isLiveOut(n, body) && !LV.isLiveIn(m, loop));
+    assert((ids(LV.liveIn[loop]) == std::set<size_t>{p0->id, p1->id, v2->id}));
+    assert((ids(LV.liveIn[body]) == std::set<size_t>{p0->id, p1->id, v2->id}));
+    assert((ids(LV.liveIn[done]) == std::set<size_t>{p0->id}));
+    // v2 is live around the whole loop, including the back edge.
+    assert(LV.isLiveOut(v2, body) && !LV.isLiveOut(p1, body));
+    checkAgainstReference(g, LV);
+
+    LV.buildIntervals(g, {entry, loop, body, done});
+    uint32_t mulPos = LV.blockFrom[body] + 2;
+    assert(LV.instAt(mulPos) == body->insts.front());
+    assert(LV.interval(m).start() == mulPos + 1 && LV.interval(m).end() == LV.blockTo[body]);
+    // p1 dies in body at the addi, well before the back edge.
+    const LiveInterval &ip1 = LV.interval(p1);
+    assert(ip1.start() == LV.blockFrom[loop] && ip1.end() == mulPos + 2);
+    assert(!ip1.covers(LV.blockFrom[done]));
+    // p0 has a hole where only `done` is laid out after `body`.
+    assert(LV.interval(p0).covers(LV.blockFrom[done]) && !LV.interval(p0).covers(LV.blockTo[body]));
+    checkIntervals(g, LV);
+}
+
+void testLivenessIrreducible() {
+    // entry branches into both A and B, which form a cycle with two entries.
+    IRGraph g;
+    g.setSignature("u64", "irr", {{"u32", "a0"}});
+    auto *entry = g.createBlock("entry");
+    auto *A = g.createBlock("A");
+    auto *B = g.createBlock("B");
+    auto *exit = g.createBlock("exit");
+    SSAValue *a0 = g.createArg("u32", "a0");
+    SSAValue *w = g.createValue(), *k = g.createValue(), *x = g.createValue();
+    SSAValue *pa = g.createValue(), *pb = g.createValue(), *y = g.createValue();
+    entry->addInst(g.createCast(w, a0));
+    entry->addInst(g.createMovi(k, 3));
+    entry->addInst(g.createCmp(w, k));
+    entry->addInst(g.createJa(B));
+    entry->addSuccessor(A);
+    entry->addSuccessor(B);
+    A->addInst(g.createPhi(pa, {{entry, k}, {B, y}}));
+    A->addInst(g.createCmp(pa, w));
+    A->addInst(g.createJa(exit));
+    A->addSuccessor(B);
+    A->addSuccessor(exit);
+    B->addInst(g.createPhi(pb, {{entry, w}, {A, pa}}));
+    B->addInst(g.createAddi(y, pb, 1));
+    B->addInst(g.createJmp(A));
+    B->addSuccessor(A);
+    exit->addInst(g.createMul(x, pa, k));
+    exit->addInst(g.createRet(x));
+
+    Liveness LV;
+    LV.run(g);
+    assert(LV.usedFixpoint);
+    assert(LV.isLiveIn(w, A) && LV.isLiveIn(w, B) && LV.isLiveIn(k, B));
+    assert(!LV.isLiveIn(y, A) && LV.isLiveOut(y, B));
+    checkAgainstReference(g, LV);
+    checkIntervals(g, LV);
+}
+
+void testLivenessRandomPrograms() {
+    std::mt19937_64 rng(77);
+    for (int iter = 0; iter < 80; ++iter) {
+        IRGraph g;
+        ProgramGen gen(g, rng);
+        gen.build(2 + iter % 9);
+        Liveness LV;
+        LV.run(g);
+        assert(!LV.usedFixpoint);
+        checkAgainstReference(g, LV);
+        checkIntervals(g, LV);
+    }
+}
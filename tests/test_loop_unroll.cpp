@@ -0,0 +1,185 @@
+#include "codegen/x86_64_jit.h"
+#include "exec/interpreter.h"
+#include "graph_builders.h"
+#include "opt/dce.h"
+#include "opt/loop_unroll.h"
+#include "program_gen.h"
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+using namespace ir;
+
+namespace {
+// p = 1; for (i = 1; n > i; i += step) p *= i; return p;
+void buildProductBelow(IRGraph &g, uint64_t step) {
+    g.setSignature("u64", "prod", {{"u32", "a0"}});
+    auto *entry = g.createBlock("entry");
+    auto *head = g.createBlock("head");
+    auto *body = g.createBlock("body");
+    auto *exit = g.createBlock("exit");
+    SSAValue *a0 = g.createArg("u32", "a0");
+    SSAValue *n = g.createValue(), *one = g.createValue(), *p = g.createValue(), *i = g.createValue();
+    SSAValue *p2 = g.createValue(), *i2 = g.createValue();
+    entry->addInst(g.createCast(n, a0));
+    entry->addInst(g.createMovi(one, 1));
+    entry->addSuccessor(head);
+    head->addInst(g.createPhi(p, {{entry, one}, {body, p2}}));
+    head->addInst(g.createPhi(i, {{entry, one}, {body, i2}}));
+    head->addInst(g.createCmp(n, i));
+    head->addInst(g.createJa(body));
+    head->addSuccessor(exit);
+    head->addSuccessor(body);
+    body->addInst(g.createMul(p2, p, i));
+    body->addInst(g.createAddi(i2, i, step));
+    body->addInst(g.createJmp(head));
+    body->addSuccessor(head);
+    exit->addInst(g.createRet(p));
+}
+uint64_t referenceProductBelow(uint64_t n, uint64_t step) {
+    uint64_t p = 1;
+    for (uint64_t i = 1; n > i; i += step)
+        p *= i;
+    return p;
+}
+
+std::vector<BasicBlock *> sortedBlocks(std::vector<BasicBlock *> v) {
+    std::sort(v.begin(), v.end(), [](auto *a, auto *b) { return a->id < b->id; });
+    return v;
+}
+}
+
+void testLoopUnrollFactorial() {
+    IRGraph g;
+    buildFactorial(g);
+    analysis::LoopAnalyzer LA;
+    LA.run(g.entry());
+    analysis::InductionVars IV;
+    IV.run(LA);
+    analysis::Loop *L = LA.loops[0].get();
+    opt::LoopUnroll unroll;
+    assert(unroll.factorFor(*L, IV) == 4);
+    analysis::Loop *U = unroll.unroll(g, LA, IV, *L, 4);
+
+    // Header with the guard and its second half, four bodies, three more
+    // header copies; plus the block into the remainder loop.
+    assert(LA.loops.size() == 2 && LA.loops[0].get() == L && LA.loops[1].get() == U);
+    assert(U->parent == LA.rootLoop && U->latches.size() == 1 && U->blocks.size() == 9);
+    assert(g.numBlocks() == 4 + 9 + 1 && unroll.numPreheadersInserted == 0);
+    assert(countOpcode(U->blocks, Opcode::MUL_U64) == 4 && countOpcode(U->blocks, Opcode::CMP_U64) == 2);
+    assert(g.entry()->successors == std::vector<BasicBlock *>{U->header});
+    assert(g.checkDataFlow());
+
+    // The loops LA was updated with match a fresh analysis.
+    analysis::LoopAnalyzer fresh;
+    fresh.run(g.entry());
+    assert(fresh.loops.size() == 2);
+    for (auto &F : fresh.loops) {
+        analysis::Loop *mine = F->header == U->header ? U : L;
+        assert(F->header == mine->header && F->latches == mine->latches);
+        assert(sortedBlocks(F->blocks) == sortedBlocks(mine->blocks));
+    }
+
+    auto bc = exec::lowerToBytecode(g);
+    auto native = codegen::x86_64::compileX86_64(g);
+    for (uint32_t n = 0; n < 24; ++n)
+        assert(exec::interpret(bc, {n}) == referenceFactorial(n) && native.call({n}) == referenceFactorial(n));
+
+    opt::DCE dce;
+    dce.run(g);
+    assert(dce.numBlocksMerged > 0);
+    bc = exec::lowerToBytecode(g);
+    for (uint32_t n = 0; n < 24; ++n)
+        assert(exec::interpret(bc, {n}) == referenceFactorial(n));
+}
+
+void testLoopUnrollCountedLoops() {
+    // Constant trip counts: one compare against a precomputed limit.
+    for (bool inclusive : {true, false})
+        for (uint64_t step = 1; step <= 3; ++step)
+            for (uint64_t start = 0; start <= 3; ++start)
+                for (uint64_t bound = 0; bound <= 14; ++bound) {
+                    IRGraph g;
+                    buildCountedLoop(g, start, bound, step, inclusive);
+                    uint64_t expect = exec::interpret(exec::lowerToBytecode(g), {});
+                    opt::LoopUnroll unroll;
+                    unroll.maxFactor = 3;
+                    bool changed = unroll.run(g);
+                    // The body must run at least twice to be worth it.
+                    assert(changed == (expect >= 3));
+                    assert(g.checkDataFlow());
+                    assert(exec::interpret(exec::lowerToBytecode(g), {}) == expect);
+                    if (changed) {
+                        analysis::LoopAnalyzer LA;
+                        LA.run(g.entry());
+                        assert(LA.loops.size() == 2 && countOpcode(g.getBlocks(), Opcode::CMP_U64) == 2);
+                    }
+                }
+
+    // Counting down: the step looks negative, so the loop is left alone.
+    for (bool inclusive : {true, false}) {
+        IRGraph g;
+        buildCountedLoop(g, 1, UINT64_MAX - 1, UINT64_MAX, inclusive);
+        uint64_t expect = exec::interpret(exec::lowerToBytecode(g), {});
+        opt::LoopUnroll unroll;
+        assert(!unroll.run(g) && unroll.numUnrolled == 0);
+        assert(exec::interpret(exec::lowerToBytecode(g), {}) == expect);
+    }
+
+    // Runtime bounds on a loop tested with bound > i.
+    for (uint64_t step = 1; step <= 3; ++step) {
+        IRGraph g;
+        buildProductBelow(g, step);
+        opt::LoopUnroll unroll;
+        assert(unroll.run(g) && unroll.numUnrolled == 1);
+        assert(g.checkDataFlow());
+        auto bc = exec::lowerToBytecode(g);
+        auto native = codegen::x86_64::compileX86_64(g);
+        for (uint64_t n = 0; n < 30; ++n)
+            assert(exec::interpret(bc, {n}) == referenceProductBelow(n, step) &&
+                   native.call({n}) == referenceProductBelow(n, step));
+    }
+
+    // The size budget caps the factor: the counted loop has 5 instructions.
+    IRGraph g;
+    buildCountedLoop(g, 0, 100, 1, true);
+    analysis::LoopAnalyzer LA;
+    LA.run(g.entry());
+    analysis::InductionVars IV;
+    IV.run(LA);
+    opt::LoopUnroll unroll;
+    unroll.sizeBudget = 9;
+    assert(unroll.factorFor(*LA.loops[0], IV) == 0);
+    unroll.sizeBudget = 15;
+    assert(unroll.factorFor(*LA.loops[0], IV) == 3);
+    unroll.maxFactor = 2;
+    assert(unroll.factorFor(*LA.loops[0], IV) == 2);
+}
+
+void testLoopUnrollRandomPrograms() {
+    // Loops bounded by a0 take the runtime guard instead of a trip count.
+    size_t guarded = 0;
+    size_t unrolled = checkPassOnRandomPrograms(
+        20, 80,
+        [&](IRGraph &g, int) {
+            analysis::LoopAnalyzer LA;
+            LA.run(g.entry());
+            size_t loops = LA.loops.size();
+            opt::LoopUnroll unroll;
+            {
+                analysis::InductionVars IV;
+                IV.run(LA);
+                for (auto &L : LA.loops)
+                    guarded += !IV.tripCount(L.get()) && unroll.factorFor(*L, IV);
+            }
+            unroll.run(g);
+            LA.run(g.entry());
+            assert(LA.loops.size() == loops + unroll.numUnrolled);
+            return unroll.numUnrolled;
+        },
+        [](ProgramGen &gen, int iter) {
+            gen.ivExprs = iter % 2;
+            gen.argBounds = true;
+        });
+    assert(unrolled > 0 && guarded > 0);
+}
@@ -288,4 +288,35 @@ void testLoopsExample3() {
     assert(LC->parent == LB);
     assert(hasChild(LB, LC));
     assert(LB->parent == LA.rootLoop);
-}
\ No newline at end of file
+}
+// Three nested loops plus a self loop inside the innermost one: every
+// level must keep its parent, not be hoisted to the outermost loop.
+void testLoopsDeepNesting() {
+    BuiltCFG W;
+    auto *E = BB(W, "E");
+    auto *A = BB(W, "A");
+    auto *B = BB(W, "B");
+    auto *C = BB(W, "C");
+    auto *S = BB(W, "S");
+    auto *X = BB(W, "X");
+    EDGE(E, A);
+    EDGE(A, B);
+    EDGE(A, X);
+    EDGE(B, C);
+    EDGE(B, A);
+    EDGE(C, S);
+    EDGE(S, S);
+    EDGE(S, C);
+    EDGE(C, B);
+    LoopAnalyzer LA;
+    LA.run(E);
+    Loop *LA_ = findLoopByHeader(LA, A);
+    Loop *LB = findLoopByHeader(LA, B);
+    Loop *LC = findLoopByHeader(LA, C);
+    Loop *LS = findLoopByHeader(LA, S);
+    assert(LA_ && LB && LC && LS);
+    assert(LS->parent == LC && LC->parent == LB && LB->parent == LA_);
+    assert(LA_->parent == LA.rootLoop);
+    assert(hasChild(LC, LS) && hasChild(LB, LC) && hasChild(LA_, LB) && !hasChild(LA_, LC));
+    assert(LA_->children.size() == 1 && LB->children.size() == 1);
+}
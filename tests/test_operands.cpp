@@ -0,0 +1,49 @@
+#include "graph_builders.h"
+#include <cassert>
+
+using namespace ir;
+
+void testOperandAccess() {
+    BuiltCFG W;
+    auto *A = BB(W, "A");
+    auto *B = BB(W, "B");
+    auto *C = BB(W, "C");
+    EDGE(A, B);
+    EDGE(A, C);
+    EDGE(B, C);
+    auto &g = W.g;
+    SSAValue *x = g.createValue(), *y = g.createValue(), *z = g.createValue(), *p = g.createValue();
+
+    auto *movi = g.createMovi(x, 42);
+    auto *addi = g.createAddi(y, x, 5);
+    auto *mul = g.createMul(z, x, y);
+    auto *cmp = g.createCmp(x, z);
+    auto *ja = g.createJa(C);
+    auto *jmp = g.createJmp(C);
+    auto *phi = g.createPhi(p, {{A, x}, {B, z}});
+    auto *ret = g.createRet(p);
+
+    assert(movi->numOperands() == 1 && movi->operand(0).isImm() && movi->imm() == 42);
+    assert(addi->numOperands() == 2);
+    assert(addi->operand(0).isValue() && addi->operand(0).value() == x);
+    assert(addi->operand(1).isImm() && addi->operand(1).imm() == 5);
+    assert(!addi->operand(1).value() && !addi->operand(0).block());
+    assert(mul->left() == x && mul->right() == y);
+    assert(cmp->result() == nullptr && cmp->left() == x && cmp->right() == z);
+    assert(ja->operand(0).isBlock() && ja->target() == C);
+    assert(jmp->operands().size() == 1 && jmp->operands()[0].block() == C);
+    assert(ret->src() == p);
+
+    assert(phi->numOperands() == 4 && phi->numIncomings() == 2);
+    assert(phi->incomingBlock(0) == A && phi->incomingValue(0) == x);
+    assert(phi->incomingBlock(1) == B && phi->incomingValue(1) == z);
+    assert(phi->incomingFor(B) == z && phi->incomingFor(C) == nullptr);
+
+    size_t values = 0, blocks = 0;
+    for (const Operand &op : phi->operands()) {
+        values += op.isValue();
+        blocks += op.isBlock();
+    }
+    assert(values == 2 && blocks == 2);
+    assert(x->users.size() == 4);
+}
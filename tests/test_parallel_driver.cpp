@@ -0,0 +1,212 @@
+#include "exec/interpreter.h"
+#include "graph_builders.h"
+#include "ir/text_parser.h"
+#include "opt/parallel_driver.h"
+#include "program_gen.h"
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+using namespace ir;
+
+namespace {
+// Random functions f0..f{n-1}, the same for the same seed.
+void buildRandomModule(Module &M, size_t n, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    for (size_t i = 0; i < n; ++i) {
+        ProgramGen gen(M.createFunction("f" + std::to_string(i)), rng);
+        gen.ivExprs = i % 2;
+        gen.build(2 + i % 8);
+    }
+}
+
+const char *kPipeline = "sccp,dce,gvn,licm,strength-reduce,loop-unroll,gvn,dce";
+}
+
+void testWorkStealingPool() {
+    opt::WorkStealingPool pool(4);
+    assert(pool.numThreads() == 4);
+    for (size_t n : {0u, 1u, 3u, 100u, 1000u}) {
+        std::vector<std::atomic<int>> hits(n);
+        pool.parallelFor(n, [&](size_t i, unsigned w) {
+            assert(w < 4);
+            ++hits[i];
+        });
+        for (auto &h : hits)
+            assert(h == 1);
+    }
+
+    // One slow task at the front of worker 0's share: the others steal the
+    // rest of it.
+    std::vector<unsigned> workerOf(64);
+    pool.parallelFor(64, [&](size_t i, unsigned w) {
+        if (i == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        workerOf[i] = w;
+    });
+    size_t stolen = 0;
+    for (size_t i = 1; i < 16; ++i)
+        stolen += workerOf[i] != 0;
+    assert(stolen > 0);
+
+    // Every task runs even when some throw; the lowest failing one wins.
+    std::atomic<size_t> ran{0};
+    bool threw = false;
+    try {
+        pool.parallelFor(50, [&](size_t i, unsigned) {
+            ++ran;
+            if (i == 7 || i == 30)
+                throw std::runtime_error("task " + std::to_string(i));
+        });
+    } catch (const std::runtime_error &e) {
+        threw = std::string(e.what()) == "task 7";
+    }
+    assert(threw && ran == 50);
+    opt::WorkStealingPool single(1);
+    size_t sum = 0;
+    single.parallelFor(10, [&](size_t i, unsigned w) { sum += i + w; });
+    assert(sum == 45);
+}
+
+void testModuleText() {
+    Module M;
+    buildFactorial(M.createFunction("fact"));
+    buildRandomModule(M, 6, 25);
+    buildFactorial(M.createFunction("fact2"));
+    assert(M.size() == 8 && M.getFunction("f3") == M.function(4) && !M.getFunction("rand"));
+    std::string text = M.toString();
+
+    // createFunction sets the whole signature; a bare graph has none.
+    Module S;
+    IRGraph &sig = S.createFunction("g", {{"u64", "x"}});
+    assert(sig.name() == "g" && sig.args().size() == 1 && sig.args()[0].name == "x");
+    assert(IRGraph().name().empty() && IRGraph().args().empty());
+
+    Module N;
+    parseModuleText(text, N);
+    assert(N.size() == 8 && N.toString() == text && N.numInsts() == M.numInsts());
+    assert(N.getFunction("fact2") == N.function(7) && N.function(0)->name() == "fact");
+
+    M.releaseFunction(2);
+    assert(!M.function(2) && M.size() == 8 && !M.getFunction("f1") && M.numInsts() < N.numInsts());
+    Module P;
+    parseModuleText(M.toString(), P);
+    assert(P.size() == 7 && P.getFunction("f2") == P.function(2));
+
+    // Errors carry the line number within the whole module.
+    std::string bad = text;
+    size_t at = bad.find("u64 f1(");
+    at = bad.find("    ", at);
+    bad.insert(at, "    bogus       v1\n");
+    size_t line = 1;
+    for (size_t i = 0; i < at; ++i)
+        line += bad[i] == '\n';
+    bool threw = false;
+    try {
+        Module Q;
+        parseModuleText(bad, Q);
+    } catch (const std::runtime_error &e) {
+        threw = std::string(e.what()).find("IR text:" + std::to_string(line) + ":") != std::string::npos;
+    }
+    assert(threw);
+}
+
+void testParallelDriverDeterminism() {
+    Module serialM, parallelM;
+    buildRandomModule(serialM, 60, 26);
+    buildRandomModule(parallelM, 60, 26);
+    assert(serialM.toString() == parallelM.toString());
+    std::vector<exec::BytecodeFunction> before;
+    for (size_t i = 0; i < serialM.size(); ++i)
+        before.push_back(exec::lowerToBytecode(*serialM.function(i)));
+
+    opt::ParallelDriver serial(kPipeline, 1), parallel(kPipeline, 8);
+    serial.verifyEach = parallel.verifyEach = true;
+    auto a = serial.run(serialM);
+    auto b = parallel.run(parallelM);
+    assert(parallel.numThreads() == 8 && a.size() == 60 && b.size() == 60);
+    assert(serialM.toString() == parallelM.toString());
+    for (size_t i = 0; i < a.size(); ++i) {
+        assert(a[i].name == "f" + std::to_string(i) && a[i].name == b[i].name);
+        assert(a[i].error.empty() && b[i].error.empty() && a[i].changed == b[i].changed);
+        assert(a[i].records.size() == 8 && b[i].records.size() == 8);
+        for (size_t p = 0; p < 8; ++p) {
+            auto &x = a[i].records[p], &y = b[i].records[p];
+            assert(x.name == y.name && x.instsBefore == y.instsBefore && x.instsAfter == y.instsAfter);
+            assert(x.blocksAfter == y.blocksAfter && x.stats == y.stats);
+        }
+    }
+    std::mt19937_64 rng(26);
+    for (size_t i = 0; i < parallelM.size(); ++i)
+        checkSameResults(before[i], *parallelM.function(i), rng, 1);
+
+    std::ostringstream os;
+    os << std::setprecision(2);
+    opt::ParallelDriver::printReport(b, os);
+    std::string report = os.str();
+    assert(os.flags() == std::ostringstream().flags() && os.precision() == 2);
+    assert(report.find("loop-unroll") != std::string::npos && report.find("/60") != std::string::npos);
+    assert(report.find("error") == std::string::npos);
+    // gvn and dce run twice, and each run gets its own row.
+    size_t gvnRows = 0;
+    std::istringstream lines(report);
+    for (std::string line; std::getline(lines, line);)
+        gvnRows += line.rfind("gvn ", 0) == 0;
+    assert(gvnRows == 2);
+}
+
+void testParallelDriverReleaseAndErrors() {
+    Module M;
+    buildRandomModule(M, 40, 27);
+    std::vector<exec::BytecodeFunction> expected;
+    {
+        Module ref;
+        buildRandomModule(ref, 40, 27);
+        opt::ParallelDriver(kPipeline, 1).run(ref);
+        for (size_t i = 0; i < ref.size(); ++i)
+            expected.push_back(exec::lowerToBytecode(*ref.function(i)));
+    }
+
+    // Emit lowers each function on its worker, then its IR is freed there.
+    opt::ParallelDriver D(kPipeline, 4);
+    D.releaseIR = true;
+    std::vector<exec::BytecodeFunction> emitted(M.size());
+    auto results = D.run(M, [&](size_t i, IRGraph &g) { emitted[i] = exec::lowerToBytecode(g); });
+    std::mt19937_64 rng(27);
+    for (size_t i = 0; i < M.size(); ++i) {
+        assert(!M.function(i) && results[i].error.empty());
+        checkSameResults(expected[i], emitted[i], rng, 1);
+    }
+    assert(M.numInsts() == 0 && D.run(M).size() == 40);
+    // The freed arenas' chunks stay with the workers for later functions.
+    size_t cached = 0;
+    for (unsigned w = 0; w < D.numThreads(); ++w)
+        cached += D.cache(w).numCached();
+    assert(cached >= 40);
+
+    // A failing function is reported without stopping the others.
+    bool threw = false;
+    try {
+        opt::ParallelDriver("gvn,inline", 2);
+    } catch (const std::runtime_error &) {
+        threw = true;
+    }
+    assert(threw);
+    Module E;
+    buildRandomModule(E, 10, 28);
+    opt::ParallelDriver ED("dce", 3);
+    auto er = ED.run(E, [](size_t i, IRGraph &) {
+        if (i == 4)
+            throw std::runtime_error("emit failed");
+    });
+    for (size_t i = 0; i < er.size(); ++i)
+        assert(er[i].records.size() == 1 && (i == 4) == !er[i].error.empty());
+    std::ostringstream os;
+    opt::ParallelDriver::printReport(er, os);
+    assert(os.str().find("error in f4: emit failed") != std::string::npos);
+}
@@ -0,0 +1,133 @@
+#include "exec/interpreter.h"
+#include "graph_builders.h"
+#include "opt/pass_manager.h"
+#include "program_gen.h"
+#include <cassert>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+using namespace ir;
+using analysis::AnalysisManager;
+
+void testPassManagerPipeline() {
+    opt::PassManager PM;
+    PM.parsePipeline(" sccp, gvn,licm , strength-reduce,loop-unroll,dce");
+    assert(PM.numPasses() == 6 && PM.pipeline() == "sccp,gvn,licm,strength-reduce,loop-unroll,dce");
+    PM.verifyEach = true;
+
+    IRGraph g;
+    buildFactorial(g);
+    size_t insts = g.numInsts(), blocks = g.numBlocks();
+    assert(insts == 11 && PM.run(g));
+    auto &R = PM.records();
+    assert(R.size() == 6 && R[0].name == "sccp" && R[5].name == "dce");
+    assert(R.front().instsBefore == insts && R.front().blocksBefore == blocks);
+    assert(R.back().instsAfter == g.numInsts() && R.back().blocksAfter == g.numBlocks());
+    for (size_t i = 0; i + 1 < R.size(); ++i)
+        assert(R[i].instsAfter == R[i + 1].instsBefore && R[i].blocksAfter == R[i + 1].blocksBefore);
+    // Unrolling rewires the CFG, dropping what gvn and licm left cached; GVN
+    // only touches instructions.
+    assert(R[4].changed && R[4].invalidated.size() == 2);
+    assert(R[4].invalidated[0] == AnalysisManager::DOM_TREE && R[4].invalidated[1] == AnalysisManager::LOOPS);
+    assert(R[4].stats[0].first == "unrolled" && R[4].stats[0].second == 1);
+    assert(R[1].invalidated.empty() && R[4].blocksAfter > R[4].blocksBefore);
+    assert(PM.totalMs() >= R[4].ms);
+    auto bc = exec::lowerToBytecode(g);
+    for (uint32_t n = 0; n < 16; ++n)
+        assert(exec::interpret(bc, {n}) == referenceFactorial(n));
+
+    // Analysis passes fill the shared cache; later passes can use it.
+    opt::PassManager AP;
+    AP.parsePipeline("loops");
+    size_t domTreesBuilt = 0;
+    AP.addPass("check", [&](IRGraph &, AnalysisManager &AM, opt::PassManager::Stats &) {
+        assert(AM.isCached(AnalysisManager::LOOPS) && AM.isCached(AnalysisManager::DOM_TREE));
+        domTreesBuilt = AM.timesComputed(AnalysisManager::DOM_TREE);
+        return false;
+    });
+    IRGraph h;
+    buildFactorial(h);
+    assert(!AP.run(h) && domTreesBuilt == 1 && AP.pipeline() == "loops,check");
+
+    // The transformations share them too while the CFG stays put.
+    opt::PassManager TP;
+    TP.parsePipeline("gvn,licm,strength-reduce");
+    unsigned loopsBuilt = 0;
+    TP.addPass("check", [&](IRGraph &, AnalysisManager &AM, opt::PassManager::Stats &) {
+        domTreesBuilt = AM.timesComputed(AnalysisManager::DOM_TREE);
+        loopsBuilt = AM.timesComputed(AnalysisManager::LOOPS);
+        return false;
+    });
+    IRGraph k;
+    buildFactorial(k);
+    TP.run(k);
+    assert(domTreesBuilt == 1 && loopsBuilt == 1 && TP.records()[2].blocksAfter == TP.records()[0].blocksBefore);
+}
+
+void testPassManagerRandomPrograms() {
+    opt::PassManager PM;
+    PM.parsePipeline("sccp,dce,gvn,licm,strength-reduce,loop-unroll,gvn,dce");
+    PM.verifyEach = true;
+    checkPassOnRandomPrograms(
+        24, 40,
+        [&](IRGraph &g, int) {
+            PM.run(g);
+            assert(PM.records().size() == 8 && PM.records().back().instsAfter == g.numInsts());
+            for (auto &r : PM.records())
+                assert(r.changed || (r.instsBefore == r.instsAfter && r.blocksBefore == r.blocksAfter));
+            return 0;
+        },
+        [](ProgramGen &gen, int iter) { gen.ivExprs = iter % 2; });
+}
+
+void testPassManagerReportAndErrors() {
+    opt::PassManager PM;
+    PM.parsePipeline("gvn,dce");
+    bool threw = false;
+    try {
+        PM.parsePipeline("dce,inline");
+    } catch (const std::runtime_error &) {
+        threw = true;
+    }
+    assert(threw && PM.pipeline() == "gvn,dce");
+    threw = false;
+    try {
+        PM.parsePipeline("dce,,gvn");
+    } catch (const std::runtime_error &) {
+        threw = true;
+    }
+    assert(threw && PM.numPasses() == 2);
+    opt::PassManager empty;
+    empty.parsePipeline("");
+    assert(empty.numPasses() == 0);
+    for (auto &name : opt::PassManager::registeredPasses())
+        assert(opt::PassManager().addPass(name));
+
+    IRGraph g;
+    buildFactorial(g);
+    PM.run(g);
+    std::ostringstream os;
+    os << std::setprecision(2);
+    PM.printReport(os);
+    std::string report = os.str();
+    assert(report.find("gvn") != std::string::npos && report.find("dce") != std::string::npos);
+    // The caller's stream state is left alone.
+    assert(os.flags() == std::ostringstream().flags() && os.precision() == 2);
+    assert(report.find("total") != std::string::npos && report.find("11 -> ") != std::string::npos);
+
+    // A pass that breaks the graph is caught when verifying.
+    opt::PassManager bad;
+    bad.verifyEach = true;
+    bad.addPass("break", [](IRGraph &h, AnalysisManager &, opt::PassManager::Stats &) {
+        h.getBlock("done")->insts.front()->dropAllReferences();
+        return true;
+    });
+    threw = false;
+    try {
+        bad.run(g);
+    } catch (const std::runtime_error &e) {
+        threw = std::string(e.what()).find("break") != std::string::npos;
+    }
+    assert(threw && bad.records().size() == 1);
+}
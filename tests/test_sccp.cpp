@@ -0,0 +1,151 @@
+#include "exec/interpreter.h"
+#include "graph_builders.h"
+#include "opt/sccp.h"
+#include "program_gen.h"
+#include <algorithm>
+#include <cassert>
+#include <random>
+#include <vector>
+
+using namespace ir;
+
+void testSCCPDiamond() {
+    // if (7 > 3) x = 2 * 5; else x = 1; return x + 1;
+    IRGraph g;
+    g.setSignature("u64", "d", {});
+    auto *entry = g.createBlock("entry");
+    auto *thenB = g.createBlock("then");
+    auto *elseB = g.createBlock("else");
+    auto *join = g.createBlock("join");
+    SSAValue *a = g.createValue(), *b = g.createValue(), *c = g.createValue();
+    SSAValue *t = g.createValue(), *e = g.createValue(), *x = g.createValue(), *r = g.createValue();
+    entry->addInst(g.createMovi(a, 7));
+    entry->addInst(g.createMovi(b, 3));
+    entry->addInst(g.createCmp(a, b));
+    entry->addInst(g.createJa(thenB));
+    entry->addSuccessor(elseB);
+    entry->addSuccessor(thenB);
+    thenB->addInst(g.createMovi(c, 5));
+    thenB->addInst(g.createMul(t, c, c));
+    thenB->addInst(g.createJmp(join));
+    thenB->addSuccessor(join);
+    elseB->addInst(g.createMovi(e, 1));
+    elseB->addInst(g.createJmp(join));
+    elseB->addSuccessor(join);
+    join->addInst(g.createPhi(x, {{thenB, t}, {elseB, e}}));
+    join->addInst(g.createAddi(r, x, 1));
+    join->addInst(g.createRet(r));
+
+    opt::SCCP sccp;
+    assert(sccp.run(g));
+    assert(sccp.numBranchesFolded == 1 && sccp.numBlocksRemoved == 1);
+    assert(!g.getBlock("else") && g.numBlocks() == 3);
+    assert(entry->successors == std::vector<BasicBlock *>{thenB});
+    assert(join->predecessors == std::vector<BasicBlock *>{thenB});
+    assert(countOpcode(g.getBlocks(), Opcode::PHI_U64) == 0 && countOpcode(g.getBlocks(), Opcode::CMP_U64) == 0);
+    assert(countOpcode(g.getBlocks(), Opcode::MUL_U64) == 0 && countOpcode(g.getBlocks(), Opcode::ADDI_U64) == 0);
+    assert(e->users.empty() && a->users.empty());
+    assert(r->def->opcode() == Opcode::MOVI_U64 && static_cast<MoviInst *>(r->def)->imm() == 26);
+    assert(g.checkDataFlow());
+    assert(exec::interpret(exec::lowerToBytecode(g), {}) == 26);
+    assert(!sccp.run(g));
+
+    // Folding a branch keeps the cmp when the block it goes to, or one
+    // past a block that only jumps, reads the flags.
+    for (bool hop : {false, true})
+        for (bool above : {true, false}) {
+            IRGraph f;
+            buildFlagsAcrossBlocks(f, above, hop);
+            assert(sccp.run(f) && sccp.numBranchesFolded == 1);
+            assert(countOpcode(f.getBlocks(), Opcode::CMP_U64) == 1 && f.checkDataFlow());
+            assert(exec::interpret(exec::lowerToBytecode(f), {}) == (above ? 5 : 3));
+        }
+}
+
+void testSCCPLoops() {
+    // Values that differ between iterations stay overdefined.
+    IRGraph g;
+    g.setSignature("u64", "l", {{"u32", "n"}});
+    auto *entry = g.createBlock("entry");
+    auto *head = g.createBlock("head");
+    auto *body = g.createBlock("body");
+    auto *exit = g.createBlock("exit");
+    SSAValue *n0 = g.createArg("u32", "n");
+    SSAValue *n = g.createValue(), *k = g.createValue(), *z = g.createValue();
+    SSAValue *pk = g.createValue(), *pi = g.createValue(), *k2 = g.createValue(), *i2 = g.createValue();
+    SSAValue *r = g.createValue();
+    entry->addInst(g.createCast(n, n0));
+    entry->addInst(g.createMovi(k, 4));
+    entry->addInst(g.createMovi(z, 0));
+    entry->addInst(g.createJmp(head));
+    entry->addSuccessor(head);
+    head->addInst(g.createPhi(pk, {{entry, k}, {body, k2}}));
+    head->addInst(g.createPhi(pi, {{entry, z}, {body, i2}}));
+    head->addInst(g.createCmp(pi, n));
+    head->addInst(g.createJa(exit));
+    head->addSuccessor(body);
+    head->addSuccessor(exit);
+    body->addInst(g.createMul(k2, pk, pk));
+    body->addInst(g.createAddi(i2, pi, 1));
+    body->addInst(g.createJmp(head));
+    body->addSuccessor(head);
+    exit->addInst(g.createMul(r, pk, pi));
+    exit->addInst(g.createRet(r));
+
+    opt::SCCP sccp;
+    sccp.run(g);
+    // pk meets 4 and 16: overdefined. pi is the counter.
+    assert(sccp.valueOf(pk).kind == opt::SCCP::Lattice::Over);
+    assert(sccp.valueOf(pi).kind == opt::SCCP::Lattice::Over);
+    assert(sccp.numBranchesFolded == 0 && g.numBlocks() == 4);
+
+    // fact(1) never enters the loop body.
+    IRGraph h;
+    buildFactorial(h);
+    opt::SCCP spec;
+    spec.run(h, {1});
+    assert(spec.numBlocksRemoved == 1 && !h.getBlock("body"));
+    assert(h.checkDataFlow());
+    assert(exec::interpret(exec::lowerToBytecode(h), {77}) == 1);
+    assert(countOpcode(h.getBlocks(), Opcode::PHI_U64) == 0 && countOpcode(h.getBlocks(), Opcode::CMP_U64) == 0);
+}
+
+void testSCCPRandomPrograms() {
+    std::mt19937_64 rng(15);
+    size_t branches = 0, blocks = 0;
+    for (int iter = 0; iter < 80; ++iter) {
+        bool specialize = iter % 2;
+        uint64_t a0 = rng() % 8, a1 = rng() % 8;
+        IRGraph g;
+        ProgramGen gen(g, rng);
+        gen.build(2 + iter % 8);
+        exec::BytecodeFunction before = exec::lowerToBytecode(g);
+        std::vector<std::pair<uint64_t, uint64_t>> inputs{{a0, a1}};
+        for (int t = 0; t < 3; ++t)
+            inputs.emplace_back(rng() % 8, rng());
+        std::vector<uint64_t> expect;
+        for (auto [x, y] : inputs)
+            expect.push_back(exec::interpret(before, {x, y}));
+
+        opt::SCCP sccp;
+        if (specialize)
+            sccp.run(g, {a0, a1});
+        else
+            sccp.run(g);
+        branches += sccp.numBranchesFolded;
+        blocks += sccp.numBlocksRemoved;
+        assert(g.checkDataFlow());
+        for (auto *bb : g.getBlocks())
+            for (auto *p : bb->predecessors)
+                assert(std::count(p->successors.begin(), p->successors.end(), bb) ==
+                       std::count(bb->predecessors.begin(), bb->predecessors.end(), p));
+        exec::BytecodeFunction after = exec::lowerToBytecode(g);
+        if (specialize) {
+            assert(exec::interpret(after, {a0, a1}) == expect[0]);
+            continue;
+        }
+        for (size_t t = 0; t < inputs.size(); ++t)
+            assert(exec::interpret(after, {inputs[t].first, inputs[t].second}) == expect[t]);
+    }
+    assert(branches > 0 && blocks > 0);
+}
@@ -0,0 +1,169 @@
+#include "graph_builders.h"
+#include "ir/ssa_builder.h"
+#include <cassert>
+#include <vector>
+
+using namespace ir;
+
+static size_t countPhis(const BasicBlock *bb) {
+    size_t n = 0;
+    for (const Inst *I : bb->insts)
+        n += I->opcode() == Opcode::PHI_U64;
+    return n;
+}
+
+void testSSABuilderFactorial() {
+    IRGraph g;
+    g.setSignature("u64", "fact", {{"u32", "a0"}});
+    auto *entry = g.createBlock("entry");
+    auto *loop = g.createBlock("loop");
+    auto *body = g.createBlock("body");
+    auto *done = g.createBlock("done");
+    SSABuilder B(g);
+    auto res = B.declareVariable("res");
+    auto i = B.declareVariable("i");
+    auto n = B.declareVariable("n");
+
+    SSAValue *a0 = g.createArg("u32", "a0");
+    B.sealBlock(entry);
+    SSAValue *one = g.createValue(), *two = g.createValue(), *wide = g.createValue();
+    entry->addInst(g.createMovi(one, 1));
+    entry->addInst(g.createMovi(two, 2));
+    entry->addInst(g.createCast(wide, a0));
+    B.writeVariable(res, entry, one);
+    B.writeVariable(i, entry, two);
+    B.writeVariable(n, entry, wide);
+    entry->addSuccessor(loop);
+
+    // The loop header stays unsealed until the back edge exists.
+    loop->addInst(g.createCmp(B.readVariable(i, loop), B.readVariable(n, loop)));
+    loop->addInst(g.createJa(done));
+    loop->addSuccessor(done);
+    loop->addSuccessor(body);
+
+    B.sealBlock(body);
+    SSAValue *prod = g.createValue(), *next = g.createValue();
+    body->addInst(g.createMul(prod, B.readVariable(res, body), B.readVariable(i, body)));
+    body->addInst(g.createAddi(next, B.readVariable(i, body), 1));
+    B.writeVariable(res, body, prod);
+    B.writeVariable(i, body, next);
+    body->addInst(g.createJmp(loop));
+    body->addSuccessor(loop);
+    B.sealBlock(loop);
+
+    B.sealBlock(done);
+    done->addInst(g.createRet(B.readVariable(res, done)));
+
+    // n is loop-invariant, so its header phi is created and then folded.
+    assert(countPhis(loop) == 2);
+    assert(B.numPhisCreated() == 3 && B.numPhisRemoved() == 1);
+    assert(g.checkDataFlow());
+    std::map<std::string, std::set<Opcode>> required = {
+        {"entry", {Opcode::MOVI_U64, Opcode::U32TOU64}},
+        {"loop", {Opcode::PHI_U64, Opcode::CMP_U64, Opcode::JA_U64}},
+        {"body", {Opcode::MUL_U64, Opcode::ADDI_U64, Opcode::JMP}},
+        {"done", {Opcode::RET_U64}}};
+    assert(g.checkNecessaryInsts(required));
+
+    auto *cmp = static_cast<CmpInst *>(loop->insts.back()->prev());
+    assert(cmp->right() == wide);
+    auto *phiI = static_cast<PhiInst *>(cmp->left()->def);
+    assert(phiI->parent() == loop && phiI->incomingFor(entry) == two &&
+           phiI->incomingFor(body) == next);
+    auto *ret = static_cast<RetInst *>(done->insts.back());
+    auto *phiRes = static_cast<PhiInst *>(ret->src()->def);
+    assert(phiRes->incomingFor(entry) == one && phiRes->incomingFor(body) == prod);
+    assert(wide->users.size() == 1);
+}
+
+void testSSABuilderDiamond() {
+    BuiltCFG W;
+    auto &g = W.g;
+    auto *A = BB(W, "A");
+    auto *L = BB(W, "L");
+    auto *R = BB(W, "R");
+    auto *J = BB(W, "J");
+    EDGE(A, L);
+    EDGE(A, R);
+    EDGE(L, J);
+    EDGE(R, J);
+    SSABuilder B(g);
+    B.sealAll();
+    auto x = B.declareVariable("x");
+    auto y = B.declareVariable("y");
+    auto u = B.declareVariable("u");
+
+    SSAValue *c = g.createValue(), *l = g.createValue(), *r = g.createValue();
+    A->addInst(g.createMovi(c, 7));
+    L->addInst(g.createMovi(l, 1));
+    R->addInst(g.createMovi(r, 2));
+    B.writeVariable(x, L, l);
+    B.writeVariable(x, R, r);
+    B.writeVariable(y, A, c);
+    B.writeVariable(y, L, c);
+
+    SSAValue *xj = B.readVariable(x, J);
+    assert(xj->def && xj->def->opcode() == Opcode::PHI_U64 && xj->def->parent() == J);
+    assert(B.readVariable(x, J) == xj);
+    assert(B.readVariable(y, J) == c);
+    assert(countPhis(J) == 1);
+
+    // Reading a never-written variable yields one shared zero at the entry.
+    SSAValue *undef = B.readVariable(u, J);
+    assert(undef->def == A->insts.front() && undef->def->opcode() == Opcode::MOVI_U64);
+    assert(B.readVariable(u, L) == undef);
+    J->addInst(g.createRet(xj));
+    assert(g.checkDataFlow());
+}
+
+void testSSABuilderNestedLoopsAndChains() {
+    // Nested loops that never redefine the variable end up with no phis.
+    BuiltCFG W;
+    auto &g = W.g;
+    auto *E = BB(W, "E");
+    auto *H1 = BB(W, "H1");
+    auto *H2 = BB(W, "H2");
+    auto *Bd = BB(W, "Bd");
+    auto *X = BB(W, "X");
+    EDGE(E, H1);
+    EDGE(H1, H2);
+    EDGE(H2, Bd);
+    EDGE(Bd, H2);
+    EDGE(H2, H1);
+    EDGE(H1, X);
+    SSABuilder B(g);
+    auto v = B.declareVariable("v");
+    SSAValue *init = g.createValue();
+    E->addInst(g.createMovi(init, 3));
+    B.writeVariable(v, E, init);
+    B.sealBlock(E);
+    SSAValue *inBody = B.readVariable(v, Bd);
+    SSAValue *atExit = B.readVariable(v, X);
+    auto *use = g.createAddi(g.createValue(), inBody, 1);
+    Bd->addInst(use);
+    B.sealAll();
+    assert(B.numPhisCreated() > 0 && B.numPhisCreated() == B.numPhisRemoved());
+    assert(use->src() == init);
+    assert(B.readVariable(v, X) == init && B.readVariable(v, Bd) == init);
+    (void)atExit;
+    for (auto *bb : g.getBlocks())
+        assert(countPhis(bb) == 0);
+    assert(g.checkDataFlow());
+
+    // Long straight-line chains are resolved without recursion.
+    IRGraph chain;
+    SSABuilder C(chain);
+    auto w = C.declareVariable("w");
+    auto *prev = chain.createBlock("b0");
+    SSAValue *seed = chain.createValue();
+    prev->addInst(chain.createMovi(seed, 9));
+    C.writeVariable(w, prev, seed);
+    for (int k = 1; k < 200000; ++k) {
+        auto *bb = chain.createBlock();
+        prev->addSuccessor(bb);
+        prev = bb;
+    }
+    C.sealAll();
+    assert(C.readVariable(w, prev) == seed);
+    assert(C.numPhisCreated() == 0);
+}
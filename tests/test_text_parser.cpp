@@ -0,0 +1,171 @@
+#include "exec/interpreter.h"
+#include "graph_builders.h"
+#include "ir/text_parser.h"
+#include "opt/dce.h"
+#include "opt/loop_unroll.h"
+#include "program_gen.h"
+#include <algorithm>
+#include <cassert>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+using namespace ir;
+
+namespace {
+std::string printed(const IRGraph &g) {
+    std::ostringstream os;
+    g.print(os);
+    return os.str();
+}
+
+// Same layout, names and successor lists; the printed text covers the rest.
+bool sameCfg(const IRGraph &a, const IRGraph &b) {
+    if (a.numBlocks() != b.numBlocks())
+        return false;
+    auto names = [](const std::vector<BasicBlock *> &v) {
+        std::vector<std::string> r;
+        for (auto *s : v)
+            r.push_back(bbName(s));
+        std::sort(r.begin(), r.end());
+        return r;
+    };
+    for (size_t i = 0; i < a.numBlocks(); ++i) {
+        const BasicBlock *x = a.getBlocks()[i], *y = b.getBlocks()[i];
+        if (bbName(x) != bbName(y) || names(x->successors) != names(y->successors) ||
+            names(x->predecessors) != names(y->predecessors))
+            return false;
+    }
+    return true;
+}
+
+bool rejects(const std::string &text) {
+    try {
+        IRGraph g;
+        parseText(text, g);
+    } catch (const std::runtime_error &) {
+        return true;
+    }
+    return false;
+}
+}
+
+void testTextRoundTrip() {
+    IRGraph g;
+    buildFactorial(g);
+    std::string text = printed(g);
+    assert(text.find("loop:\n") != std::string::npos && text.find("ja          done") != std::string::npos);
+    assert(text.find("; succs") == std::string::npos);
+
+    IRGraph h;
+    parseText(text, h);
+    assert(printed(h) == text && sameCfg(g, h) && h.checkDataFlow());
+    assert(h.name() == "fact" && h.args().size() == 1 && h.args()[0].val->is_arg);
+    assert(h.valueIdBound() == g.valueIdBound() && h.getBlock("body")->predecessors.size() == 1);
+    auto bc = exec::lowerToBytecode(h);
+    for (uint32_t n = 0; n < 10; ++n)
+        assert(exec::interpret(bc, {n}) == referenceFactorial(n));
+
+    // Unrolling leaves fall-throughs to blocks that are not next in layout.
+    opt::LoopUnroll unroll;
+    assert(unroll.run(g));
+    text = printed(g);
+    assert(text.find("; succs:") != std::string::npos && text.find("\nbb5:\n") != std::string::npos);
+    IRGraph u;
+    parseText(text, u);
+    assert(printed(u) == text && sameCfg(g, u) && u.checkDataFlow());
+    bc = exec::lowerToBytecode(u);
+    for (uint32_t n = 0; n < 24; ++n)
+        assert(exec::interpret(bc, {n}) == referenceFactorial(n));
+}
+
+void testTextParserHandWritten() {
+    // Forward references, named values, blank lines and a fall-through
+    // listed explicitly.
+    const char *text = "u64 sum3(u32 n, u64 k):\n"
+                       "entry:\n"
+                       "    u32tou64    x, n\n"
+                       "    jmp         add\n"
+                       "\n"
+                       "dead:  ; succs: entry\n"
+                       "    movi.u64    w, 9\n"
+                       "add:\n"
+                       "    addi.u64    y, x, 3\n"
+                       "    mul.u64     z, y, k\n"
+                       "    ret.u64     z\n";
+    IRGraph g;
+    parseText(text, g);
+    assert(g.numBlocks() == 3 && g.entry()->label == "entry" && g.checkDataFlow());
+    assert(g.getBlock("dead")->successors == (std::vector<BasicBlock *>{g.entry()}));
+    assert(g.getBlock("add")->predecessors.size() == 1);
+    assert(exec::interpret(exec::lowerToBytecode(g), {4, 5}) == 35);
+
+    // Phis may name values and blocks defined further down.
+    const char *loop = "u64 f(u32 a0):\n"
+                       "entry:\n"
+                       "    movi.u64    v1, 0\n"
+                       "    u32tou64    v2, a0\n"
+                       "head:\n"
+                       "    phi.u64     v3 = entry: v1, latch: v4\n"
+                       "    cmp.u64     v2, v3\n"
+                       "    ja          latch\n"
+                       "done:\n"
+                       "    ret.u64     v3\n"
+                       "latch:\n"
+                       "    addi.u64    v4, v3, 1\n"
+                       "    jmp         head\n";
+    IRGraph h;
+    parseText(loop, h);
+    assert(h.checkDataFlow() && h.valueIdBound() == 5);
+    assert(h.getBlock("head")->successors ==
+           (std::vector<BasicBlock *>{h.getBlock("done"), h.getBlock("latch")}));
+    assert(exec::interpret(exec::lowerToBytecode(h), {7}) == 7);
+}
+
+void testTextParserRandomPrograms() {
+    std::mt19937_64 rng(22);
+    for (int iter = 0; iter < 60; ++iter) {
+        IRGraph g;
+        ProgramGen gen(g, rng);
+        gen.ivExprs = iter % 2;
+        gen.build(2 + iter % 8);
+        if (iter % 3 == 1) {
+            opt::LoopUnroll unroll;
+            unroll.run(g);
+        } else if (iter % 3 == 2) {
+            opt::DCE dce;
+            dce.run(g);
+        }
+        std::string text = printed(g);
+        IRGraph h;
+        parseText(text, h);
+        assert(printed(h) == text && sameCfg(g, h) && h.checkDataFlow());
+        checkSameResults(exec::lowerToBytecode(g), h, rng);
+    }
+}
+
+void testTextParserErrors() {
+    const std::string sig = "u64 f(u32 a0):\n";
+    assert(!rejects(sig + "entry:\n    ret.u64     a0\n"));
+    assert(rejects(""));
+    assert(rejects(sig));
+    assert(rejects("u64 f(u32 a0)\nentry:\n"));
+    assert(rejects(sig + "    ret.u64     a0\n"));
+    assert(rejects(sig + "entry:\n    frob.u64    a0\n"));
+    assert(rejects(sig + "entry:\n    jmp         nowhere\n"));
+    assert(rejects(sig + "entry:\n    ret.u64     v9\n"));
+    assert(rejects(sig + "entry:\n    movi.u64    v1, 1\n    movi.u64    v1, 2\n    ret.u64     v1\n"));
+    assert(rejects(sig + "entry:\n    movi.u64    a0, 1\n    ret.u64     a0\n"));
+    assert(rejects(sig + "entry:\n    movi.u64    v1, 18446744073709551616\n    ret.u64     v1\n"));
+    assert(rejects(sig + "entry:\n    ret.u64     a0, a0\n"));
+    assert(rejects(sig + "entry:\nentry:\n    ret.u64     a0\n"));
+    assert(rejects(sig + "entry:  ; preds: x\n    ret.u64     a0\n"));
+
+    try {
+        IRGraph g;
+        parseText(sig + "entry:\n    movi.u64    v1, x\n", g);
+        assert(false);
+    } catch (const std::runtime_error &e) {
+        assert(std::string(e.what()).find(":3:") != std::string::npos);
+    }
+}
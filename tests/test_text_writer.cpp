@@ -0,0 +1,85 @@
+#include "graph_builders.h"
+#include "ir/text_parser.h"
+#include "opt/loop_unroll.h"
+#include "program_gen.h"
+#include <cassert>
+#include <random>
+#include <set>
+#include <sstream>
+
+using namespace ir;
+
+void testUniqueBlockNames() {
+    IRGraph g;
+    g.setSignature("u64", "f", {});
+    auto *a = g.createBlock("loop");
+    auto *b = g.createBlock("loop");
+    auto *c = g.createBlock();
+    auto *d = g.createBlock("bb2");
+    auto *e = g.createBlock("bb02");
+    assert(a->label == "loop" && b->label == "loop.1" && bbName(c) == "bb2" && d->label == "bb2.3");
+    assert(e->label == "bb02" && g.getBlock("loop") == a && g.getBlock("loop.1") == b);
+    SSAValue *v = g.createValue();
+    a->addInst(g.createMovi(v, 7));
+    a->addInst(g.createJmp(c));
+    a->addSuccessor(c);
+    c->addInst(g.createRet(v));
+    for (auto *x : {b, d, e}) {
+        x->addInst(g.createJmp(c));
+        x->addSuccessor(c);
+    }
+    std::string text = g.toString();
+    std::set<std::string> names;
+    for (auto *x : g.getBlocks())
+        assert(names.insert(bbName(x)).second && text.find("\n" + bbName(x) + ":\n") != std::string::npos);
+
+    // Unlabeled blocks come back with the same ids.
+    IRGraph h;
+    parseText(text, h);
+    assert(h.toString() == text && h.getBlocks()[2]->label.empty() && h.getBlocks()[2]->id == 2);
+    assert(h.blockIdBound() >= 5 && h.getBlock("bb2.3") && h.getBlock("loop.1"));
+}
+
+void testStreamingPrinter() {
+    IRGraph g;
+    buildFactorial(g);
+    const char *expect = "u64 fact(u32 a0):\n"
+                         "entry:\n"
+                         "    movi.u64    v1, 1\n"
+                         "    movi.u64    v2, 2\n"
+                         "    u32tou64    v3, a0\n"
+                         "loop:\n"
+                         "    phi.u64     v4 = entry: v1, body: v6\n"
+                         "    phi.u64     v5 = entry: v2, body: v7\n"
+                         "    cmp.u64     v5, v3\n"
+                         "    ja          done\n"
+                         "body:\n"
+                         "    mul.u64     v6, v4, v5\n"
+                         "    addi.u64    v7, v5, 1\n"
+                         "    jmp         loop\n"
+                         "done:\n"
+                         "    ret.u64     v4\n";
+    assert(g.toString() == expect);
+    assert(g.getBlock("loop")->insts.back()->toString() == "ja          done");
+    std::ostringstream os;
+    g.print(os);
+    assert(os.str() == expect);
+
+    // Output larger than the writer's buffer arrives whole and in order.
+    std::mt19937_64 rng(23);
+    std::ostringstream big;
+    std::string whole;
+    {
+        TextWriter w(big);
+        for (int iter = 0; iter < 40; ++iter) {
+            IRGraph r;
+            ProgramGen gen(r, rng);
+            gen.build(2 + iter % 8);
+            opt::LoopUnroll unroll;
+            unroll.run(r);
+            r.print(w);
+            whole += r.toString();
+        }
+    }
+    assert(whole.size() > (1 << 16) && big.str() == whole);
+}